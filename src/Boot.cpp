@@ -91,6 +91,7 @@ static void ParseCommandLine(int argc, char** argv)
 	memset(&gCommandLine, 0, sizeof(gCommandLine));
 	gCommandLine.msaa = 0;
 	gCommandLine.vsync = 1;
+	gCommandLine.terrainCacheMB = 16;
 
 	for (int i = 1; i < argc; i++)
 	{
@@ -125,6 +126,33 @@ static void ParseCommandLine(int argc, char** argv)
 			gCommandLine.fullscreenRefreshRate = atoi(argv[i + 1]);
 			i += 1;
 		}
+		else if (argument == "--max-fps")
+		{
+			GAME_ASSERT_MESSAGE(i + 1 < argc, "max fps unspecified");
+			gCommandLine.maxFPS = atoi(argv[i + 1]);
+			GAME_ASSERT_MESSAGE(gCommandLine.maxFPS >= MIN_FPS, "max fps too low");
+			i += 1;
+		}
+		else if (argument == "--gpu-fence")
+			gCommandLine.gpuFence = 1;
+		else if (argument == "--shader-renderer")
+			gCommandLine.shaderRenderer = 1;
+		else if (argument == "--no-occlusion-culling")
+			gCommandLine.noOcclusionCulling = 1;
+		else if (argument == "--terrain-cache")
+		{
+			GAME_ASSERT_MESSAGE(i + 1 < argc, "terrain cache size unspecified");
+			gCommandLine.terrainCacheMB = atoi(argv[i + 1]);
+			GAME_ASSERT_MESSAGE(gCommandLine.terrainCacheMB >= 0, "terrain cache size can't be negative");
+			i += 1;
+		}
+		else if (argument == "--fixed-tick")
+		{
+			GAME_ASSERT_MESSAGE(i + 1 < argc, "fixed tick rate unspecified");
+			gCommandLine.fixedTickRate = atoi(argv[i + 1]);
+			GAME_ASSERT_MESSAGE(gCommandLine.fixedTickRate >= MIN_FPS, "fixed tick rate too low");
+			i += 1;
+		}
 	}
 }
 
@@ -260,33 +260,25 @@ void UpdateEnemy(ObjNode *theNode)
 // OUTPUT: nil if no enemies
 //
 
+static Boolean IsKillableEnemy(const ObjNode* theNode, void* userData)
+{
+	(void) userData;
+
+	return (theNode->Kind != ENEMY_KIND_SLUG) && (theNode->Kind != ENEMY_KIND_CATERPILLER)		// ignore unkillable enemies
+		&& (theNode->Kind != ENEMY_KIND_PONDFISH) && (theNode->Kind != ENEMY_KIND_WORKERBEE);
+}
+
 ObjNode *FindClosestEnemy(TQ3Point3D *pt, float *dist)
 {
-ObjNode		*thisNodePtr,*best = nil;
-float	d,minDist = 10000000;
+ObjNode		*best;
+float		minDist;
 
-			
-	thisNodePtr = gFirstNodePtr;
-	
-	do
+	if (!SpatialIndex_QueryNearest(pt->x, pt->z, 10000000, CTYPE_ENEMY, IsKillableEnemy, nil, CalcQuickDistance,
+								1, &best, &minDist))
 	{
-		if (thisNodePtr->Slot >= SLOT_OF_DUMB)					// see if reach end of usable list
-			break;
-
-		if ((thisNodePtr->CType & CTYPE_ENEMY)
-		&& (thisNodePtr->Kind != ENEMY_KIND_SLUG) && (thisNodePtr->Kind != ENEMY_KIND_CATERPILLER)		// ignore unkillable enemies
-		&& (thisNodePtr->Kind != ENEMY_KIND_PONDFISH) && (thisNodePtr->Kind != ENEMY_KIND_WORKERBEE))
-		{
-			d = CalcQuickDistance(pt->x,pt->z,thisNodePtr->Coord.x, thisNodePtr->Coord.z);
-			if (d < minDist)
-			{
-				minDist = d;
-				best = thisNodePtr;
-			}
-		}	
-		thisNodePtr = (ObjNode *)thisNodePtr->NextNode;		// next node
+		*dist = 10000000;
+		return(nil);
 	}
-	while (thisNodePtr != nil);
 
 	*dist = minDist;
 	return(best);
@@ -7,6 +7,9 @@
 
 void InitCamera(void);
 void UpdateCamera(void);
+void SnapshotCameraTransform(void);
+void ApplyCameraInterpolation(float alpha);
+void RestoreCameraInterpolation(void);
 extern	void CalcCameraMatrixInfo(QD3DSetupOutputType *);
 extern	void ResetCameraSettings(void);
 void DrawLensFlare(const QD3DSetupOutputType *setupInfo);
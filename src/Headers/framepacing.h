@@ -0,0 +1,13 @@
+#pragma once
+
+// Frame limiter & pacing statistics.
+//
+// Instead of spinning until the frame budget has elapsed, the limiter sleeps
+// in 1 ms slices for as long as it safely can (based on the measured OS sleep
+// overshoot), then spins only for the last fraction of a millisecond.
+
+void FramePacing_WaitForNextFrame(uint64_t prevFrameTime);
+void FramePacing_RecordFrame(uint64_t frameTicks);
+void FramePacing_OnSwap(void);
+void FramePacing_Shutdown(void);
+int FramePacing_FormatStats(char* buf, int bufSize);
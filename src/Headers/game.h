@@ -61,6 +61,11 @@ extern "C"
 #include "mousesmoothing.h"
 #include "frustumculling.h"
 #include "structformats.h"
+#include "profiler.h"
+#include "framepacing.h"
+#include "parallel.h"
+#include "spatialindex.h"
+#include "musicdecode.h"
 
 extern	Boolean						gAreaCompleted;
 extern	Boolean						gBatExists;
@@ -183,6 +188,7 @@ extern	long						gCurrentSuperTileRow;
 extern	long						gEatMouse;
 extern	long						gMyStartX;
 extern	long						gMyStartZ;
+extern	long						gNumCachedSupertiles;
 extern	long						gNumFences;
 extern	long						gNumFreeSupertiles;
 extern	long						gNumSplines;
@@ -190,6 +196,8 @@ extern	long						gNumSuperTilesDeep;
 extern	long						gNumSuperTilesWide;
 extern	long						gNumTerrainTextureTiles;
 extern	long						gPrefsFolderDirID;
+extern	long						gSuperTileCacheHits;
+extern	long						gSuperTileCacheMisses;
 extern	long						gSupertileBudget;
 extern	long						gTerrainTileDepth;
 extern	long						gTerrainTileWidth;
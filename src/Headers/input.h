@@ -83,6 +83,8 @@ Boolean GetNewKeyState_SDL(unsigned short sdlScanCode);
 Boolean GetSkipScreenInput(void);
 Boolean IsCmdQPressed(void);
 void ResetInputState(void);
+void BeginInputTick(void);
+void EndInputTick(void);
 void UpdateKeyMap(void);
 
 Boolean FlushMouseButtonPress(void);
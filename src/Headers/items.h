@@ -50,6 +50,7 @@ Boolean AddRock(TerrainItemEntryType *itemPtr, long  x, long z);
 
 
 Boolean AddHoneyTube(TerrainItemEntryType *itemPtr, long  x, long z);
+void InitHoneyTubeTextureAnimation(void);
 void UpdateHoneyTubeTextureAnimation(void);
 Boolean PrimeHoneycombPlatform(long splineNum, SplineItemType *itemPtr);
 
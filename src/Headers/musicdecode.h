@@ -0,0 +1,14 @@
+#pragma once
+
+// Background decoder for IMA4-compressed (AIFF-C 'ima4') songs.
+//
+// The compressed file is read on the calling thread, then decoded to 16-bit PCM
+// on a worker thread. Once done, the PCM is fronted by a Sound Manager extended
+// sound header so it can be played (and looped gaplessly) with bufferCmd.
+
+typedef struct MusicDecodeJob MusicDecodeJob;
+
+MusicDecodeJob* MusicDecode_Start(short refNum);
+Boolean MusicDecode_IsDone(MusicDecodeJob* job);
+Ptr MusicDecode_GetSoundHeader(MusicDecodeJob* job);
+void MusicDecode_Dispose(MusicDecodeJob* job);
@@ -39,6 +39,9 @@ enum
 };
 
 
+#define	NUM_CTYPE_REGISTRIES	1				// CType bits with membership lists (see kRegisteredCTypes)
+
+
 //========================================================
 
 extern	void InitObjectManager(void);
@@ -46,6 +49,9 @@ extern	ObjNode	*MakeNewObject(NewObjectDefinitionType *newObjDef);
 extern	void MoveObjects(void);
 ObjNode *MakeNewCustomDrawObject(NewObjectDefinitionType *newObjDef, TQ3BoundingSphere *cullSphere, void drawFunc(ObjNode *));
 extern	void DrawObjects(const QD3DSetupOutputType *setupInfo);
+void SnapshotObjectTransforms(void);
+void ApplyObjectInterpolation(float alpha);
+void RestoreObjectInterpolation(void);
 extern	void DeleteAllObjects(void);
 extern	void DeleteObject(ObjNode	*theNode);
 extern	void DetachObject(ObjNode *theNode);
@@ -78,3 +84,5 @@ extern	void StopObjectStreamEffect(ObjNode *theNode);
 extern	void KeepOldCollisionBoxes(ObjNode *theNode);
 
 void DrawCollisionBoxes(const ObjNode* theNode);
+
+ObjNode* const* GetObjectsWithCType(uint32_t ctypeBit, int* outCount);
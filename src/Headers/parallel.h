@@ -0,0 +1,12 @@
+#pragma once
+
+// Data-parallel helper for load-time passes over the map.
+//
+// The rows [0, numRows) are split into contiguous bands, one per CPU core (capped),
+// and func is called once per band. Band 0 runs on the calling thread; the call
+// returns once every band is done. Each band must only write to its own rows, so
+// the result doesn't depend on how many bands there were or which finished first.
+
+typedef void (*ParallelBandFunc)(void* userData, int firstRow, int endRow);
+
+void Parallel_ForBands(int numRows, ParallelBandFunc func, void* userData);
@@ -6,5 +6,7 @@ ObjNode* NewPickableQuad(TQ3Point3D	coord, float width, float height, int32_t pi
 
 void DisposePickableObjects(void);
 
+void FlushPickCache(void);
+
 bool PickObject(int mouseX, int mouseY, int32_t *pickID);
 
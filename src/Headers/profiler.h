@@ -0,0 +1,69 @@
+#pragma once
+
+// Lightweight hot-path profiler.
+//
+// Zones are timed with PROFILE_BEGIN/PROFILE_END pairs and counters are bumped
+// with PROFILE_COUNT. Every frame, the totals are pushed into a ring buffer
+// that feeds the rolling graphs in the debug stats overlay. Individual zone
+// timings are also kept in an event ring that can be exported as a Chrome
+// trace (chrome://tracing or https://ui.perfetto.dev).
+//
+// Build with -DPROFILER=1 to enable. When disabled, all macros compile to nothing.
+
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0
+#endif
+
+typedef enum
+{
+	kProfZone_Frame,			// implicit: whole frame, recorded by Profiler_EndFrame
+	kProfZone_Skinning,
+	kProfZone_Collision,
+	kProfZone_TerrainBuild,
+	kProfZone_Particles,
+	kProfZone_Sound,
+	kProfZone_Flush,
+	NUM_PROF_ZONES
+} ProfZone;
+
+typedef enum
+{
+	kProfCounter_SkinnedMeshes,
+	kProfCounter_CollisionQueries,
+	kProfCounter_SupertilesBuilt,
+	kProfCounter_Particles,
+	kProfCounter_SoundUpdates,
+	kProfCounter_FlushedMeshes,
+	NUM_PROF_COUNTERS
+} ProfCounter;
+
+#if ENABLE_PROFILER
+
+uint64_t Profiler_BeginZone(void);
+void Profiler_EndZone(ProfZone zone, uint64_t startTime);
+void Profiler_Count(ProfCounter counter, int amount);
+
+// Call once per frame to commit the current frame's totals to the history ring.
+void Profiler_EndFrame(void);
+
+// Writes a human-readable summary of the recent history (with rolling graphs) into buf.
+// Returns the number of characters written.
+int Profiler_FormatStats(char* buf, int bufSize);
+
+// Dumps the event ring to a JSON file in Chrome trace-event format.
+// Returns true on success.
+bool Profiler_ExportChromeTrace(const char* path);
+
+#define PROFILE_BEGIN(zone)			uint64_t _profStart_##zone = Profiler_BeginZone()
+#define PROFILE_END(zone)			Profiler_EndZone(kProfZone_##zone, _profStart_##zone)
+#define PROFILE_COUNT(counter, n)	Profiler_Count(kProfCounter_##counter, (n))
+#define PROFILE_END_FRAME()			Profiler_EndFrame()
+
+#else
+
+#define PROFILE_BEGIN(zone)			do {} while(0)
+#define PROFILE_END(zone)			do {} while(0)
+#define PROFILE_COUNT(counter, n)	do {} while(0)
+#define PROFILE_END_FRAME()			do {} while(0)
+
+#endif
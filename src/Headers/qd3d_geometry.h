@@ -12,23 +12,13 @@ enum
 	SHARD_MODE_NULLSHADER		= (1 << 3)
 };
 
-#define	MAX_SHARDS			80
-
-typedef struct
-{
-	TQ3Vector3D				rot,rotDelta;
-	TQ3Point3D				coord,coordDelta;
-	float					decaySpeed,scale;
-	Byte					mode;
-	TQ3Matrix4x4			matrix;
-	TQ3TriMeshData			*mesh;
-}ShardType;
+#define	MAX_SHARDS			320
+#define	MAX_SHARD_BATCHES	16			// max # of texture/material combinations among live shards
 
 void QD3D_CalcObjectBoundingBox(int numMeshes, TQ3TriMeshData** meshList, TQ3BoundingBox* boundingBox);
 void QD3D_CalcObjectBoundingSphere(int numMeshes, TQ3TriMeshData** meshList, TQ3BoundingSphere* boundingSphere);
 void QD3D_ExplodeGeometry(ObjNode *theNode, float boomForce, Byte shardMode, int shardDensity, float shardDecaySpeed);
 void QD3D_MirrorMeshesZ(ObjNode *theNode);
-void QD3D_ScrollUVs(TQ3TriMeshData* meshList, float du, float dv);
 void QD3D_InitShards(void);
 void QD3D_DisposeShards(void);
 void QD3D_MoveShards(void);
@@ -21,6 +21,9 @@ typedef struct RenderStats
 	int			triangles;
 	int			meshesPass1;
 	int			meshesPass2;
+	int			fadeCopyBytesAvoided;	// vertex color bytes that auto-fade didn't have to copy
+	int			occludedSupertiles;
+	int			occludedObjects;
 } RenderStats;
 
 typedef struct RenderModifiers
@@ -34,6 +37,12 @@ typedef struct RenderModifiers
 	// Auto-fade alpha factor (applied on top of the alpha in diffuseColor).
 	float					autoFadeFactor;
 
+	// Texture coordinate transform (UVs are scaled, then offset).
+	// Only applies to meshes flagged with kQ3TexturingModeExt_UVTransformFlag.
+	// Scrolling a texture this way leaves the mesh's vertexUVs untouched.
+	TQ3Param2D				uvOffset;
+	TQ3Param2D				uvScale;
+
 	// Set this to override the order in which meshes are drawn.
 	// The default value for most objects is 0.
 	// Meshes are sorted by ascending draw order.
@@ -74,6 +83,18 @@ typedef enum
 // OR this flag to a mesh's texturingMode to force the mesh to be NULL-shaded.
 #define kQ3TexturingModeExt_NullShaderFlag		0x00010000
 
+// OR this flag to a mesh's texturingMode to transform its UVs by RenderModifiers.uvOffset/uvScale.
+#define kQ3TexturingModeExt_UVTransformFlag		0x00020000
+
+typedef enum
+{
+	kShaderFeature_Lighting,
+	kShaderFeature_Fog,
+	kShaderFeature_Texture,
+	kShaderFeature_AlphaTest,
+	NUM_SHADER_FEATURES
+} ShaderFeature;
+
 #pragma mark -
 
 void DoFatalGLError(GLenum error, const char* function, int line);
@@ -103,6 +124,9 @@ void Render_EnableFog(
 
 void Render_DisableFog(void);
 
+// Tells the renderer how many fill lights (GL_LIGHT0...) are enabled.
+void Render_SetNumFillLights(int numFillLights);
+
 #pragma mark -
 
 void Render_BindTexture(GLuint textureName);
@@ -200,3 +224,51 @@ TQ3Vector2D FitRectKeepAR(
 	int logicalHeight,
 	float displayWidth,
 	float displayHeight);
+
+#pragma mark -
+
+// Uber-shader backend (--shader-renderer). Used internally by the renderer.
+
+bool RenderShaders_Init(void);
+
+void RenderShaders_Shutdown(void);
+
+void RenderShaders_Begin(int numFillLights);
+
+void RenderShaders_End(void);
+
+void RenderShaders_SetFeature(ShaderFeature feature, bool enable);
+
+void RenderShaders_SetAlphaScale(float alphaScale);
+
+#pragma mark -
+
+// Occlusion culling (GL occlusion queries). Used internally by the renderer.
+
+bool RenderOcclusion_Init(void);
+
+void RenderOcclusion_Shutdown(void);
+
+void RenderOcclusion_Reset(void);
+
+int RenderOcclusion_GetSuperTileSlot(int superTileNum, int layer);
+
+void RenderOcclusion_ForgetSlot(int slot);
+
+int RenderOcclusion_AllocObjectSlot(void);
+
+void RenderOcclusion_FreeObjectSlot(int slot);
+
+void RenderOcclusion_BeginScene(bool enable);
+
+bool RenderOcclusion_IsActive(void);
+
+bool RenderOcclusion_TestBox(int slot, const TQ3BoundingBox* box);
+
+void RenderOcclusion_EndScene(void);
+
+// Sets up depth-test-only state for drawing occlusion query boxes, and restores it afterwards.
+
+void Render_BeginOcclusionQueries(void);
+
+void Render_EndOcclusionQueries(void);
@@ -115,8 +115,6 @@ short PlayEffect(int effectNum);
 short PlayEffect_Parms3D(int effectNum, TQ3Point3D *where, u_long freq, float volumeAdjust);
 extern void	ToggleMusic(void);
 extern void	DoSoundMaintenance(void);
-void LoadSoundEffect(int effectNum);
-void DisposeSoundEffect(int effectNum);
 void LoadSoundBank(int bankNum);
 void DisposeSoundBank(int bankNum);
 void DisposeAllSoundBanks(void);
@@ -0,0 +1,26 @@
+#pragma once
+
+// Spatial index over the game's ObjNodes (slots below SLOT_OF_DUMB).
+//
+// Nodes are binned by their XZ coord into a hashed grid. A node is only moved to
+// another cell when it crosses a cell boundary. Nodes whose collision boxes reach
+// further than half a cell from their coord are kept on a separate "oversize" list
+// that every query scans.
+//
+// Query results are internal scratch lists that stay valid until the next query.
+
+#define	SPATIAL_CELL_NONE		(-1)		// ObjNode.SpatialCell for nodes that aren't indexed
+
+typedef Boolean (*SpatialFilterFunc)(const ObjNode* node, void* userData);
+typedef float (*SpatialDistanceFunc)(float x1, float z1, float x2, float z2);
+
+void SpatialIndex_Reset(void);
+void SpatialIndex_Insert(ObjNode* node);
+void SpatialIndex_Remove(ObjNode* node);
+void SpatialIndex_Update(ObjNode* node);
+
+ObjNode* const* SpatialIndex_QueryBox(float left, float right, float back, float front, uint32_t ctypeMask, int* outCount);
+ObjNode* const* SpatialIndex_QueryRadius(float x, float z, float radius, uint32_t ctypeMask, int* outCount);
+int SpatialIndex_QueryNearest(float x, float z, float maxDist, uint32_t ctypeMask,
+							SpatialFilterFunc filter, void* userData, SpatialDistanceFunc distFunc,
+							int k, ObjNode** outNodes, float* outDists);
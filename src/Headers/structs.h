@@ -236,6 +236,12 @@ struct ObjNode
 
 	struct	ObjNode	*ShadowNode;		// ptr to node's shadow (if any)
 
+	struct ObjNode	*SpatialPrev;		// links in spatial index cell
+	struct ObjNode	*SpatialNext;
+	int16_t			SpatialCell;		// spatial index cell (SPATIAL_CELL_NONE if not indexed)
+	uint32_t		AttachSeq;			// attach order, to sort nodes of equal Slot back into list order
+	int16_t			OcclusionSlot;		// occlusion query slot (-1 if none allocated yet)
+
 	uint16_t		Slot;				// sort value
 	Byte			Genre;				// obj genre (skeleton, display_group, custom, event)
 	Byte			Type;				// obj type (If Genre=display_group: model# in group. If Genre is skel: skel#.)
@@ -299,6 +305,10 @@ struct ObjNode
 
 	short				EffectChannel;			// effect sound channel index (-1 = none)
 	short				ParticleGroup;
+
+	TQ3Point3D			InterpPrevTranslation;	// fixed tick: translation of BaseTransformMatrix at start of latest tick
+	TQ3Vector3D			InterpOffset;			// fixed tick: offset temporarily applied to BaseTransformMatrix while drawing
+	uint32_t			InterpTick;				// fixed tick: tick on which InterpPrevTranslation was snapshotted
 };
 typedef struct ObjNode ObjNode;
 
@@ -342,4 +352,10 @@ typedef struct
 	int		fullscreenRefreshRate;
 	int		msaa;
 	int		vsync;
+	int		fixedTickRate;		// 0 = simulate once per rendered frame
+	int		maxFPS;				// 0 = MAX_FPS
+	int		gpuFence;
+	int		shaderRenderer;
+	int		noOcclusionCulling;
+	int		terrainCacheMB;		// memory budget for supertiles kept after scrolling out (0 = off)
 } CommandLineOptions;
@@ -24,7 +24,8 @@ enum
 enum
 {
 	SUPERTILE_MODE_FREE,
-	SUPERTILE_MODE_USED
+	SUPERTILE_MODE_USED,
+	SUPERTILE_MODE_CACHED				// scrolled out of the active window but kept around in case we come back
 };
 
 		/* SUPER TILE TEXTURE LODs */
@@ -81,6 +82,7 @@ enum
 #define	SUPERTILE_DIST_WIDE		(SUPERTILE_ACTIVE_RANGE*2)
 #define	SUPERTILE_DIST_DEEP		(SUPERTILE_ACTIVE_RANGE*2)
 #define	MAX_SUPERTILES			(MAX_SUPERTILE_ACTIVE_RANGE*2 * MAX_SUPERTILE_ACTIVE_RANGE*2)
+#define	MAX_SUPERTILE_CACHE		400					// max # of extra supertiles kept alive after they scroll out (see --terrain-cache)
 
 
 #define	MAX_TERRAIN_TILES		((300*3)+1)										// 10x15 * 3pages + 1 blank/black
@@ -102,11 +104,15 @@ struct SuperTileMemoryType
 	Byte				mode;									// free, used, etc.
 	Byte				hasLOD[MAX_LODS];						// flag set when LOD exists
 	Byte				hiccupTimer;							// timer to delay drawing to avoid hiccup of texture upload
+	short				superRow,superCol;						// where this supertile sits in the scroll buffer
+	uint32_t			lastUsed;								// when it was retired to the cache (for LRU eviction)
 	TQ3Point3D			coord[MAX_LAYERS];						// world coords of supertile center (y for floor & ceiling)
 	long				left,back;								// integer coords of back/left corner
 	uint32_t			glTextureName[MAX_LAYERS][MAX_LODS];	// OpenGL texture name for floor & ceiling at all LODs
 	uint16_t*			textureData[MAX_LAYERS][MAX_LODS];		// pixel data for floor & ceiling at all LODs
 	TQ3TriMeshData*		triMeshDataPtrs[MAX_LAYERS];			// trimesh's data for the supertile (floor & ceiling)
+	TQ3TriMeshData*		farMeshDataPtrs[MAX_LAYERS];			// decimated trimesh with skirts, drawn when the supertile is far away
+	Byte				usingFarMesh[MAX_LAYERS];				// which mesh was drawn last (for hysteresis)
 	float				radius[MAX_LAYERS];						// radius of this supertile (floor & ceiling)
 };
 typedef struct SuperTileMemoryType SuperTileMemoryType;
@@ -28,4 +28,5 @@ void TextMesh_Shutdown(void);
 void TextMesh_FillDef(TextMeshDef* def);
 TQ3TriMeshData* TextMesh_CreateMesh(const TextMeshDef* def, const char* text);
 TQ3TriMeshData* TextMesh_SetMesh(const TextMeshDef* def, const char* text, TQ3TriMeshData* recycleMesh);
+void TextMesh_ForgetRecycledMesh(const TQ3TriMeshData* mesh);		// call before disposing a mesh that was passed to TextMesh_SetMesh as recycleMesh
 ObjNode* TextMesh_Create(const TextMeshDef* def, const char* text);
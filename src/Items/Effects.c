@@ -364,6 +364,8 @@ TQ3Vector3D	*delta;
 	if (!gParticleGroupsInitialized)
 		return;
 
+	PROFILE_BEGIN(Particles);
+
 	int g = Pool_First(gParticleGroupPool);
 	while (g >= 0)
 	{
@@ -581,9 +583,12 @@ nextParticle:
 			Pool_ReleaseIndex(gParticleGroupPool, g);
 		}
 
+		PROFILE_COUNT(Particles, n);
 
 		g = nextGroupIndex;
 	}
+
+	PROFILE_END(Particles);
 }
 
 
@@ -591,35 +596,60 @@ nextParticle:
 
 void DrawParticleGroup(const QD3DSetupOutputType *setupInfo)
 {
-float			baseScale;
-TQ3TriMeshData	*tm;
-TQ3Point3D		v[4],*coord;
-TQ3Matrix4x4	m;
-static const TQ3Vector3D up = {0,1,0};
-
-
-	(void) setupInfo;
-
 	if (!gParticleGroupsInitialized)
 		return;
 
-	const TQ3Point3D* camCoords = &gGameViewInfoPtr->currentCameraCoords;
+			/* BUILD BILLBOARD AXES FROM THE CAMERA BASIS */
+			//
+			// All particles face the camera's view plane, so the quad's axes are the
+			// same for every particle this frame. The original code built a look-at
+			// matrix per particle instead.
+			//
+
+	TQ3Vector3D forward, xAxis, yAxis;
+
+	FastNormalizeVector(
+			setupInfo->currentCameraLookAt.x - setupInfo->currentCameraCoords.x,
+			setupInfo->currentCameraLookAt.y - setupInfo->currentCameraCoords.y,
+			setupInfo->currentCameraLookAt.z - setupInfo->currentCameraCoords.z,
+			&forward);
+
+	Q3Vector3D_Cross(&setupInfo->currentCameraUpVector, &forward, &xAxis);	// same handedness as SetLookAtMatrixAndTranslate
+	FastNormalizeVector(xAxis.x, xAxis.y, xAxis.z, &xAxis);
+	Q3Vector3D_Cross(&forward, &xAxis, &yAxis);
+
+				/* CORNER OFFSETS FOR A UNIT-SCALE QUAD */
+				//
+				// Corners are coord +/- diag0 and coord +/- diag1, so a particle's bbox
+				// extends by scale * ext on each axis around its coord.
+				//
+
+	const TQ3Vector3D diag0 = { xAxis.x + yAxis.x, xAxis.y + yAxis.y, xAxis.z + yAxis.z };	// ( S, S)
+	const TQ3Vector3D diag1 = { xAxis.x - yAxis.x, xAxis.y - yAxis.y, xAxis.z - yAxis.z };	// ( S,-S)
+	const TQ3Vector3D ext =
+	{
+		fmaxf(fabsf(diag0.x), fabsf(diag1.x)),
+		fmaxf(fabsf(diag0.y), fabsf(diag1.y)),
+		fmaxf(fabsf(diag0.z), fabsf(diag1.z)),
+	};
 
 	for (int g = Pool_First(gParticleGroupPool); g >= 0; g = Pool_Next(gParticleGroupPool, g))
 	{
 		GAME_ASSERT(Pool_IsUsed(gParticleGroupPool, g));
 
-		float	minX,minY,minZ,maxX,maxY,maxZ;
-
 		ParticleGroupType* pg = &gParticleGroups[g];
 
-		tm = pg->mesh;									// get pointer to trimesh data
-		baseScale = pg->baseScale;						// get base scale
+		TQ3TriMeshData* tm = pg->mesh;					// get pointer to trimesh data
+		const float baseScale = pg->baseScale;			// get base scale
+
+		TQ3Point3D*		outPoints = tm->points;
+		TQ3ColorRGBA*	outColors = tm->vertexColors;
 
 					/********************************/
 					/* ADD ALL PARTICLES TO TRIMESH */
 					/********************************/
 
+		float minX,minY,minZ,maxX,maxY,maxZ;
 		minX = minY = minZ = 1e9f;						// init bbox
 		maxX = maxY = maxZ = -minX;
 
@@ -628,47 +658,44 @@ static const TQ3Vector3D up = {0,1,0};
 		{
 			GAME_ASSERT(Pool_IsUsed(pg->pool, p));
 
-					/* TRANSFORM PARTICLE POSITION */
-
-			coord = &pg->coord[p];
-			SetLookAtMatrixAndTranslate(&m, &up, coord, camCoords);
+			const TQ3Point3D c = pg->coord[p];
 
 					/* CULL PARTICLE TO AVOID OVERDRAW (SOURCE PORT ADD) */
 
-			if (!IsSphereInFrustum_XYZ(coord, 0))		// radius 0: cull somewhat aggressively
+			if (!IsSphereInFrustum_XYZ(&c, 0))			// radius 0: cull somewhat aggressively
 			{											// (use negative radius to cull even more)
 				continue;
 			}
 
-					/* TRANSFORM PARTICLE VERTICES & ADD TO TRIMESH */
+					/* EMIT QUAD CORNERS */
 
 			const float S = baseScale * pg->scale[p];
-			v[0] = (TQ3Point3D) {  S, S, 0 };
-			v[1] = (TQ3Point3D) {  S,-S, 0 };
-			v[2] = (TQ3Point3D) { -S,-S, 0 };
-			v[3] = (TQ3Point3D) { -S, S, 0 };
+			const TQ3Vector3D d0 = { S * diag0.x, S * diag0.y, S * diag0.z };
+			const TQ3Vector3D d1 = { S * diag1.x, S * diag1.y, S * diag1.z };
 
-			Q3Point3D_To3DTransformArray(&v[0], &m, &tm->points[numParticlesDrawn * 4], 4);
+			outPoints[0] = (TQ3Point3D) { c.x + d0.x, c.y + d0.y, c.z + d0.z };	// ( S, S)
+			outPoints[1] = (TQ3Point3D) { c.x + d1.x, c.y + d1.y, c.z + d1.z };	// ( S,-S)
+			outPoints[2] = (TQ3Point3D) { c.x - d0.x, c.y - d0.y, c.z - d0.z };	// (-S,-S)
+			outPoints[3] = (TQ3Point3D) { c.x - d1.x, c.y - d1.y, c.z - d1.z };	// (-S, S)
+			outPoints += 4;
 
 					/* UPDATE BBOX */
 
-			for (int i = 0; i < 4; i++)
-			{
-				const TQ3Point3D* pt = &tm->points[numParticlesDrawn * 4 + i];
-				if (pt->x < minX) minX = pt->x;
-				if (pt->x > maxX) maxX = pt->x;
-				if (pt->y < minY) minY = pt->y;
-				if (pt->y > maxY) maxY = pt->y;
-				if (pt->z < minZ) minZ = pt->z;
-				if (pt->z > maxZ) maxZ = pt->z;
-			}
+			minX = fminf(minX, c.x - S * ext.x);
+			minY = fminf(minY, c.y - S * ext.y);
+			minZ = fminf(minZ, c.z - S * ext.z);
+			maxX = fmaxf(maxX, c.x + S * ext.x);
+			maxY = fmaxf(maxY, c.y + S * ext.y);
+			maxZ = fmaxf(maxZ, c.z + S * ext.z);
 
 					/* UPDATE FACE TRANSPARENCY */
 
-			tm->vertexColors[numParticlesDrawn * 4 + 0].a = pg->alpha[p];
-			tm->vertexColors[numParticlesDrawn * 4 + 1].a = pg->alpha[p];
-			tm->vertexColors[numParticlesDrawn * 4 + 2].a = pg->alpha[p];
-			tm->vertexColors[numParticlesDrawn * 4 + 3].a = pg->alpha[p];
+			const float alpha = pg->alpha[p];
+			outColors[0].a = alpha;
+			outColors[1].a = alpha;
+			outColors[2].a = alpha;
+			outColors[3].a = alpha;
+			outColors += 4;
 
 			numParticlesDrawn++;										// inc particle count
 		}
@@ -25,6 +25,8 @@ static ObjNode *MakeOpenHiveDoor(TQ3Point3D *coord, Byte rot, Byte color);
 static void SetRootAnimTimeIndex(ObjNode *theNode);
 static void MoveHoneyTube(ObjNode *theNode);
 
+static TQ3Param2D	gHoneyTubeUVOffset = {0, 0};
+
 
 /****************************/
 /*    CONSTANTS             */
@@ -818,6 +820,8 @@ static void MoveHoneyTube(ObjNode *theNode)
 		return;
 	}
 
+	theNode->RenderModifiers.uvOffset = gHoneyTubeUVOffset;		// scroll inner tube texture (see UpdateHoneyTubeTextureAnimation)
+
 //	if (theNode->EffectChannel == -1)
 //		theNode->EffectChannel = PlayEffect_Parms3D(EFFECT_PUMP, &theNode->Coord, kMiddleC+(MyRandomLong()&3), .5);
 //	else
@@ -825,18 +829,15 @@ static void MoveHoneyTube(ObjNode *theNode)
 }
 
 
-/******************** UPDATE HONEY TUBE TEXTURE ANIMATION ************************/
+/******************** INIT HONEY TUBE TEXTURE ANIMATION ************************/
+//
+// Call once after loading the hive models.
+// Flags the inner tube meshes so the renderer applies the node's UV offset to them.
+//
 
-void UpdateHoneyTubeTextureAnimation(void)
+void InitHoneyTubeTextureAnimation(void)
 {
-	if (gLevelType != LEVEL_TYPE_HIVE)
-		return;
-
-				/* MOVE UVS */
-
-	float du = 0.0f;
-	float dv = 0.6f * gFramesPerSecondFrac;
-
+	gHoneyTubeUVOffset = (TQ3Param2D) {0, 0};
 
 	for (int type = HIVE_MObjType_BentTube; type <= HIVE_MObjType_TaperTube; type++)
 	{
@@ -847,10 +848,27 @@ void UpdateHoneyTubeTextureAnimation(void)
 		GAME_ASSERT(gObjectGroupList[MODEL_GROUP_LEVELSPECIFIC][type].numMeshes == 2);
 
 		// Mesh #0 is the lattice; Mesh #1 is the inner tube
-		QD3D_ScrollUVs(gObjectGroupList[MODEL_GROUP_LEVELSPECIFIC][type].meshes[1], du, dv);
+		gObjectGroupList[MODEL_GROUP_LEVELSPECIFIC][type].meshes[1]->texturingMode |= kQ3TexturingModeExt_UVTransformFlag;
 	}
 }
 
+
+/******************** UPDATE HONEY TUBE TEXTURE ANIMATION ************************/
+
+void UpdateHoneyTubeTextureAnimation(void)
+{
+	if (gLevelType != LEVEL_TYPE_HIVE)
+		return;
+
+				/* MOVE UVS */
+				//
+				// The offset is applied by the renderer (see MoveHoneyTube),
+				// so the tube meshes' UVs never need to be rewritten.
+				//
+
+	gHoneyTubeUVOffset.v = fmodf(gHoneyTubeUVOffset.v + 0.6f * gFramesPerSecondFrac, 1.0f);
+}
+
 #pragma mark -
 
 
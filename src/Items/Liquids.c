@@ -11,6 +11,10 @@
 
 #include "game.h"
 
+#if _MSC_VER
+#include <intrin.h>		// _BitScanForward64
+#endif
+
 
 /****************************/
 /*    PROTOTYPES            */
@@ -18,6 +22,12 @@
 
 static void DrawWaterPatch(ObjNode *theNode);
 static void DrawWaterPatchTesselated(ObjNode *theNode);
+static void BuildWaterPatch(ObjNode *theNode);
+static void BuildWaterPatchTesselated(ObjNode *theNode);
+static void BuildSolidLiquidPatchTesselated(ObjNode *theNode);
+static void SyncLiquidPatchHeight(ObjNode *theNode);
+static void RegisterLiquidPatch(ObjNode *theNode);
+static void UnregisterLiquidPatch(ObjNode *theNode);
 static void UpdateWaterTextureAnimation(void);
 static void UpdateHoneyTextureAnimation(void);
 static void UpdateSlimeTextureAnimation(void);
@@ -40,6 +50,10 @@ static void ApplyJitterToLiquidVertex(TQ3Point3D* p, int type);
 
 #define	RISING_WATER_YOFF		200.0f
 
+#define	LIQUID_GRID_DIM			32									// hashed xz grid (must be a power of 2)
+#define	LIQUID_GRID_CELL_SIZE	(2 * TERRAIN_SUPERTILE_UNIT_SIZE)
+#define	LIQUID_GRID_MASK_WORDS	((MAX_LIQUID_MESHES + 63) / 64)		// one bit per liquid mesh ID
+
 static const bool gLiquidOnThisLevel[NUM_LEVEL_TYPES][NUM_LIQUID_TYPES] =
 {
 	//								Water	Honey	Slime	Lava
@@ -81,6 +95,7 @@ const float gLiquidCollisionTopOffset[NUM_LIQUID_TYPES] =
 
 
 static TQ3TriMeshData	*gLiquidMeshPtrs[MAX_LIQUID_MESHES];
+static float			gLiquidMeshBuiltY[MAX_LIQUID_MESHES];	// patch y at which the mesh's points were built
 static int				gFreeLiquidMeshes[MAX_LIQUID_MESHES];
 static int				gNumActiveLiquidMeshes = 0;
 
@@ -88,6 +103,17 @@ static GLuint			gLiquidShaders[NUM_LIQUID_TYPES];
 static TQ3Param2D		gLiquidUVOffsets[NUM_LIQUID_TYPES];
 static TQ3Param2D		gWaterUVOffset2;		// extra uv offsets for second plane of non-tesselated water
 
+	/* LIQUID REGION INDEX */
+	//
+	// Active liquid patches, keyed by their PatchMeshID, are registered in every
+	// cell of a small hashed xz grid that their collision box overlaps.
+	// Cells wrap around, so a bit may point to a patch that's far away;
+	// the collision box check weeds those out.
+	//
+
+static ObjNode*			gLiquidPatchNodes[MAX_LIQUID_MESHES];
+static uint64_t			gLiquidGrid[LIQUID_GRID_DIM][LIQUID_GRID_DIM][LIQUID_GRID_MASK_WORDS];
+
 /****************** HELPER: DELETE TEXTURE **********************/
 
 static void DeleteTexture(GLuint* textureName)
@@ -124,6 +150,8 @@ static void DisposeLiquidMesh(ObjNode* theNode)
 	GAME_ASSERT(gNumActiveLiquidMeshes >= 0);
 	GAME_ASSERT(theNode->PatchMeshID >= 0 && theNode->PatchMeshID < MAX_LIQUID_MESHES);
 
+	UnregisterLiquidPatch(theNode);
+
 	gNumActiveLiquidMeshes--;
 	gFreeLiquidMeshes[gNumActiveLiquidMeshes] = theNode->PatchMeshID;	// put mesh back into pool
 
@@ -137,6 +165,9 @@ void InitLiquids(void)
 {
 	gNumActiveLiquidMeshes = 0;
 
+	memset(gLiquidPatchNodes, 0, sizeof(gLiquidPatchNodes));
+	memset(gLiquidGrid, 0, sizeof(gLiquidGrid));
+
 	// Initialize trimeshes
 	for (int i = 0; i < MAX_LIQUID_MESHES; i++)
 	{
@@ -198,6 +229,9 @@ void DisposeLiquids(void)
 	}
 
 	gNumActiveLiquidMeshes = 0;
+
+	memset(gLiquidPatchNodes, 0, sizeof(gLiquidPatchNodes));
+	memset(gLiquidGrid, 0, sizeof(gLiquidGrid));
 }
 
 /*************** UPDATE LIQUID ANIMATION ****************/
@@ -215,40 +249,114 @@ void UpdateLiquidAnimation(void)
 
 /***************** FIND LIQUID Y **********************/
 
-Boolean FindLiquidY(float x, float z, float* y)
+#pragma mark -
+
+/*************** LIQUID GRID HELPERS ****************/
+
+static inline int LowestBitIndex(uint64_t mask)
 {
-	ObjNode* thisNodePtr = gFirstNodePtr;
-	do
+#if _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return (int) index;
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+static inline int LiquidGridCell(float coord)
+{
+	return ((int) floorf(coord * (1.0f / LIQUID_GRID_CELL_SIZE))) & (LIQUID_GRID_DIM - 1);
+}
+
+/*************** REGISTER/UNREGISTER LIQUID PATCH ****************/
+//
+// Sets or clears the patch's bit in all grid cells covered by its collision box.
+// Patches never move horizontally, so this is done once when the patch is added.
+//
+
+static void SetLiquidPatchGridBits(ObjNode* theNode, bool set)
+{
+	const CollisionBoxType* box = &theNode->CollisionBoxes[0];
+
+	int id = theNode->PatchMeshID;
+	uint64_t bit = 1ull << (id & 63);
+	int word = id >> 6;
+
+	int numCellsX = (int) floorf(box->right * (1.0f / LIQUID_GRID_CELL_SIZE)) - (int) floorf(box->left * (1.0f / LIQUID_GRID_CELL_SIZE)) + 1;
+	int numCellsZ = (int) floorf(box->front * (1.0f / LIQUID_GRID_CELL_SIZE)) - (int) floorf(box->back * (1.0f / LIQUID_GRID_CELL_SIZE)) + 1;
+	if (numCellsX > LIQUID_GRID_DIM) numCellsX = LIQUID_GRID_DIM;
+	if (numCellsZ > LIQUID_GRID_DIM) numCellsZ = LIQUID_GRID_DIM;
+
+	int cx0 = LiquidGridCell(box->left);
+	int cz0 = LiquidGridCell(box->back);
+
+	for (int i = 0; i < numCellsZ; i++)
 	{
-		if (thisNodePtr->CType & CTYPE_LIQUID)
+		int cz = (cz0 + i) & (LIQUID_GRID_DIM - 1);
+		for (int j = 0; j < numCellsX; j++)
 		{
-			if (thisNodePtr->CollisionBoxes)
-			{
-				if (x < thisNodePtr->CollisionBoxes[0].left)
-					goto next;
-				if (x > thisNodePtr->CollisionBoxes[0].right)
-					goto next;
-				if (z > thisNodePtr->CollisionBoxes[0].front)
-					goto next;
-				if (z < thisNodePtr->CollisionBoxes[0].back)
-					goto next;
-
-				if (y)
-				{
-					*y = thisNodePtr->CollisionBoxes[0].top;
-					*y += gLiquidCollisionTopOffset[thisNodePtr->Kind];
-				}
-				return true;
-			}
-		}		
-next:					
-		thisNodePtr = (ObjNode *)thisNodePtr->NextNode;		// next node
+			int cx = (cx0 + j) & (LIQUID_GRID_DIM - 1);
+			if (set)
+				gLiquidGrid[cz][cx][word] |= bit;
+			else
+				gLiquidGrid[cz][cx][word] &= ~bit;
+		}
+	}
+}
+
+static void RegisterLiquidPatch(ObjNode* theNode)
+{
+	GAME_ASSERT(theNode->CollisionBoxes);
+	GAME_ASSERT(!gLiquidPatchNodes[theNode->PatchMeshID]);
+
+	gLiquidPatchNodes[theNode->PatchMeshID] = theNode;
+	SetLiquidPatchGridBits(theNode, true);
+}
+
+static void UnregisterLiquidPatch(ObjNode* theNode)
+{
+	GAME_ASSERT(gLiquidPatchNodes[theNode->PatchMeshID] == theNode);
+
+	SetLiquidPatchGridBits(theNode, false);
+	gLiquidPatchNodes[theNode->PatchMeshID] = nil;
+}
+
+/*************** FIND LIQUID Y ****************/
+//
+// Returns true if (x,z) is inside a liquid patch, and optionally the y coord of the liquid's surface.
+//
+
+static bool FindLiquidYInCell(const uint64_t* cellMask, float x, float z, float* y)
+{
+	for (int word = 0; word < LIQUID_GRID_MASK_WORDS; word++)
+	{
+		uint64_t mask = cellMask[word];
+		while (mask)
+		{
+			int id = (word << 6) + LowestBitIndex(mask);
+			mask &= mask - 1;
+
+			const ObjNode* liquid = gLiquidPatchNodes[id];
+			const CollisionBoxType* box = &liquid->CollisionBoxes[0];
+
+			if (x < box->left || x > box->right || z > box->front || z < box->back)
+				continue;
+
+			if (y)
+				*y = box->top + gLiquidCollisionTopOffset[liquid->Kind];
+			return true;
+		}
 	}
-	while (thisNodePtr != nil);
 
 	return false;
 }
 
+Boolean FindLiquidY(float x, float z, float* y)
+{
+	return FindLiquidYInCell(gLiquidGrid[LiquidGridCell(z)][LiquidGridCell(x)], x, z, y);
+}
+
 
 #pragma mark -
 
@@ -406,6 +514,8 @@ static const float	yTable2[] = {-540,-540,-540,-540,-370,-540,-540,-540};
 							depth*.5f * TERRAIN_POLYGON_SIZE,
 							-(depth*.5f) * TERRAIN_POLYGON_SIZE);
 
+	RegisterLiquidPatch(newObj);
+
 			/* SET MESH PROPERTIES */
 
 	TQ3TriMeshData* tmd = gLiquidMeshPtrs[newObj->PatchMeshID];
@@ -418,8 +528,21 @@ static const float	yTable2[] = {-540,-540,-540,-540,-370,-540,-540,-540};
 		tmd->diffuseColor.a = .7f;
 
 	tmd->texturingMode = kQ3TexturingModeAlphaBlend;
+	if (tesselateFlag)
+		tmd->texturingMode |= kQ3TexturingModeExt_UVTransformFlag;	// UVs scrolled by renderer
 	tmd->glTextureName = gLiquidShaders[LIQUID_WATER];
 
+			/* BUILD GEOMETRY ONCE */
+			//
+			// The patch never moves horizontally and the vertex jitter only depends on
+			// the vertex's position, so the mesh is static save for rising water.
+			//
+
+	if (tesselateFlag)
+		BuildWaterPatchTesselated(newObj);
+	else
+		BuildWaterPatch(newObj);
+
 	return(true);													// item was added
 }
 
@@ -473,12 +596,83 @@ static void UpdateWaterTextureAnimation(void)
 }
 
 
+/******************* SYNC LIQUID PATCH HEIGHT *********************/
+//
+// Liquid patch meshes are built once when the patch is added.
+// The only thing that can move afterwards is the y coord (anthill water rising
+// when a valve opens), so just shift the existing points.
+//
+
+static void SyncLiquidPatchHeight(ObjNode *theNode)
+{
+	TQ3TriMeshData* tmd = gLiquidMeshPtrs[theNode->PatchMeshID];
+
+	float dy = theNode->Coord.y - gLiquidMeshBuiltY[theNode->PatchMeshID];
+	if (dy == 0.0f)
+		return;
+
+	TQ3Point3D* p = tmd->points;
+	for (int i = 0; i < tmd->numPoints; i++)
+		p[i].y += dy;
+
+	tmd->bBox.min.y += dy;
+	tmd->bBox.max.y += dy;
+
+	gLiquidMeshBuiltY[theNode->PatchMeshID] = theNode->Coord.y;
+}
+
+
 /********************* DRAW WATER PATCH **********************/
 //
 // This is the simple version which just draws a giant quad
 //
 
 static void DrawWaterPatch(ObjNode *theNode)
+{
+	TQ3TriMeshData* tmd = gLiquidMeshPtrs[theNode->PatchMeshID];
+
+	SyncLiquidPatchHeight(theNode);
+
+		/* SET VERTEX UVS */
+		//
+		// This mesh scrolls two layers in opposite directions, so it can't use
+		// the renderer's UV transform. Only the UVs are rewritten each frame.
+		//
+
+	float patchW = theNode->PatchWidth;
+	float patchD = theNode->PatchDepth;
+
+	const TQ3Param2D scroll = gLiquidUVOffsets[LIQUID_WATER];
+
+	tmd->vertexUVs[0].u = scroll.u;
+	tmd->vertexUVs[0].v = scroll.v + patchD*(1.0/2.0);
+	tmd->vertexUVs[1].u = scroll.u;
+	tmd->vertexUVs[1].v = scroll.v;
+	tmd->vertexUVs[2].u = scroll.u + patchW*(1.0/2.0);
+	tmd->vertexUVs[2].v = scroll.v;
+	tmd->vertexUVs[3].u = scroll.u + patchW*(1.0/2.0);
+	tmd->vertexUVs[3].v = scroll.v + patchD*(1.0/2.0);
+
+	tmd->vertexUVs[4].u = gWaterUVOffset2.u;
+	tmd->vertexUVs[4].v = gWaterUVOffset2.v + patchD * (1.0 / 3.0);
+	tmd->vertexUVs[5].u = gWaterUVOffset2.u;
+	tmd->vertexUVs[5].v = gWaterUVOffset2.v;
+	tmd->vertexUVs[6].u = gWaterUVOffset2.u + patchW * (1.0 / 3.0);
+	tmd->vertexUVs[6].v = gWaterUVOffset2.v;
+	tmd->vertexUVs[7].u = gWaterUVOffset2.u + patchW * (1.0 / 3.0);
+	tmd->vertexUVs[7].v = gWaterUVOffset2.v + patchD * (1.0 / 3.0);
+
+			/*************/
+			/* SUBMIT IT */
+			/*************/
+
+	Render_SubmitMesh(tmd, nil, &theNode->RenderModifiers, &theNode->Coord);
+}
+
+
+/********************* BUILD WATER PATCH **********************/
+
+static void BuildWaterPatch(ObjNode *theNode)
 {
 float			patchW,patchD;
 float			x,y,z,left,back, right, front;
@@ -572,42 +766,27 @@ TQ3Point3D		*p;
 	tmd->bBox.max.z = front;
 	tmd->bBox.isEmpty = false;
 
+	gLiquidMeshBuiltY[theNode->PatchMeshID] = y;
+}
 
-		/* SET VERTEX UVS */
-
-	const TQ3Param2D scroll = gLiquidUVOffsets[LIQUID_WATER];
-
-	tmd->vertexUVs[0].u = scroll.u;
-	tmd->vertexUVs[0].v = scroll.v + patchD*(1.0/2.0);
-	tmd->vertexUVs[1].u = scroll.u;
-	tmd->vertexUVs[1].v = scroll.v;
-	tmd->vertexUVs[2].u = scroll.u + patchW*(1.0/2.0);
-	tmd->vertexUVs[2].v = scroll.v;
-	tmd->vertexUVs[3].u = scroll.u + patchW*(1.0/2.0);
-	tmd->vertexUVs[3].v = scroll.v + patchD*(1.0/2.0);
+/********************* DRAW WATER PATCH TESSELATED **********************/
 
-	tmd->vertexUVs[4].u = gWaterUVOffset2.u;
-	tmd->vertexUVs[4].v = gWaterUVOffset2.v + patchD * (1.0 / 3.0);
-	tmd->vertexUVs[5].u = gWaterUVOffset2.u;
-	tmd->vertexUVs[5].v = gWaterUVOffset2.v;
-	tmd->vertexUVs[6].u = gWaterUVOffset2.u + patchW * (1.0 / 3.0);
-	tmd->vertexUVs[6].v = gWaterUVOffset2.v;
-	tmd->vertexUVs[7].u = gWaterUVOffset2.u + patchW * (1.0 / 3.0);
-	tmd->vertexUVs[7].v = gWaterUVOffset2.v + patchD * (1.0 / 3.0);
+static void DrawWaterPatchTesselated(ObjNode *theNode)
+{
+	SyncLiquidPatchHeight(theNode);
 
-			/*************/
-			/* SUBMIT IT */
-			/*************/
+	theNode->RenderModifiers.uvOffset = gLiquidUVOffsets[LIQUID_WATER];		// scrolled by renderer
 
-	Render_SubmitMesh(tmd, nil, &theNode->RenderModifiers, &theNode->Coord);
+	Render_SubmitMesh(gLiquidMeshPtrs[theNode->PatchMeshID], nil, &theNode->RenderModifiers, &theNode->Coord);
 }
 
-/********************* DRAW WATER PATCH TESSELATED **********************/
+
+/********************* BUILD WATER PATCH TESSELATED **********************/
 //
 // This version tesselates the water patch so fog will look better on it.
 //
 
-static void DrawWaterPatchTesselated(ObjNode *theNode)
+static void BuildWaterPatchTesselated(ObjNode *theNode)
 {
 float			x,y,z,left,back, right, front;
 float			u,v;
@@ -622,8 +801,6 @@ TQ3TriMeshTriangleData	*t;
 
 	TQ3TriMeshData* tmd = gLiquidMeshPtrs[theNode->PatchMeshID];
 
-	const TQ3Param2D uvScroll = gLiquidUVOffsets[LIQUID_WATER];
-
 			/************************/
 			/* CALC BOUNDS OF WATER */
 			/************************/
@@ -680,8 +857,8 @@ TQ3TriMeshTriangleData	*t;
 
 				/* SET UV */
 
-			tmd->vertexUVs[i].u = uvScroll.u + u;
-			tmd->vertexUVs[i].v = uvScroll.v + v;
+			tmd->vertexUVs[i].u = u;
+			tmd->vertexUVs[i].v = v;
 
 			i++;
 			x += TERRAIN_POLYGON_SIZE*2.0f;	
@@ -733,12 +910,7 @@ TQ3TriMeshTriangleData	*t;
 	}
 	tmd->numTriangles = i;						// set # triangles in geometry
 
-
-			/*************/
-			/* SUBMIT IT */
-			/*************/
-
-	Render_SubmitMesh(tmd, nil, &theNode->RenderModifiers, &theNode->Coord);
+	gLiquidMeshBuiltY[theNode->PatchMeshID] = theNode->Coord.y;
 }
 
 
@@ -896,24 +1068,41 @@ float				width,depth;
 							(depth*.5f) * TERRAIN_POLYGON_SIZE,
 							-(depth*.5f) * TERRAIN_POLYGON_SIZE);
 
+	RegisterLiquidPatch(newObj);
+
 			/* SET MESH PROPERTIES */
 
 	TQ3TriMeshData* tmd = gLiquidMeshPtrs[newObj->PatchMeshID];
 
 	tmd->diffuseColor.a = 1.0f;
-	tmd->texturingMode = kQ3TexturingModeOpaque;
+	tmd->texturingMode = kQ3TexturingModeOpaque | kQ3TexturingModeExt_UVTransformFlag;	// UVs scrolled by renderer
 	tmd->glTextureName = gLiquidShaders[kind];
 
+			/* BUILD GEOMETRY ONCE */
+
+	BuildSolidLiquidPatchTesselated(newObj);
 
 	return(true);													// item was added
 }
 
 /********************* DRAW LIQUID PATCH TESSELATED **********************/
+
+static void DrawSolidLiquidPatchTesselated(ObjNode *theNode)
+{
+	SyncLiquidPatchHeight(theNode);
+
+	theNode->RenderModifiers.uvOffset = gLiquidUVOffsets[theNode->Kind];		// scrolled by renderer
+
+	Render_SubmitMesh(gLiquidMeshPtrs[theNode->PatchMeshID], nil, &theNode->RenderModifiers, &theNode->Coord);
+}
+
+
+/********************* BUILD LIQUID PATCH TESSELATED **********************/
 //
 // This version tesselates the water patch so fog will look better on it.
 //
 
-static void DrawSolidLiquidPatchTesselated(ObjNode *theNode)
+static void BuildSolidLiquidPatchTesselated(ObjNode *theNode)
 {
 float			x,y,z,left,back, right, front;
 float			u,v;
@@ -928,8 +1117,6 @@ TQ3TriMeshTriangleData	*t;
 
 	TQ3TriMeshData* tmd = gLiquidMeshPtrs[theNode->PatchMeshID];
 
-	const TQ3Param2D uvOffset = gLiquidUVOffsets[theNode->Kind];
-
 			/*************************/
 			/* CALC BOUNDS OF LIQUID */
 			/*************************/
@@ -983,8 +1170,8 @@ TQ3TriMeshTriangleData	*t;
 
 				/* SET UV */
 
-			tmd->vertexUVs[i].u = uvOffset.u + u;
-			tmd->vertexUVs[i].v = uvOffset.v + v;
+			tmd->vertexUVs[i].u = u;
+			tmd->vertexUVs[i].v = v;
 
 			i++;
 			x += TERRAIN_POLYGON_SIZE;
@@ -1035,12 +1222,7 @@ TQ3TriMeshTriangleData	*t;
 	}
 	tmd->numTriangles = i;						// set # triangles in geometry
 
-
-			/*************/
-			/* SUBMIT IT */
-			/*************/
-
-	Render_SubmitMesh(tmd, nil, &theNode->RenderModifiers, &theNode->Coord);
+	gLiquidMeshBuiltY[theNode->PatchMeshID] = theNode->Coord.y;
 }
 
 
@@ -1261,36 +1261,12 @@ int			i;
 
 static void	AimAtClosestKickableObject(void)
 {
-ObjNode	*closest,*thisNodePtr;
-float	minDist,dist,myX,myZ;
-
-			/************************/
-			/* SCAN OBJ LINKED LIST */
-			/************************/
-			
-	thisNodePtr = gFirstNodePtr;
-	myX = gCoord.x;
-	myZ = gCoord.z;
-	minDist = 10000000;
-	closest = nil;
-	
-	while(thisNodePtr)
-	{
-		if (thisNodePtr->CType & CTYPE_KICKABLE)
-		{			
-			dist = CalcDistance(myX, myZ, thisNodePtr->Coord.x, thisNodePtr->Coord.z);	// calc dist to this obj
-			if (dist < minDist)
-			{
-				minDist = dist;
-				closest = thisNodePtr;
-			}	
-		}
-		thisNodePtr = thisNodePtr->NextNode;
-	}
+ObjNode	*closest;
+float	minDist;
 
 				/* SEE IF ANYTHING CLOSE ENOUGH */
 				
-	if (minDist < 300.0f)
+	if (SpatialIndex_QueryNearest(gCoord.x, gCoord.z, 300.0f, CTYPE_KICKABLE, nil, nil, CalcDistance, 1, &closest, &minDist))
 	{		
 		TurnObjectTowardTarget(gPlayerObj, &gCoord, closest->Coord.x, closest->Coord.z,	9.0, false);			
 	}
@@ -1299,42 +1275,32 @@ float	minDist,dist,myX,myZ;
 
 /******************** AIM AT CLOSEST BOPPABLE OBJECT **********************/
 
+static Boolean IsBelowPlayer(const ObjNode* theNode, void* userData)
+{
+	float myY = *(const float*) userData;
+	return myY > (theNode->Coord.y - theNode->BoundingSphere.radius);		// player must be above it
+}
+
 static void	AimAtClosestBoppableObject(void)
 {
-ObjNode	*closest,*thisNodePtr;
+ObjNode	*closest;
 u_long	closestCType;
-float	minDist,dist,myX,myZ,myY;
+float	minDist,myY;
 
-			/************************/
-			/* SCAN OBJ LINKED LIST */
-			/************************/
+			/***********************/
+			/* FIND NEAREST TARGET */
+			/***********************/
 			
-	thisNodePtr = gFirstNodePtr;
-	myX = gCoord.x;
 	myY = gCoord.y + gPlayerObj->TopOff;
-	myZ = gCoord.z;
-	minDist = 10000000;
-	closest = nil;
-	closestCType = 0;
-	
-	while(thisNodePtr)
+
+	if (!SpatialIndex_QueryNearest(gCoord.x, gCoord.z, 290.0f, CTYPE_AUTOTARGET, IsBelowPlayer, &myY, CalcQuickDistance,
+								1, &closest, &minDist))
 	{
-		if (thisNodePtr->CType & CTYPE_AUTOTARGET)
-		{
-			if (myY > (thisNodePtr->Coord.y - thisNodePtr->BoundingSphere.radius))				// player must be above it
-			{
-				dist = CalcQuickDistance(myX, myZ, thisNodePtr->Coord.x, thisNodePtr->Coord.z);	// calc dist to this obj
-				if (dist < minDist)
-				{
-					minDist = dist;
-					closest = thisNodePtr;
-					closestCType = thisNodePtr->CType;
-				}	
-			}
-		}
-		thisNodePtr = thisNodePtr->NextNode;
+		return;
 	}
 
+	closestCType = closest->CType;
+
 				/********************************/
 				/* SEE IF ANYTHING CLOSE ENOUGH */
 				/********************************/
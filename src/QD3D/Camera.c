@@ -30,6 +30,8 @@ static void InitLensFlares(void);
 #define	CAMERA_CLOSEST		150.0f
 #define	CAMERA_FARTHEST		800.0f
 
+#define	CAMERA_INTERP_MAX_DIST	400.0f
+
 #define	NUM_FLARE_TYPES		4
 #define	NUM_FLARES			6
 
@@ -53,6 +55,9 @@ float				gPlayerToCameraAngle = 0.0f;
 
 static TQ3Point3D 	gTargetTo,gTargetFrom;
 
+static TQ3Point3D	gInterpPrevCameraFrom, gInterpPrevCameraTo;		// fixed tick: camera at start of latest tick
+static TQ3Point3D	gInterpSavedCameraFrom, gInterpSavedCameraTo;	// fixed tick: real camera while drawing interpolated frame
+
 static bool			gLensFlaresInitialized = false;
 static GLuint		gLensFlareTextureNames[NUM_FLARE_TYPES] = {0,0,0,0};
 static GLuint		gMoonFlareTextureName = 0;
@@ -291,6 +296,43 @@ float	fps = gFramesPerSecondFrac;
 }
 
 
+/******************** SNAPSHOT/INTERPOLATE CAMERA ***********************/
+//
+// Fixed-tick mode counterparts of SnapshotObjectTransforms & co.
+//
+
+void SnapshotCameraTransform(void)
+{
+	gInterpPrevCameraFrom	= gGameViewInfoPtr->currentCameraCoords;
+	gInterpPrevCameraTo		= gGameViewInfoPtr->currentCameraLookAt;
+}
+
+void ApplyCameraInterpolation(float alpha)
+{
+	TQ3Point3D* from	= &gGameViewInfoPtr->currentCameraCoords;
+	TQ3Point3D* to		= &gGameViewInfoPtr->currentCameraLookAt;
+
+	gInterpSavedCameraFrom	= *from;
+	gInterpSavedCameraTo	= *to;
+
+	if (Q3Point3D_DistanceSquared(&gInterpPrevCameraFrom, from) > CAMERA_INTERP_MAX_DIST*CAMERA_INTERP_MAX_DIST)	// camera was snapped to a new spot
+		return;
+
+	from->x	= gInterpPrevCameraFrom.x	+ (from->x	- gInterpPrevCameraFrom.x)	* alpha;
+	from->y	= gInterpPrevCameraFrom.y	+ (from->y	- gInterpPrevCameraFrom.y)	* alpha;
+	from->z	= gInterpPrevCameraFrom.z	+ (from->z	- gInterpPrevCameraFrom.z)	* alpha;
+	to->x	= gInterpPrevCameraTo.x		+ (to->x	- gInterpPrevCameraTo.x)	* alpha;
+	to->y	= gInterpPrevCameraTo.y		+ (to->y	- gInterpPrevCameraTo.y)	* alpha;
+	to->z	= gInterpPrevCameraTo.z		+ (to->z	- gInterpPrevCameraTo.z)	* alpha;
+}
+
+void RestoreCameraInterpolation(void)
+{
+	gGameViewInfoPtr->currentCameraCoords	= gInterpSavedCameraFrom;
+	gGameViewInfoPtr->currentCameraLookAt	= gInterpSavedCameraTo;
+}
+
+
 /********************** FILL PROJECTION MATRIX ************************/
 //
 // Equivalent to gluPerspective
@@ -500,22 +542,12 @@ float		fps = gFramesPerSecondFrac;
 	if (distZ < -500.0f)
 		distZ = -500.0f;
 	
-	distX = distX * (fps * gCameraFromAccel);
-	distZ = distZ * (fps * gCameraFromAccel);
-
-			/* SEE IF GOING TO CRASH SCROLL CODE */
+	float ease = fps * gCameraFromAccel;
+	if (ease > 1.0f)										// on a long frame, don't overshoot the target
+		ease = 1.0f;										// (the terrain scroll code copes with multi-supertile moves)
 
-	if (distX > TERRAIN_SUPERTILE_UNIT_SIZE)
-		distX = TERRAIN_SUPERTILE_UNIT_SIZE;
-	else
-	if (distX < -TERRAIN_SUPERTILE_UNIT_SIZE)
-		distX = -TERRAIN_SUPERTILE_UNIT_SIZE;
-
-	if (distZ > TERRAIN_SUPERTILE_UNIT_SIZE)
-		distZ = TERRAIN_SUPERTILE_UNIT_SIZE;
-	else
-	if (distZ < -TERRAIN_SUPERTILE_UNIT_SIZE)
-		distZ = -TERRAIN_SUPERTILE_UNIT_SIZE;	
+	distX = distX * ease;
+	distZ = distZ * ease;
 	
 	from.x = gGameViewInfoPtr->currentCameraCoords.x+distX;
 	from.y = gGameViewInfoPtr->currentCameraCoords.y;  // from.y mustn't be NaN for matrix transform in cam swivel below -- actual Y computed later
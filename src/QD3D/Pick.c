@@ -5,10 +5,40 @@
 #include "game.h"
 
 #define MAX_TRANSFORMED_POINTS 1024
+#define MAX_PICK_CACHE_ENTRIES 128
 
 // Set to 1 to debug pickable quads
 #define DRAW_PICKABLE_QUADS 0
 
+//
+// Each pickable node's points are kept in frustum space, along with their 2D
+// bounding rectangle and nearest depth. An entry is only recomputed when the
+// camera or the node's transform changes, so polling PickObject every frame
+// is cheap.
+//
+
+typedef struct
+{
+	ObjNode*		node;
+	uint32_t		attachSeq;					// tells a recycled ObjNode apart from the one we cached
+	TQ3Matrix4x4	baseTransform;				// node transform the points were computed with
+	TQ3Point3D*		points;						// all meshes' points, in frustum space
+	int				numPoints;
+	float			left, right, bottom, top;	// 2D bounds of points
+	float			nearZ;
+	bool			seen;
+} PickCacheEntry;
+
+typedef struct
+{
+	PickCacheEntry*	entry;
+	float			nearZ;
+} PickCandidate;
+
+static PickCacheEntry	gPickCache[MAX_PICK_CACHE_ENTRIES];
+static int				gNumPickCacheEntries = 0;
+static TQ3Matrix4x4		gPickCacheCameraMatrix;		// gCameraWorldToFrustumMatrix the cache is valid for
+
 /********** CREATE CLICKABLE RECTANGULAR OBJNODE **********/
 
 ObjNode* NewPickableQuad(TQ3Point3D coord, float width, float height, int32_t pickID)
@@ -51,6 +81,125 @@ void DisposePickableObjects(void)
 			DeleteObject(node);
 		node = nextNode;
 	}
+
+	FlushPickCache();
+}
+
+/********** FLUSH PICK CACHE **********/
+
+void FlushPickCache(void)
+{
+	for (int i = 0; i < gNumPickCacheEntries; i++)
+	{
+		if (gPickCache[i].points)
+			DisposePtr((Ptr) gPickCache[i].points);
+	}
+
+	memset(gPickCache, 0, sizeof(gPickCache));
+	gNumPickCacheEntries = 0;
+}
+
+/********** TRANSFORM PICKABLE NODE INTO FRUSTUM SPACE **********/
+
+static void UpdatePickCacheEntry(PickCacheEntry* entry, ObjNode* node)
+{
+	int numPoints = 0;
+	for (int meshID = 0; meshID < node->NumMeshes; meshID++)
+		numPoints += node->MeshList[meshID]->numPoints;
+
+	GAME_ASSERT(numPoints <= MAX_TRANSFORMED_POINTS);
+
+	if (!entry->points || entry->numPoints != numPoints)
+	{
+		if (entry->points)
+			DisposePtr((Ptr) entry->points);
+		entry->points = (TQ3Point3D*) NewPtr(sizeof(TQ3Point3D) * (numPoints > 0 ? numPoints : 1));
+		GAME_ASSERT(entry->points);
+	}
+
+	entry->node				= node;
+	entry->attachSeq		= node->AttachSeq;
+	entry->baseTransform	= node->BaseTransformMatrix;
+	entry->numPoints		= numPoints;
+
+	TQ3Matrix4x4 nodeTransform;
+	Q3Matrix4x4_Multiply(&node->BaseTransformMatrix, &gCameraWorldToFrustumMatrix, &nodeTransform);
+
+	TQ3Point3D* p = entry->points;
+	for (int meshID = 0; meshID < node->NumMeshes; meshID++)
+	{
+		const TQ3TriMeshData* mesh = node->MeshList[meshID];
+		Q3Point3D_To3DTransformArray(mesh->points, &nodeTransform, p, mesh->numPoints);
+		p += mesh->numPoints;
+	}
+
+			/* 2D BOUNDS & NEAREST DEPTH */
+
+	entry->left = entry->bottom = entry->nearZ = FLT_MAX;
+	entry->right = entry->top = -FLT_MAX;
+
+	for (int i = 0; i < numPoints; i++)
+	{
+		const TQ3Point3D* pt = &entry->points[i];
+		if (pt->x < entry->left)	entry->left = pt->x;
+		if (pt->x > entry->right)	entry->right = pt->x;
+		if (pt->y < entry->bottom)	entry->bottom = pt->y;
+		if (pt->y > entry->top)		entry->top = pt->y;
+		if (pt->z < entry->nearZ)	entry->nearZ = pt->z;
+	}
+}
+
+/********** FIND OR MAKE PICK CACHE ENTRY FOR NODE **********/
+
+static PickCacheEntry* GetPickCacheEntry(ObjNode* node)
+{
+	PickCacheEntry* entry = nil;
+
+	for (int i = 0; i < gNumPickCacheEntries; i++)
+	{
+		if (gPickCache[i].node == node && gPickCache[i].attachSeq == node->AttachSeq)
+		{
+			entry = &gPickCache[i];
+			break;
+		}
+	}
+
+	if (!entry)
+	{
+		GAME_ASSERT_MESSAGE(gNumPickCacheEntries < MAX_PICK_CACHE_ENTRIES, "too many pickable objects");
+		entry = &gPickCache[gNumPickCacheEntries++];
+		UpdatePickCacheEntry(entry, node);
+	}
+	else if (0 != memcmp(&entry->baseTransform, &node->BaseTransformMatrix, sizeof(TQ3Matrix4x4)))
+	{
+		UpdatePickCacheEntry(entry, node);
+	}
+
+	entry->seen = true;
+	return entry;
+}
+
+/********** DROP ENTRIES FOR NODES THAT ARE GONE **********/
+
+static void PrunePickCache(void)
+{
+	int n = 0;
+
+	for (int i = 0; i < gNumPickCacheEntries; i++)
+	{
+		if (gPickCache[i].seen)
+		{
+			gPickCache[i].seen = false;
+			gPickCache[n++] = gPickCache[i];
+		}
+		else if (gPickCache[i].points)
+		{
+			DisposePtr((Ptr) gPickCache[i].points);
+		}
+	}
+
+	memset(&gPickCache[n], 0, sizeof(PickCacheEntry) * (gNumPickCacheEntries - n));
+	gNumPickCacheEntries = n;
 }
 
 /******************** PICK OBJECT ********************/
@@ -63,26 +212,59 @@ void DisposePickableObjects(void)
 
 bool PickObject(int mouseX, int mouseY, int32_t *pickID)
 {
-	TQ3Point3D transformedPoints[MAX_TRANSFORMED_POINTS];
+	PickCandidate candidates[MAX_PICK_CACHE_ENTRIES];
+	int numCandidates = 0;
 
 	TQ3Point3D mouse = {mouseX, mouseY, 0};
 	Q3Point3D_Transform(&mouse, &gWindowToFrustum, &mouse);
 
+			/* CAMERA MOVED: EVERYTHING MUST BE RETRANSFORMED */
+
+	if (0 != memcmp(&gPickCacheCameraMatrix, &gCameraWorldToFrustumMatrix, sizeof(TQ3Matrix4x4)))
+	{
+		FlushPickCache();
+		gPickCacheCameraMatrix = gCameraWorldToFrustumMatrix;
+	}
+
+			/* GATHER NODES WHOSE 2D BOUNDS CONTAIN THE MOUSE */
+
 	for (ObjNode* node = gFirstNodePtr; node; node = node->NextNode)
 	{
 		if (!node->IsPickable)
 			continue;
 
-		TQ3Matrix4x4 nodeTransform;
-		Q3Matrix4x4_Multiply(&node->BaseTransformMatrix, &gCameraWorldToFrustumMatrix, &nodeTransform);
+		PickCacheEntry* entry = GetPickCacheEntry(node);
 
-		for (int meshID = 0; meshID < node->NumMeshes; meshID++)
+		if (mouse.x < entry->left || mouse.x > entry->right
+			|| mouse.y < entry->bottom || mouse.y > entry->top)
 		{
-			const TQ3TriMeshData* mesh = node->MeshList[meshID];
+			continue;
+		}
+
+				/* INSERT FRONT-TO-BACK (STABLE, SO TIES KEEP LIST ORDER) */
+
+		int i = numCandidates++;
+		while (i > 0 && candidates[i-1].nearZ > entry->nearZ)
+		{
+			candidates[i] = candidates[i-1];
+			i--;
+		}
+		candidates[i] = (PickCandidate) { .entry = entry, .nearZ = entry->nearZ };
+	}
+
+			/* TEST TRIANGLES, NEAREST NODE FIRST */
 
-			GAME_ASSERT(mesh->numPoints <= MAX_TRANSFORMED_POINTS);
+	bool found = false;
+
+	for (int c = 0; c < numCandidates && !found; c++)
+	{
+		const PickCacheEntry* entry = candidates[c].entry;
+		const ObjNode* node = entry->node;
+		const TQ3Point3D* transformedPoints = entry->points;
 
-			Q3Point3D_To3DTransformArray(mesh->points, &nodeTransform, transformedPoints, mesh->numPoints);
+		for (int meshID = 0; meshID < node->NumMeshes && !found; meshID++)
+		{
+			const TQ3TriMeshData* mesh = node->MeshList[meshID];
 
 			for (int t = 0; t < mesh->numTriangles; t++)
 			{
@@ -93,12 +275,16 @@ bool PickObject(int mouseX, int mouseY, int32_t *pickID)
 				if (IsPointInTriangle(mouse.x, mouse.y, p0->x, p0->y, p1->x, p1->y, p2->x, p2->y))
 				{
 					*pickID = node->PickID;
-					return true;
+					found = true;
+					break;
 				}
 			}
+
+			transformedPoints += mesh->numPoints;
 		}
 	}
 
-	return false;
-}
+	PrunePickCache();									// candidates point into the cache, so prune last
 
+	return found;
+}
@@ -24,6 +24,8 @@ static void ExplodeTriMesh(
 		Byte shardMode,
 		int shardDensity,
 		float shardDecaySpeed);
+static int AcquireShardBatch(const TQ3TriMeshData* inMesh);
+static void ReleaseShard(int i);
 
 
 /****************************/
@@ -38,11 +40,56 @@ static const TQ3Matrix4x4 kIdentity4x4 =
 	{0, 0, 0, 1},
 }};
 
+/*********************/
+/*    TYPES          */
+/*********************/
+
+		/* SHARDS */
+		//
+		// Shards are stored as a structure of arrays, indexed by gShardPool index.
+		// Each shard keeps its 3 vertices around its center in local space;
+		// QD3D_DrawShards transforms them to world space and appends them to
+		// the dynamic mesh of the shard's batch.
+		//
+
+typedef struct
+{
+	TQ3Point3D				localPoints[MAX_SHARDS][3];
+	TQ3Vector3D				localNormals[MAX_SHARDS][3];
+	TQ3Param2D				uvs[MAX_SHARDS][3];
+	TQ3ColorRGBA			colors[MAX_SHARDS][3];
+
+	TQ3Point3D				coord[MAX_SHARDS];
+	TQ3Vector3D				coordDelta[MAX_SHARDS];
+	TQ3Vector3D				rot[MAX_SHARDS];
+	TQ3Vector3D				rotDelta[MAX_SHARDS];
+	float					scale[MAX_SHARDS];
+	float					decaySpeed[MAX_SHARDS];
+	Byte					mode[MAX_SHARDS];
+	Byte					batch[MAX_SHARDS];
+}ShardArrays;
+
+		/* SHARD BATCHES */
+		//
+		// All live shards that share a texture & material are drawn as a single mesh.
+		//
+
+typedef struct
+{
+	int						numShards;			// live shards referencing this batch (0 = free)
+	GLuint					glTextureName;
+	TQ3TexturingMode		texturingMode;
+	bool					transparent;
+	TQ3TriMeshData			*mesh;				// world-space triangles, rebuilt by QD3D_DrawShards
+}ShardBatch;
+
+
 /*********************/
 /*    VARIABLES      */
 /*********************/
 
-static ShardType			gShards[MAX_SHARDS];
+static ShardArrays			gShards;
+static ShardBatch			gShardBatches[MAX_SHARD_BATCHES];
 static RenderModifiers		kShardRenderMods;
 Pool						*gShardPool = NULL;
 
@@ -152,12 +199,22 @@ void QD3D_InitShards(void)
 	else
 		Pool_Reset(gShardPool);
 
-	for (int i = 0; i < MAX_SHARDS; i++)
+	for (int b = 0; b < MAX_SHARD_BATCHES; b++)
 	{
-		ShardType* shard = &gShards[i];
-		shard->mesh = Q3TriMeshData_New(1, 3, kQ3TriMeshDataFeatureVertexUVs | kQ3TriMeshDataFeatureVertexNormals);
-		for (int v = 0; v < 3; v++)
-			shard->mesh->triangles[0].pointIndices[v] = v;
+		ShardBatch* batch = &gShardBatches[b];
+		batch->numShards = 0;
+
+		if (!batch->mesh)
+		{
+			batch->mesh = Q3TriMeshData_New(MAX_SHARDS, MAX_SHARDS * 3,
+					kQ3TriMeshDataFeatureVertexUVs | kQ3TriMeshDataFeatureVertexNormals | kQ3TriMeshDataFeatureVertexColors);
+
+			for (int t = 0; t < MAX_SHARDS; t++)							// triangles never change, only their vertices
+			{
+				for (int v = 0; v < 3; v++)
+					batch->mesh->triangles[t].pointIndices[v] = t * 3 + v;
+			}
+		}
 	}
 
 	Render_SetDefaultModifiers(&kShardRenderMods);
@@ -170,14 +227,15 @@ void QD3D_InitShards(void)
 
 void QD3D_DisposeShards(void)
 {
-	for (int i = 0; i < MAX_SHARDS; i++)
+	for (int b = 0; b < MAX_SHARD_BATCHES; b++)
 	{
-		ShardType* shard = &gShards[i];
-		if (shard->mesh)
+		ShardBatch* batch = &gShardBatches[b];
+		if (batch->mesh)
 		{
-			Q3TriMeshData_Dispose(shard->mesh);
-			shard->mesh = NULL;
+			Q3TriMeshData_Dispose(batch->mesh);
+			batch->mesh = NULL;
 		}
+		batch->numShards = 0;
 	}
 
 	Pool_Free(gShardPool);
@@ -266,119 +324,190 @@ static void ExplodeTriMesh(
 		int shardDensity,
 		float shardDecaySpeed)
 {
+				/* ALL SHARDS FROM THIS MESH GO INTO THE SAME BATCH */
+
+	int batchNum = AcquireShardBatch(inMesh);
+	if (batchNum < 0)													// too many different materials flying around already
+		return;
+
+	ShardBatch* batch = &gShardBatches[batchNum];
+
+	GAME_ASSERT(inMesh->hasVertexNormals);
+	GAME_ASSERT(inMesh->texturingMode == kQ3TexturingModeOff || inMesh->vertexUVs);
+
 			/*******************************/
 			/* SCAN THRU ALL TRIMESH FACES */
 			/*******************************/
-					
+
 	for (int t = 0; t < inMesh->numTriangles; t += shardDensity)		// scan thru all faces
 	{
 				/* GET FREE SHARD INDEX */
 
-		int shardIndex = Pool_AllocateIndex(gShardPool);
-		if (shardIndex < 0)												// see if all out
+		int i = Pool_AllocateIndex(gShardPool);
+		if (i < 0)														// see if all out
 			break;
 
-		ShardType* shard = &gShards[shardIndex];
-
-		TQ3TriMeshData* sMesh = shard->mesh;
-
 		const uint16_t* ind = inMesh->triangles[t].pointIndices;		// get indices of 3 points
 
-				/*********************/
-				/* INIT TRIMESH DATA */
-				/*********************/
- 
 				/* DO POINTS */
 
+		TQ3Point3D* points = gShards.localPoints[i];
+
 		for (int v = 0; v < 3; v++)
 		{
-			Q3Point3D_Transform(&inMesh->points[ind[v]], transform, &sMesh->points[v]);		// transform points
+			Q3Point3D_Transform(&inMesh->points[ind[v]], transform, &points[v]);		// transform points
 		}
 
 		TQ3Point3D centerPt =
 		{
-			(sMesh->points[0].x + sMesh->points[1].x + sMesh->points[2].x) * 0.3333f,		// calc center of polygon
-			(sMesh->points[0].y + sMesh->points[1].y + sMesh->points[2].y) * 0.3333f,
-			(sMesh->points[0].z + sMesh->points[1].z + sMesh->points[2].z) * 0.3333f,
+			(points[0].x + points[1].x + points[2].x) * 0.3333f,		// calc center of polygon
+			(points[0].y + points[1].y + points[2].y) * 0.3333f,
+			(points[0].z + points[1].z + points[2].z) * 0.3333f,
 		};
 
 		for (int v = 0; v < 3; v++)
 		{
-			sMesh->points[v].x -= centerPt.x;											// offset coords to be around center
-			sMesh->points[v].y -= centerPt.y;
-			sMesh->points[v].z -= centerPt.z;
+			points[v].x -= centerPt.x;									// offset coords to be around center
+			points[v].y -= centerPt.y;
+			points[v].z -= centerPt.z;
 		}
 
-		sMesh->bBox.min = sMesh->bBox.max = centerPt;
-		sMesh->bBox.isEmpty = kQ3False;
-
-
 				/* DO VERTEX NORMALS */
 
-		GAME_ASSERT(inMesh->hasVertexNormals);
 		for (int v = 0; v < 3; v++)
 		{
-			Q3Vector3D_Transform(&inMesh->vertexNormals[ind[v]], transform, &sMesh->vertexNormals[v]);		// transform normals
-			Q3Vector3D_Normalize(&sMesh->vertexNormals[v], &sMesh->vertexNormals[v]);						// normalize normals
+			TQ3Vector3D* n = &gShards.localNormals[i][v];
+			Q3Vector3D_Transform(&inMesh->vertexNormals[ind[v]], transform, n);		// transform normals
+			Q3Vector3D_Normalize(n, n);												// normalize normals
 		}
 
 				/* DO VERTEX UV'S */
 
-		sMesh->texturingMode = inMesh->texturingMode;
-		if (inMesh->texturingMode != kQ3TexturingModeOff)				// see if also has UV
+		for (int v = 0; v < 3; v++)
 		{
-			GAME_ASSERT(inMesh->vertexUVs);
-			for (int v = 0; v < 3; v++)									// get vertex u/v's
-			{
-				sMesh->vertexUVs[v] = inMesh->vertexUVs[ind[v]];
-			}
-			sMesh->glTextureName = inMesh->glTextureName;
-			sMesh->internalTextureID = inMesh->internalTextureID;
+			gShards.uvs[i][v] = inMesh->texturingMode != kQ3TexturingModeOff
+					? inMesh->vertexUVs[ind[v]]
+					: (TQ3Param2D) {0, 0};
 		}
 
 				/* DO VERTEX COLORS */
+				//
+				// The batch mesh always has per-vertex colors, so bake the mesh's
+				// diffuse color into them if the mesh has none.
+				//
 
-		sMesh->diffuseColor = inMesh->diffuseColor;
-
-		sMesh->hasVertexColors = inMesh->hasVertexColors;				// has per-vertex colors?
-		if (inMesh->hasVertexColors)
+		for (int v = 0; v < 3; v++)
 		{
-			for (int v = 0; v < 3; v++)									// get per-vertex colors
-			{
-				sMesh->vertexColors[v] = inMesh->vertexColors[ind[v]];
-			}
+			gShards.colors[i][v] = inMesh->hasVertexColors
+					? inMesh->vertexColors[ind[v]]
+					: inMesh->diffuseColor;
 		}
 
 			/*********************/
 			/* SET PHYSICS STUFF */
 			/*********************/
 
-		shard->coord = centerPt;
-		shard->rot = (TQ3Vector3D) {0, 0, 0};
-		shard->scale = 1.0f;
+		gShards.coord[i] = centerPt;
+		gShards.rot[i] = (TQ3Vector3D) {0, 0, 0};
+		gShards.scale[i] = 1.0f;
 
-		shard->coordDelta.x = (RandomFloat() - 0.5f) * boomForce;
-		shard->coordDelta.y = (RandomFloat() - 0.5f) * boomForce;
-		shard->coordDelta.z = (RandomFloat() - 0.5f) * boomForce;
+		TQ3Vector3D* coordDelta = &gShards.coordDelta[i];
+		coordDelta->x = (RandomFloat() - 0.5f) * boomForce;
+		coordDelta->y = (RandomFloat() - 0.5f) * boomForce;
+		coordDelta->z = (RandomFloat() - 0.5f) * boomForce;
 		if (shardMode & SHARD_MODE_UPTHRUST)
-			shard->coordDelta.y += 1.5f * boomForce;
+			coordDelta->y += 1.5f * boomForce;
 
-		shard->rotDelta.x = (RandomFloat() - 0.5f) * 4.0f;			// random rotation deltas
-		shard->rotDelta.y = (RandomFloat() - 0.5f) * 4.0f;
-		shard->rotDelta.z = (RandomFloat() - 0.5f) * 4.0f;
+		TQ3Vector3D* rotDelta = &gShards.rotDelta[i];
+		rotDelta->x = (RandomFloat() - 0.5f) * 4.0f;					// random rotation deltas
+		rotDelta->y = (RandomFloat() - 0.5f) * 4.0f;
+		rotDelta->z = (RandomFloat() - 0.5f) * 4.0f;
 
-		shard->decaySpeed = shardDecaySpeed;
-		shard->mode = shardMode;
+		gShards.decaySpeed[i] = shardDecaySpeed;
+		gShards.mode[i] = shardMode;
+		gShards.batch[i] = batchNum;
+		batch->numShards++;
 	}
+
+	batch->numShards--;													// drop the reference taken by AcquireShardBatch
+}
+
+
+/********************** ACQUIRE SHARD BATCH *******************************/
+//
+// Finds the batch that draws shards from this mesh's texture & material,
+// or sets up a free one.
+//
+// OUTPUT:	batch number, or -1 if all batches are taken.
+//			The batch holds an extra reference that the caller must drop.
+//
+
+static int AcquireShardBatch(const TQ3TriMeshData* inMesh)
+{
+	GLuint	textureName		= inMesh->texturingMode != kQ3TexturingModeOff ? inMesh->glTextureName : 0;
+	bool	transparent		= inMesh->diffuseColor.a < .999f;		// matches the renderer's transparency test
+	int		freeBatch		= -1;
+
+	for (int b = 0; b < MAX_SHARD_BATCHES; b++)
+	{
+		ShardBatch* batch = &gShardBatches[b];
+
+		if (batch->numShards == 0)
+		{
+			if (freeBatch < 0)
+				freeBatch = b;
+			continue;
+		}
+
+		if (batch->glTextureName == textureName
+			&& batch->texturingMode == inMesh->texturingMode
+			&& batch->transparent == transparent)
+		{
+			batch->numShards++;
+			return b;
+		}
+	}
+
+	if (freeBatch < 0)
+		return -1;
+
+	ShardBatch* batch = &gShardBatches[freeBatch];
+	batch->numShards		= 1;
+	batch->glTextureName	= textureName;
+	batch->texturingMode	= inMesh->texturingMode;
+	batch->transparent		= transparent;
+
+	TQ3TriMeshData* mesh = batch->mesh;
+	mesh->glTextureName		= textureName;
+	mesh->texturingMode		= inMesh->texturingMode;
+	mesh->diffuseColor		= (TQ3ColorRGBA) {1, 1, 1, transparent ? 0.5f : 1.0f};	// vertex colors carry the actual color; alpha only classifies the batch
+	mesh->numTriangles		= 0;
+	mesh->numPoints			= 0;
+
+	return freeBatch;
+}
+
+
+/********************** RELEASE SHARD *******************************/
+
+static void ReleaseShard(int i)
+{
+	ShardBatch* batch = &gShardBatches[gShards.batch[i]];
+	GAME_ASSERT(batch->numShards > 0);
+	batch->numShards--;
+
+	Pool_ReleaseIndex(gShardPool, i);
 }
 
 
 /************************** QD3D: MOVE SHARDS ****************************/
+//
+// Physics only. Shards are posed in world space when they're drawn.
+//
 
 void QD3D_MoveShards(void)
 {
-float	ty,y,fps,x,z;
-TQ3Matrix4x4	matrix,matrix2;
+float	ty,fps;
 
 	if (!gShardPool || Pool_Empty(gShardPool))					// quick check if any shards at all
 		return;
@@ -393,39 +522,42 @@ TQ3Matrix4x4	matrix,matrix2;
 
 		int nextIndex = Pool_Next(gShardPool, i);
 
-		ShardType* shard = &gShards[i];
+		TQ3Point3D*		coord		= &gShards.coord[i];
+		TQ3Vector3D*	coordDelta	= &gShards.coordDelta[i];
+		TQ3Vector3D*	rot			= &gShards.rot[i];
+		const Byte		mode		= gShards.mode[i];
 
 				/* ROTATE IT */
 
-		shard->rot.x += shard->rotDelta.x * fps;
-		shard->rot.y += shard->rotDelta.y * fps;
-		shard->rot.z += shard->rotDelta.z * fps;
+		rot->x += gShards.rotDelta[i].x * fps;
+		rot->y += gShards.rotDelta[i].y * fps;
+		rot->z += gShards.rotDelta[i].z * fps;
 
 					/* MOVE IT */
 
-		if (shard->mode & SHARD_MODE_HEAVYGRAVITY)
-			shard->coordDelta.y -= fps * 1700.0f / 2;			// gravity
+		if (mode & SHARD_MODE_HEAVYGRAVITY)
+			coordDelta->y -= fps * 1700.0f / 2;					// gravity
 		else
-			shard->coordDelta.y -= fps * 1700.0f / 3;			// gravity
+			coordDelta->y -= fps * 1700.0f / 3;					// gravity
 
-		x = (shard->coord.x += shard->coordDelta.x * fps);
-		y = (shard->coord.y += shard->coordDelta.y * fps);
-		z = (shard->coord.z += shard->coordDelta.z * fps);
+		coord->x += coordDelta->x * fps;
+		coord->y += coordDelta->y * fps;
+		coord->z += coordDelta->z * fps;
 
 
 					/* SEE IF BOUNCE */
 
 		if (gFloorMap)
-			ty = GetTerrainHeightAtCoord(x,z, FLOOR);			// get terrain height here
+			ty = GetTerrainHeightAtCoord(coord->x, coord->z, FLOOR);	// get terrain height here
 
-		if (y <= ty)
+		if (coord->y <= ty)
 		{
-			if (shard->mode & SHARD_MODE_BOUNCE)
+			if (mode & SHARD_MODE_BOUNCE)
 			{
-				shard->coord.y  = ty;
-				shard->coordDelta.y *= -0.5f;
-				shard->coordDelta.x *= 0.9f;
-				shard->coordDelta.z *= 0.9f;
+				coord->y = ty;
+				coordDelta->y *= -0.5f;
+				coordDelta->x *= 0.9f;
+				coordDelta->z *= 0.9f;
 			}
 			else
 				goto del;
@@ -433,84 +565,108 @@ TQ3Matrix4x4	matrix,matrix2;
 
 					/* SCALE IT */
 
-		shard->scale -= shard->decaySpeed * fps;
-		if (shard->scale <= 0.0f)
+		gShards.scale[i] -= gShards.decaySpeed[i] * fps;
+		if (gShards.scale[i] <= 0.0f)
 		{
 				/* DEACTIVATE THIS SHARD */
 	del:
-			Pool_ReleaseIndex(gShardPool, i);
-			goto next;
+			ReleaseShard(i);
 		}
 
-			/***************************/
-			/* UPDATE TRANSFORM MATRIX */
-			/***************************/
-
-
-				/* SET SCALE MATRIX */
-
-		Q3Matrix4x4_SetScale(&shard->matrix, shard->scale, shard->scale, shard->scale);
-
-					/* NOW ROTATE IT */
-
-		Q3Matrix4x4_SetRotate_XYZ(&matrix, shard->rot.x, shard->rot.y, shard->rot.z);
-		MatrixMultiplyFast(&shard->matrix, &matrix, &matrix2);
-
-					/* NOW TRANSLATE IT */
-
-		Q3Matrix4x4_SetTranslate(&matrix, shard->coord.x, shard->coord.y, shard->coord.z);
-		MatrixMultiplyFast(&matrix2,&matrix, &shard->matrix);
-
-next:
 		i = nextIndex;
 	}
 }
 
 
 /************************* QD3D: DRAW SHARDS ****************************/
+//
+// Poses every live shard in world space and appends it to its batch's mesh,
+// then submits one mesh per batch.
+//
 
 void QD3D_DrawShards(const QD3DSetupOutputType *setupInfo)
 {
+TQ3Matrix4x4	m;
+
 	(void) setupInfo;
 
 	if (!gShardPool || Pool_Empty(gShardPool))		// quick check if any shards at all
 		return;
 
-	for (int i = Pool_First(gShardPool); i >= 0; i = Pool_Next(gShardPool, i))
+	for (int b = 0; b < MAX_SHARD_BATCHES; b++)
 	{
-		ShardType* shard = &gShards[i];
-		Render_SubmitMesh(shard->mesh, &shard->matrix, &kShardRenderMods, &shard->coord);
+		TQ3TriMeshData* mesh = gShardBatches[b].mesh;
+		mesh->numPoints = 0;
+		mesh->bBox.isEmpty = kQ3True;
+		mesh->bBox.min = (TQ3Point3D) { 1e9f, 1e9f, 1e9f};
+		mesh->bBox.max = (TQ3Point3D) {-1e9f,-1e9f,-1e9f};
 	}
-}
 
+				/* TRANSFORM SHARDS INTO THEIR BATCHES */
 
+	for (int i = Pool_First(gShardPool); i >= 0; i = Pool_Next(gShardPool, i))
+	{
+		TQ3TriMeshData* mesh = gShardBatches[gShards.batch[i]].mesh;
+		const int base = mesh->numPoints;
+		mesh->numPoints += 3;
 
-//============================================================================================
-//============================================================================================
-//============================================================================================
+		const TQ3Point3D	c = gShards.coord[i];
+		const float			s = gShards.scale[i];
 
+		Q3Matrix4x4_SetRotate_XYZ(&m, gShards.rot[i].x, gShards.rot[i].y, gShards.rot[i].z);
 
+		for (int v = 0; v < 3; v++)
+		{
+			const TQ3Point3D	lp = gShards.localPoints[i][v];
+			const TQ3Vector3D	ln = gShards.localNormals[i][v];
+			TQ3Point3D*			wp = &mesh->points[base + v];
 
-#pragma mark -
+			wp->x = c.x + s * (lp.x * m.value[0][0] + lp.y * m.value[1][0] + lp.z * m.value[2][0]);	// scale, rotate, translate
+			wp->y = c.y + s * (lp.x * m.value[0][1] + lp.y * m.value[1][1] + lp.z * m.value[2][1]);
+			wp->z = c.z + s * (lp.x * m.value[0][2] + lp.y * m.value[1][2] + lp.z * m.value[2][2]);
 
+			mesh->vertexNormals[base + v] = (TQ3Vector3D)
+			{
+				ln.x * m.value[0][0] + ln.y * m.value[1][0] + ln.z * m.value[2][0],
+				ln.x * m.value[0][1] + ln.y * m.value[1][1] + ln.z * m.value[2][1],
+				ln.x * m.value[0][2] + ln.y * m.value[1][2] + ln.z * m.value[2][2],
+			};
+
+			mesh->bBox.min.x = fminf(mesh->bBox.min.x, wp->x);
+			mesh->bBox.min.y = fminf(mesh->bBox.min.y, wp->y);
+			mesh->bBox.min.z = fminf(mesh->bBox.min.z, wp->z);
+			mesh->bBox.max.x = fmaxf(mesh->bBox.max.x, wp->x);
+			mesh->bBox.max.y = fmaxf(mesh->bBox.max.y, wp->y);
+			mesh->bBox.max.z = fmaxf(mesh->bBox.max.z, wp->z);
+		}
 
-/****************** QD3D: SCROLL UVs ***********************/
-//
-// Given any object as input this will scroll any u/v coordinates by the given amount
-//
+		memcpy(&mesh->vertexUVs[base], gShards.uvs[i], sizeof(gShards.uvs[i]));
+		memcpy(&mesh->vertexColors[base], gShards.colors[i], sizeof(gShards.colors[i]));
+	}
 
-void QD3D_ScrollUVs(TQ3TriMeshData* mesh, float du, float dv)
-{
-	GAME_ASSERT(mesh->vertexUVs);
-	for (int j = 0; j < mesh->numPoints; j++)
+				/* SUBMIT ONE MESH PER BATCH */
+
+	for (int b = 0; b < MAX_SHARD_BATCHES; b++)
 	{
-		mesh->vertexUVs[j].u += du;
-		mesh->vertexUVs[j].v += dv;
+		TQ3TriMeshData* mesh = gShardBatches[b].mesh;
+		if (mesh->numPoints == 0)
+			continue;
+
+		mesh->numTriangles = mesh->numPoints / 3;
+		mesh->bBox.isEmpty = kQ3False;
+
+		Render_SubmitMesh(mesh, nil, &kShardRenderMods, nil);
 	}
 }
 
 
 
+//============================================================================================
+//============================================================================================
+//============================================================================================
+
+
+
 #pragma mark -
 
 //============================================================================================
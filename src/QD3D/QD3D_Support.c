@@ -26,7 +26,7 @@ static void CreateLights(QD3DLightDefType *lightDefPtr);
 /*    CONSTANTS             */
 /****************************/
 
-static const int kDebugTextMeshQuadCapacity = 1024;
+static const int kDebugTextMeshQuadCapacity = 2048;
 
 
 /*********************/
@@ -267,6 +267,8 @@ static void CreateLights(QD3DLightDefType *lightDefPtr)
 	{
 		glDisable(GL_LIGHT0 + i);
 	}
+
+	Render_SetNumFillLights(lightDefPtr->numFillLights);
 }
 
 
@@ -338,6 +340,7 @@ void QD3D_DrawScene(QD3DSetupOutputType *setupInfo, void (*drawRoutine)(const QD
 	Render_EndFrame();
 
 	SDL_GL_SwapWindow(gSDLWindow);
+	FramePacing_OnSwap();
 }
 
 
@@ -532,7 +535,8 @@ void QD3D_CalcFramesPerSecond(void)
 		performanceFrequency = SDL_GetPerformanceFrequency();
 	}
 
-	slow_down:
+	FramePacing_WaitForNextFrame(prevTime);				// keep from cooking the GPU
+
 	currTime = SDL_GetPerformanceCounter();
 	uint64_t deltaTime = currTime - prevTime;
 
@@ -544,14 +548,7 @@ void QD3D_CalcFramesPerSecond(void)
 	{
 		gFramesPerSecond = performanceFrequency / (float)(deltaTime);
 
-		if (gFramesPerSecond > MAX_FPS)					// keep from cooking the GPU
-		{
-			if (gFramesPerSecond - MAX_FPS > 1000)		// try to sneak in some sleep if we have 1 ms to spare
-			{
-				SDL_Delay(1);
-			}
-			goto slow_down;
-		}
+		FramePacing_RecordFrame(deltaTime);
 
 		if (gFramesPerSecond < MIN_FPS)					// (avoid divide by 0's later)
 		{
@@ -617,6 +614,7 @@ void QD3D_UpdateDebugTextMesh(const char* text)
 	{
 		if (gDebugTextMesh)
 		{
+			TextMesh_ForgetRecycledMesh(gDebugTextMesh);
 			Q3TriMeshData_Dispose(gDebugTextMesh);
 			gDebugTextMesh = nil;
 		}
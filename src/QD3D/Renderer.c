@@ -40,19 +40,52 @@ typedef struct RendererState
 	bool		hasFlag_glDepthMask;
 	bool		blendFuncIsAdditive;
 	bool		sceneHasFog;
+	bool		hasUVTransform;
+	TQ3Param2D	uvOffset;
+	TQ3Param2D	uvScale;
+	bool		fadeCombinerEnabled;
+	float		fadeCombinerAlpha;
 	GLboolean	wantColorMask;
 	const TQ3Matrix4x4*	currentTransform;
+	bool		shadingStateValid;		// false if shadingState may not reflect the GL state anymore
+	uint16_t	shadingState;			// kMeshState bits last applied by BeginShadingPass
 } RendererState;
 
+// Everything the passes need to know about a mesh's render state, packed into
+// one word when the mesh is submitted so the flush loop doesn't have to go back
+// to the mesh and its RenderModifiers to make decisions.
+enum
+{
+	kMeshState_Transparent		= 1 << 0,
+	kMeshState_Lighting			= 1 << 1,
+	kMeshState_Fog				= 1 << 2,		// mesh accepts fog (scene fog is checked at flush time)
+	kMeshState_Texture			= 1 << 3,
+	kMeshState_AlphaTest		= 1 << 4,
+	kMeshState_UVTransform		= 1 << 5,
+	kMeshState_ReflectionMap	= 1 << 6,
+	kMeshState_NormalArray		= 1 << 7,
+	kMeshState_ColorArray		= 1 << 8,
+	kMeshState_NoZWrite			= 1 << 9,
+	kMeshState_Additive			= 1 << 10,
+	kMeshState_KeepBackfaces	= 1 << 11,
+	kMeshState_Backfaces2Pass	= 1 << 12,
+
+	// States that BeginShadingPass diffs against the previous mesh
+	kMeshState_ShadingMask		= kMeshState_Lighting | kMeshState_Fog | kMeshState_Texture | kMeshState_NormalArray,
+};
+
 typedef struct MeshQueueEntry
 {
 	const TQ3TriMeshData*	mesh;
 	const TQ3Matrix4x4*		transform;	// may be NULL
-	const RenderModifiers*	mods;		// may be NULL
+	const RenderModifiers*	mods;		// never NULL; only read for colors, fade and UV transform
 	float					depth;		// used to determine draw order
-	bool					meshIsTransparent;
+	int16_t					drawOrder;	// copy of mods->drawOrder
+	uint16_t				state;		// kMeshState bits
 } MeshQueueEntry;
 
+_Static_assert(sizeof(MeshQueueEntry) <= 32, "keep MeshQueueEntry compact -- two entries per cache line");
+
 #define MESHQUEUE_MAX_SIZE 4096
 
 static MeshQueueEntry		gMeshQueueEntryPool[MESHQUEUE_MAX_SIZE];
@@ -63,12 +96,16 @@ static bool					gFrameStarted = false;
 static float				gBackupVertexColors[4*65536];
 
 static int DrawOrderComparator(void const* a_void, void const* b_void);
+static uint16_t CalcMeshState(const TQ3TriMeshData* mesh, const RenderModifiers* mods);
 
 static void BeginDepthPass(const MeshQueueEntry* entry);
 static void BeginShadingPass(const MeshQueueEntry* entry);
 static void PrepareOpaqueShading(const MeshQueueEntry* entry);
 static void PrepareAlphaShading(const MeshQueueEntry* entry);
 static void SendGeometry(const MeshQueueEntry* entry);
+static void SetUVTransform(const RenderModifiers* mods);
+static void InitFadeCombiner(void);
+static void SetFadeCombiner(bool enable, float alpha);
 
 
 #pragma mark -
@@ -84,6 +121,7 @@ static const RenderModifiers kDefaultRenderMods =
 	.statusBits = 0,
 	.diffuseColor = {1,1,1,1},
 	.autoFadeFactor = 1.0f,
+	.uvScale = {1,1},
 	.drawOrder = 0,
 };
 
@@ -92,6 +130,7 @@ const RenderModifiers kDefaultRenderMods_UI =
 	.statusBits = STATUS_BIT_NULLSHADER | STATUS_BIT_NOFOG | STATUS_BIT_NOZWRITE,
 	.diffuseColor = {1,1,1,1},
 	.autoFadeFactor = 1.0f,
+	.uvScale = {1,1},
 	.drawOrder = kDrawOrder_UI
 };
 
@@ -100,6 +139,7 @@ static const RenderModifiers kDefaultRenderMods_FadeOverlay =
 	.statusBits = STATUS_BIT_NULLSHADER | STATUS_BIT_NOFOG | STATUS_BIT_NOZWRITE,
 	.diffuseColor = {1,1,1,1},
 	.autoFadeFactor = 1.0f,
+	.uvScale = {1,1},
 	.drawOrder = kDrawOrder_FadeOverlay
 };
 
@@ -108,6 +148,7 @@ const RenderModifiers kDefaultRenderMods_DebugUI =
 	.statusBits = STATUS_BIT_NULLSHADER | STATUS_BIT_NOFOG | STATUS_BIT_NOZWRITE | STATUS_BIT_KEEPBACKFACES | STATUS_BIT_DONTCULL,
 	.diffuseColor = {1,1,1,1},
 	.autoFadeFactor = 1.0f,
+	.uvScale = {1,1},
 	.drawOrder = kDrawOrder_DebugUI
 };
 
@@ -116,6 +157,7 @@ const RenderModifiers kDefaultRenderMods_Pillarbox =
 	.statusBits = STATUS_BIT_NULLSHADER | STATUS_BIT_NOFOG | STATUS_BIT_NOZWRITE | STATUS_BIT_KEEPBACKFACES | STATUS_BIT_DONTCULL,
 	.diffuseColor = {0,0,0,1},
 	.autoFadeFactor = 1.0f,
+	.uvScale = {1,1},
 	.drawOrder = kDrawOrder_DebugUI
 };
 
@@ -133,6 +175,17 @@ float gGammaFadeFactor = 1.0f;
 
 static TQ3TriMeshData* gFullscreenQuad = nil;
 
+static bool gShaderBackend = false;		// true if --shader-renderer was requested and the uber-shader compiled
+
+static int gNumFillLights = 0;
+
+	/* AUTO-FADE COMBINER */
+	// Texture unit 1 is set up to multiply the incoming alpha by a constant (GL_TEXTURE_ENV_COLOR),
+	// which lets us apply auto-fade to vertex-colored meshes without rewriting their color arrays.
+
+static PFNGLACTIVETEXTUREPROC gglActiveTexture = NULL;
+static GLuint gFadeCombinerTexture = 0;		// 0 if the combiner is unavailable
+
 #pragma mark -
 
 /****************************/
@@ -197,6 +250,14 @@ static inline void __SetClientState(GLenum stateEnum, bool* stateFlagPtr, bool e
 #define RestoreStateFromBackup(stateEnum, backup) __SetState(stateEnum, &gState.hasState_##stateEnum, (backup)->hasState_##stateEnum)
 #define RestoreClientStateFromBackup(stateEnum, backup) __SetClientState(stateEnum, &gState.hasClientState_##stateEnum, (backup)->hasClientState_##stateEnum)
 
+// Fixed-function switches that become uniforms when the uber-shader backend is active.
+#define SetShadingState(stateEnum, shaderFeature, value) do {	\
+	if (gShaderBackend)										\
+		RenderShaders_SetFeature(shaderFeature, (value));		\
+	else														\
+		__SetState(stateEnum, &gState.hasState_##stateEnum, (value));	\
+} while(0)
+
 #define SetFlag(glFunction, value) do {				\
 	if ((value) != gState.hasFlag_##glFunction) {	\
 		glFunction((value)? GL_TRUE: GL_FALSE);		\
@@ -238,12 +299,29 @@ void Render_CreateContext(void)
 	// On Windows, proc addresses are only valid for the current context,
 	// so we must get proc addresses everytime we recreate the context.
 	//Render_GetGLProcAddresses();
+
+	InitFadeCombiner();
+
+	gShaderBackend = false;
+	if (gCommandLine.shaderRenderer)
+	{
+		gShaderBackend = RenderShaders_Init();
+		if (!gShaderBackend)
+			printf("Couldn't set up shader renderer; falling back to fixed-function pipeline\n");
+	}
+
+	RenderOcclusion_Init();
 }
 
 void Render_DeleteContext(void)
 {
 	if (gGLContext)
 	{
+		FramePacing_Shutdown();
+		RenderShaders_Shutdown();
+		RenderOcclusion_Shutdown();
+		gShaderBackend = false;
+		gFadeCombinerTexture = 0;		// goes away with the context
 		SDL_GL_DeleteContext(gGLContext);
 		gGLContext = NULL;
 	}
@@ -284,6 +362,14 @@ void Render_InitState(const TQ3ColorRGBA* clearColor)
 	gState.boundTexture = 0;
 	gState.sceneHasFog = false;
 	gState.currentTransform = NULL;
+	gState.shadingStateValid = false;
+
+	RenderOcclusion_Reset();
+
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	gState.hasUVTransform = false;
 
 	glClearColor(clearColor->r, clearColor->g, clearColor->b, 1.0f);
 	
@@ -339,6 +425,11 @@ void Render_DisableFog(void)
 	gState.sceneHasFog = false;
 }
 
+void Render_SetNumFillLights(int numFillLights)
+{
+	gNumFillLights = numFillLights;
+}
+
 #pragma mark -
 
 void Render_BindTexture(GLuint textureName)
@@ -558,6 +649,9 @@ void Render_FlushQueue(void)
 	if (gMeshQueueSize == 0)
 		return;
 
+	PROFILE_BEGIN(Flush);
+	PROFILE_COUNT(FlushedMeshes, gMeshQueueSize);
+
 	//--------------------------------------------------------------
 	// SORT DRAW QUEUE ENTRIES
 	// Opaque meshes are sorted front-to-back,
@@ -576,14 +670,24 @@ void Render_FlushQueue(void)
 
 	int numDeferredColorMeshes = 0;
 
+	gState.shadingStateValid = false;		// GL state may have been changed outside the queue since last flush
+
 	glDepthFunc(GL_LESS);
 	DisableState(GL_BLEND);
 
+	if (gShaderBackend)
+	{
+		// Alpha testing is done in the fragment shader. Make sure the fixed-function
+		// alpha test (which still runs after the shader) doesn't get in the way.
+		DisableState(GL_ALPHA_TEST);
+		RenderShaders_Begin(gNumFillLights);
+	}
+
 	for (int i = 0; i < gMeshQueueSize; i++)
 	{
 		MeshQueueEntry* entry = gMeshQueuePtrs[i];
 
-		if (!entry->meshIsTransparent)
+		if (!(entry->state & kMeshState_Transparent))
 		{
 			// If the mesh is opaque, draw it now
 			BeginShadingPass(entry);
@@ -597,7 +701,7 @@ void Render_FlushQueue(void)
 			gMeshQueuePtrs[numDeferredColorMeshes++] = entry;		// shoot back to start of queue for next pass
 
 			// If a transparent mesh wants to write to the Z-buffer, do it now
-			if (!(entry->mods->statusBits & STATUS_BIT_NOZWRITE))
+			if (!(entry->state & kMeshState_NoZWrite))
 			{
 				BeginDepthPass(entry);
 				SendGeometry(entry);
@@ -614,7 +718,7 @@ void Render_FlushQueue(void)
 	if (numDeferredColorMeshes > 0)
 	{
 		EnableState(GL_BLEND);
-		DisableState(GL_ALPHA_TEST);
+		SetShadingState(GL_ALPHA_TEST, kShaderFeature_AlphaTest, false);
 		SetFlag(glDepthMask, false);	// don't write to z buffer
 		glDepthFunc(GL_LEQUAL);			// LEQUAL: our meshes' depth info is already in the z buffer (written in pass 1)
 
@@ -639,6 +743,15 @@ void Render_FlushQueue(void)
 		glPopMatrix();
 		gState.currentTransform = NULL;
 	}
+
+	// Don't let the UV transform or fade combiner leak into immediate-mode drawing
+	SetUVTransform(NULL);
+	SetFadeCombiner(false, 1.0f);
+
+	if (gShaderBackend)
+		RenderShaders_End();
+
+	PROFILE_END(Flush);
 }
 
 void Render_EndFrame(void)
@@ -692,7 +805,7 @@ static float GetDepth(
 
 static bool IsMeshTransparent(const TQ3TriMeshData* mesh, const RenderModifiers* mods)
 {
-	return	mesh->texturingMode == kQ3TexturingModeAlphaBlend
+	return	(mesh->texturingMode & kQ3TexturingModeExt_OpacityModeMask) == kQ3TexturingModeAlphaBlend
 			|| mesh->diffuseColor.a < .999f
 			|| mods->diffuseColor.a < .999f
 			|| mods->autoFadeFactor < .999f
@@ -700,6 +813,76 @@ static bool IsMeshTransparent(const TQ3TriMeshData* mesh, const RenderModifiers*
 	;
 }
 
+static uint16_t CalcMeshState(const TQ3TriMeshData* mesh, const RenderModifiers* mods)
+{
+	const uint32_t statusBits = mods->statusBits;
+	const TQ3TexturingMode opacityMode = mesh->texturingMode & kQ3TexturingModeExt_OpacityModeMask;
+	uint16_t state = 0;
+
+	if (IsMeshTransparent(mesh, mods))
+		state |= kMeshState_Transparent;
+
+	if (!((statusBits & STATUS_BIT_NULLSHADER) || (mesh->texturingMode & kQ3TexturingModeExt_NullShaderFlag)))
+		state |= kMeshState_Lighting;
+
+	if (!(statusBits & STATUS_BIT_NOFOG))
+		state |= kMeshState_Fog;
+
+	if (opacityMode != kQ3TexturingModeOff)
+		state |= kMeshState_Texture;
+
+	if (opacityMode == kQ3TexturingModeAlphaTest)
+		state |= kMeshState_AlphaTest;
+
+	if (mesh->texturingMode & kQ3TexturingModeExt_UVTransformFlag)
+		state |= kMeshState_UVTransform;
+
+	if (statusBits & STATUS_BIT_REFLECTIONMAP)
+		state |= kMeshState_ReflectionMap;
+
+	if (mesh->hasVertexNormals && !(statusBits & STATUS_BIT_NULLSHADER))
+		state |= kMeshState_NormalArray;
+
+	if (mesh->hasVertexColors)
+		state |= kMeshState_ColorArray;
+
+	if (statusBits & STATUS_BIT_NOZWRITE)
+		state |= kMeshState_NoZWrite;
+
+	if (statusBits & STATUS_BIT_GLOW)
+		state |= kMeshState_Additive;
+
+	if (statusBits & STATUS_BIT_KEEPBACKFACES)
+		state |= kMeshState_KeepBackfaces;
+
+	if (statusBits & STATUS_BIT_KEEPBACKFACES_2PASS)
+		state |= kMeshState_Backfaces2Pass;
+
+	return state;
+}
+
+static void InitMeshQueueEntry(
+		MeshQueueEntry*			entry,
+		const TQ3TriMeshData*	mesh,
+		const TQ3Matrix4x4*		transform,
+		const RenderModifiers*	mods,
+		float					depth)
+{
+	entry->mesh				= mesh;
+	entry->transform		= transform;
+	entry->mods				= mods ? mods : &kDefaultRenderMods;
+	entry->depth			= depth;
+	entry->drawOrder		= entry->mods->drawOrder;
+	entry->state			= CalcMeshState(entry->mesh, entry->mods);
+
+	GAME_ASSERT(entry->drawOrder == entry->mods->drawOrder);		// must fit in 16 bits
+
+	gRenderStats.meshesPass1++;
+	gRenderStats.triangles += entry->mesh->numTriangles;
+
+	GAME_ASSERT(!(entry->mods->statusBits & STATUS_BIT_HIDDEN));
+}
+
 static MeshQueueEntry* NewMeshQueueEntry(void)
 {
 	MeshQueueEntry* entry = &gMeshQueueEntryPool[gMeshQueueSize];
@@ -725,17 +908,7 @@ void Render_SubmitMeshList(
 
 	for (int i = 0; i < numMeshes; i++)
 	{
-		MeshQueueEntry* entry = NewMeshQueueEntry();
-		entry->mesh				= meshList[i];
-		entry->transform		= transform;
-		entry->mods				= mods ? mods : &kDefaultRenderMods;
-		entry->depth			= depth;
-		entry->meshIsTransparent= IsMeshTransparent(entry->mesh, entry->mods);
-
-		gRenderStats.meshesPass1++;
-		gRenderStats.triangles += entry->mesh->numTriangles;
-
-		GAME_ASSERT(!(entry->mods->statusBits & STATUS_BIT_HIDDEN));
+		InitMeshQueueEntry(NewMeshQueueEntry(), meshList[i], transform, mods, depth);
 	}
 }
 
@@ -748,17 +921,7 @@ void Render_SubmitMesh(
 	GAME_ASSERT(gFrameStarted);
 	GAME_ASSERT(gMeshQueueSize < MESHQUEUE_MAX_SIZE);
 
-	MeshQueueEntry* entry = NewMeshQueueEntry();
-	entry->mesh				= mesh;
-	entry->transform		= transform;
-	entry->mods				= mods ? mods : &kDefaultRenderMods;
-	entry->depth			= GetDepth(1, (TQ3TriMeshData **) &mesh, centerCoord);
-	entry->meshIsTransparent= IsMeshTransparent(entry->mesh, entry->mods);
-
-	gRenderStats.meshesPass1++;
-	gRenderStats.triangles += entry->mesh->numTriangles;
-
-	GAME_ASSERT(!(entry->mods->statusBits & STATUS_BIT_HIDDEN));
+	InitMeshQueueEntry(NewMeshQueueEntry(), mesh, transform, mods, GetDepth(1, (TQ3TriMeshData **) &mesh, centerCoord));
 }
 
 #pragma mark -
@@ -774,24 +937,27 @@ static int DrawOrderComparator(const void* a_void, const void* b_void)
 
 	// First check manual priority
 
-	if (a->mods->drawOrder < b->mods->drawOrder)
+	if (a->drawOrder < b->drawOrder)
 		return AFirst;
 
-	if (a->mods->drawOrder > b->mods->drawOrder)
+	if (a->drawOrder > b->drawOrder)
 		return BFirst;
 
 	// A and B have the same manual priority
 	// Compare their transparencies (opaque meshes go first)
 
-	if (a->meshIsTransparent != b->meshIsTransparent)
+	bool aIsTransparent = a->state & kMeshState_Transparent;
+	bool bIsTransparent = b->state & kMeshState_Transparent;
+
+	if (aIsTransparent != bIsTransparent)
 	{
-		return b->meshIsTransparent? AFirst: BFirst;
+		return bIsTransparent? AFirst: BFirst;
 	}
 
 	// A and B have the same manual priority AND transparency
 	// Compare their depths
 
-	if (!a->meshIsTransparent)					// both A and B are OPAQUE meshes: order them front-to-back
+	if (!aIsTransparent)					// both A and B are OPAQUE meshes: order them front-to-back
 	{
 		if (a->depth < b->depth)				// A is closer to the camera, draw it first
 			return AFirst;
@@ -815,17 +981,17 @@ static int DrawOrderComparator(const void* a_void, const void* b_void)
 
 static void SendGeometry(const MeshQueueEntry* entry)
 {
-	uint32_t statusBits = entry->mods->statusBits;
+	const uint16_t state = entry->state;
 
 	const TQ3TriMeshData* mesh = entry->mesh;
 
 	// Cull backfaces or not
-	SetState(GL_CULL_FACE, !(statusBits & STATUS_BIT_KEEPBACKFACES));
+	SetState(GL_CULL_FACE, !(state & kMeshState_KeepBackfaces));
 
 	// To keep backfaces on a transparent mesh, draw backfaces first, then frontfaces.
 	// This enhances the appearance of e.g. translucent spheres,
 	// without the need to depth-sort individual faces.
-	if (statusBits & STATUS_BIT_KEEPBACKFACES_2PASS)
+	if (state & kMeshState_Backfaces2Pass)
 		glCullFace(GL_FRONT);		// Pass 1: draw backfaces (cull frontfaces)
 
 	// Submit vertex data
@@ -851,7 +1017,7 @@ static void SendGeometry(const MeshQueueEntry* entry)
 	CHECK_GL_ERROR();
 
 	// Pass 2 to draw transparent meshes without face culling (see above for an explanation)
-	if (statusBits & STATUS_BIT_KEEPBACKFACES_2PASS)
+	if (state & kMeshState_Backfaces2Pass)
 	{
 		// Restored glCullFace to GL_BACK, which is the default for all other meshes.
 		glCullFace(GL_BACK);	// pass 2: draw frontfaces (cull backfaces)
@@ -865,9 +1031,12 @@ static void SendGeometry(const MeshQueueEntry* entry)
 static void BeginDepthPass(const MeshQueueEntry* entry)
 {
 	const TQ3TriMeshData* mesh = entry->mesh;
-	uint32_t statusBits = entry->mods->statusBits;
+	const uint16_t state = entry->state;
 
-	GAME_ASSERT(!(statusBits & STATUS_BIT_NOZWRITE));		// assume nozwrite objects were filtered out
+	GAME_ASSERT(!(state & kMeshState_NoZWrite));		// assume nozwrite objects were filtered out
+
+	// This pass changes the states that BeginShadingPass keeps track of
+	gState.shadingStateValid = false;
 
 	// Never write to color buffer in this pass
 	SetColorMask(GL_FALSE);
@@ -880,26 +1049,29 @@ static void BeginDepthPass(const MeshQueueEntry* entry)
 	DisableClientState(GL_NORMAL_ARRAY);
 	EnableState(GL_DEPTH_TEST);
 
-	DisableState(GL_LIGHTING);
-	DisableState(GL_FOG);
+	SetShadingState(GL_LIGHTING, kShaderFeature_Lighting, false);
+	SetShadingState(GL_FOG, kShaderFeature_Fog, false);
+
+	if (gShaderBackend)
+		RenderShaders_SetAlphaScale(1.0f);
 
 	// Texture mapping
-	if (gDebugMode != DEBUG_MODE_NOTEXTURES &&
-			(mesh->texturingMode & kQ3TexturingModeExt_OpacityModeMask) != kQ3TexturingModeOff)
+	if (gDebugMode != DEBUG_MODE_NOTEXTURES && (state & kMeshState_Texture))
 	{
 		GAME_ASSERT(mesh->vertexUVs);
 
-		EnableState(GL_ALPHA_TEST);
-		EnableState(GL_TEXTURE_2D);
+		SetShadingState(GL_ALPHA_TEST, kShaderFeature_AlphaTest, true);
+		SetShadingState(GL_TEXTURE_2D, kShaderFeature_Texture, true);
 		EnableClientState(GL_TEXTURE_COORD_ARRAY);
 		Render_BindTexture(mesh->glTextureName);
 		glTexCoordPointer(2, GL_FLOAT, 0, mesh->vertexUVs);
+		SetUVTransform((state & kMeshState_UVTransform) ? entry->mods : NULL);
 		CHECK_GL_ERROR();
 	}
 	else
 	{
-		DisableState(GL_ALPHA_TEST);
-		DisableState(GL_TEXTURE_2D);
+		SetShadingState(GL_ALPHA_TEST, kShaderFeature_AlphaTest, false);
+		SetShadingState(GL_TEXTURE_2D, kShaderFeature_Texture, false);
 		DisableClientState(GL_TEXTURE_COORD_ARRAY);
 		CHECK_GL_ERROR();
 	}
@@ -908,46 +1080,66 @@ static void BeginDepthPass(const MeshQueueEntry* entry)
 static void BeginShadingPass(const MeshQueueEntry* entry)
 {
 	const TQ3TriMeshData* mesh = entry->mesh;
-	uint32_t statusBits = entry->mods->statusBits;
+	uint16_t state = entry->state;
+
+	// Resolve the states that depend on the scene/debug mode rather than on the mesh
+	if (!gState.sceneHasFog)
+		state &= ~kMeshState_Fog;
+	if (gDebugMode == DEBUG_MODE_NOTEXTURES)
+		state &= ~kMeshState_Texture;
+
+	// Only touch the switches that differ from the previous mesh
+	uint16_t changed = gState.shadingStateValid
+			? (state ^ gState.shadingState) & kMeshState_ShadingMask
+			: kMeshState_ShadingMask;
+
+	gState.shadingState = state;
+	gState.shadingStateValid = true;
 
 	// Always write to color mask in this pass
 	SetColorMask(GL_TRUE);
 
 	// Environment map effect
-	if (statusBits & STATUS_BIT_REFLECTIONMAP)
+	if (state & kMeshState_ReflectionMap)
 		EnvironmentMapTriMesh(mesh, entry->transform);
 
 	// Apply gouraud or null illumination
-	SetState(GL_LIGHTING,
-			!( (statusBits & STATUS_BIT_NULLSHADER) || (mesh->texturingMode & kQ3TexturingModeExt_NullShaderFlag) ));
+	if (changed & kMeshState_Lighting)
+		SetShadingState(GL_LIGHTING, kShaderFeature_Lighting, !!(state & kMeshState_Lighting));
 
 	// Apply fog or not
-	SetState(GL_FOG, gState.sceneHasFog && !(statusBits & STATUS_BIT_NOFOG));
+	if (changed & kMeshState_Fog)
+		SetShadingState(GL_FOG, kShaderFeature_Fog, !!(state & kMeshState_Fog));
 
 	// Texture mapping
-	if (gDebugMode != DEBUG_MODE_NOTEXTURES &&
-			(mesh->texturingMode & kQ3TexturingModeExt_OpacityModeMask) != kQ3TexturingModeOff)
+	if (state & kMeshState_Texture)
 	{
-		EnableState(GL_TEXTURE_2D);
-		EnableClientState(GL_TEXTURE_COORD_ARRAY);
+		if (changed & kMeshState_Texture)
+		{
+			SetShadingState(GL_TEXTURE_2D, kShaderFeature_Texture, true);
+			EnableClientState(GL_TEXTURE_COORD_ARRAY);
+		}
 		Render_BindTexture(mesh->glTextureName);
-		glTexCoordPointer(2, GL_FLOAT, 0, (statusBits & STATUS_BIT_REFLECTIONMAP) ? gEnvMapUVs: mesh->vertexUVs);
+		glTexCoordPointer(2, GL_FLOAT, 0, (state & kMeshState_ReflectionMap) ? gEnvMapUVs: mesh->vertexUVs);
+		SetUVTransform((state & kMeshState_UVTransform) && !(state & kMeshState_ReflectionMap)
+				? entry->mods : NULL);
 		CHECK_GL_ERROR();
 	}
-	else
+	else if (changed & kMeshState_Texture)
 	{
-		DisableState(GL_TEXTURE_2D);
+		SetShadingState(GL_TEXTURE_2D, kShaderFeature_Texture, false);
 		DisableClientState(GL_TEXTURE_COORD_ARRAY);
 		CHECK_GL_ERROR();
 	}
 
 	// Submit normal data if any
-	if (mesh->hasVertexNormals && !(statusBits & STATUS_BIT_NULLSHADER))
+	if (state & kMeshState_NormalArray)
 	{
-		EnableClientState(GL_NORMAL_ARRAY);
+		if (changed & kMeshState_NormalArray)
+			EnableClientState(GL_NORMAL_ARRAY);
 		glNormalPointer(GL_FLOAT, 0, mesh->vertexNormals);
 	}
-	else
+	else if (changed & kMeshState_NormalArray)
 	{
 		DisableClientState(GL_NORMAL_ARRAY);
 	}
@@ -956,18 +1148,19 @@ static void BeginShadingPass(const MeshQueueEntry* entry)
 static void PrepareOpaqueShading(const MeshQueueEntry* entry)
 {
 	const TQ3TriMeshData* mesh = entry->mesh;
-	const uint32_t statusBits = entry->mods->statusBits;
-
-	TQ3TexturingMode texturingMode = (mesh->texturingMode & kQ3TexturingModeExt_OpacityModeMask);
+	const uint16_t state = entry->state;
 
 	// Write to z-buffer
-	SetFlag(glDepthMask, !(statusBits & STATUS_BIT_NOZWRITE));
+	SetFlag(glDepthMask, !(state & kMeshState_NoZWrite));
 
 	// Enable alpha testing if the mesh's texture calls for it
-	SetState(GL_ALPHA_TEST, texturingMode == kQ3TexturingModeAlphaTest);
+	SetShadingState(GL_ALPHA_TEST, kShaderFeature_AlphaTest, !!(state & kMeshState_AlphaTest));
+
+	if (gShaderBackend)
+		RenderShaders_SetAlphaScale(1.0f);
 
 	// Per-vertex colors
-	if (mesh->hasVertexColors)
+	if (state & kMeshState_ColorArray)
 	{
 		EnableClientState(GL_COLOR_ARRAY);
 
@@ -989,10 +1182,10 @@ static void PrepareOpaqueShading(const MeshQueueEntry* entry)
 static void PrepareAlphaShading(const MeshQueueEntry* entry)
 {
 	const TQ3TriMeshData* mesh = entry->mesh;
-	const uint32_t statusBits = entry->mods->statusBits;
+	const uint16_t state = entry->state;
 
 	// Set additive alpha blending or not
-	bool wantAdditive = !!(statusBits & STATUS_BIT_GLOW);
+	bool wantAdditive = !!(state & kMeshState_Additive);
 	if (gState.blendFuncIsAdditive != wantAdditive)
 	{
 		if (wantAdditive)
@@ -1002,8 +1195,43 @@ static void PrepareAlphaShading(const MeshQueueEntry* entry)
 		gState.blendFuncIsAdditive = wantAdditive;
 	}
 
+	// The uber-shader applies auto-fade itself, so we can skip the vertex color copy below.
+	if (gShaderBackend)
+	{
+		RenderShaders_SetAlphaScale(entry->mods->autoFadeFactor);
+
+		if (state & kMeshState_ColorArray)
+		{
+			EnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(4, GL_FLOAT, 0, mesh->vertexColors);
+			if (entry->mods->autoFadeFactor < 1.0f)
+				gRenderStats.fadeCopyBytesAvoided += 4 * sizeof(float) * mesh->numPoints;
+		}
+		else
+		{
+			DisableClientState(GL_COLOR_ARRAY);
+			glColor4f(
+					mesh->diffuseColor.r * entry->mods->diffuseColor.r,
+					mesh->diffuseColor.g * entry->mods->diffuseColor.g,
+					mesh->diffuseColor.b * entry->mods->diffuseColor.b,
+					mesh->diffuseColor.a * entry->mods->diffuseColor.a);
+		}
+		return;
+	}
+
 	// Per-vertex colors
-	if (mesh->hasVertexColors)
+	if ((state & kMeshState_ColorArray) && gFadeCombinerTexture)
+	{
+		// Let texture unit 1 scale the alpha instead of copying the color array
+		EnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_FLOAT, 0, mesh->vertexColors);
+
+		float fade = entry->mods->autoFadeFactor;
+		SetFadeCombiner(fade < 1.0f, fade);
+		if (fade < 1.0f)
+			gRenderStats.fadeCopyBytesAvoided += 4 * sizeof(float) * mesh->numPoints;
+	}
+	else if (state & kMeshState_ColorArray)
 	{
 		EnableClientState(GL_COLOR_ARRAY);
 
@@ -1032,6 +1260,135 @@ static void PrepareAlphaShading(const MeshQueueEntry* entry)
 				mesh->diffuseColor.b * entry->mods->diffuseColor.b,
 				mesh->diffuseColor.a * entry->mods->diffuseColor.a * entry->mods->autoFadeFactor);
 	}
+
+	// Fade factor already baked into the color
+	if (!(state & kMeshState_ColorArray))
+		SetFadeCombiner(false, 1.0f);
+}
+
+/****************************/
+/*    UV TRANSFORM          */
+/****************************/
+
+// Loads the mesh's UV scale/offset into the texture matrix (which the uber-shader also reads).
+// Pass NULL to go back to untransformed UVs.
+static void SetUVTransform(const RenderModifiers* mods)
+{
+	if (!mods)
+	{
+		if (gState.hasUVTransform)
+		{
+			glMatrixMode(GL_TEXTURE);
+			glLoadIdentity();
+			glMatrixMode(GL_MODELVIEW);
+			gState.hasUVTransform = false;
+		}
+		return;
+	}
+
+	if (gState.hasUVTransform
+		&& gState.uvOffset.u == mods->uvOffset.u && gState.uvOffset.v == mods->uvOffset.v
+		&& gState.uvScale.u == mods->uvScale.u && gState.uvScale.v == mods->uvScale.v)
+	{
+		return;
+	}
+
+	const GLfloat m[16] =
+	{
+		mods->uvScale.u,	0,					0,	0,
+		0,					mods->uvScale.v,	0,	0,
+		0,					0,					1,	0,
+		mods->uvOffset.u,	mods->uvOffset.v,	0,	1,
+	};
+
+	glMatrixMode(GL_TEXTURE);
+	glLoadMatrixf(m);
+	glMatrixMode(GL_MODELVIEW);
+
+	gState.hasUVTransform = true;
+	gState.uvOffset = mods->uvOffset;
+	gState.uvScale = mods->uvScale;
+}
+
+/****************************/
+/*    AUTO-FADE COMBINER    */
+/****************************/
+
+static void InitFadeCombiner(void)
+{
+	gFadeCombinerTexture = 0;
+	gState.fadeCombinerEnabled = false;
+	gState.fadeCombinerAlpha = 1.0f;
+
+	GLint numTextureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_UNITS, &numTextureUnits);
+	gglActiveTexture = (PFNGLACTIVETEXTUREPROC) SDL_GL_GetProcAddress("glActiveTexture");
+
+	if (numTextureUnits < 2 || !gglActiveTexture)
+	{
+		printf("Fade combiner unavailable; auto-fade will copy vertex colors\n");
+		return;
+	}
+
+	// Unit 1 must have a texture bound to take part in the pipeline; a white texel leaves RGB untouched
+	static const uint8_t kWhite[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+	gglActiveTexture(GL_TEXTURE1);
+
+	glGenTextures(1, &gFadeCombinerTexture);
+	glBindTexture(GL_TEXTURE_2D, gFadeCombinerTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, kWhite);
+
+	// RGB = previous; A = previous * constant
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE,	GL_COMBINE);
+	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB,		GL_REPLACE);
+	glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB,		GL_PREVIOUS);
+	glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB,		GL_SRC_COLOR);
+	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA,		GL_MODULATE);
+	glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA,		GL_PREVIOUS);
+	glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA,	GL_SRC_ALPHA);
+	glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA,		GL_CONSTANT);
+	glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA,	GL_SRC_ALPHA);
+
+	const GLfloat envColor[4] = { 1, 1, 1, 1 };
+	glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, envColor);
+
+	glDisable(GL_TEXTURE_2D);
+
+	gglActiveTexture(GL_TEXTURE0);
+
+	CHECK_GL_ERROR();
+}
+
+static void SetFadeCombiner(bool enable, float alpha)
+{
+	if (!gFadeCombinerTexture)
+		return;
+
+	if (enable == gState.fadeCombinerEnabled && (!enable || alpha == gState.fadeCombinerAlpha))
+		return;
+
+	gglActiveTexture(GL_TEXTURE1);
+
+	if (enable != gState.fadeCombinerEnabled)
+	{
+		if (enable)
+			glEnable(GL_TEXTURE_2D);
+		else
+			glDisable(GL_TEXTURE_2D);
+		gState.fadeCombinerEnabled = enable;
+	}
+
+	if (enable && alpha != gState.fadeCombinerAlpha)
+	{
+		const GLfloat envColor[4] = { 1, 1, 1, alpha };
+		glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, envColor);
+		gState.fadeCombinerAlpha = alpha;
+	}
+
+	gglActiveTexture(GL_TEXTURE0);
 }
 
 void Render_ResetColor(void)
@@ -1068,6 +1425,46 @@ TQ3Vector2D FitRectKeepAR(
 	}
 }
 
+/****************************/
+/*    OCCLUSION QUERIES     */
+/****************************/
+
+// Called by RenderOcclusion_EndScene after the queue has been flushed.
+// The query boxes are in world space, so the camera's modelview matrix must be current.
+
+void Render_BeginOcclusionQueries(void)
+{
+	GAME_ASSERT(NULL == gState.currentTransform);
+
+	// Boxes only test against the depth buffer; they must leave no trace
+	SetColorMask(GL_FALSE);
+	SetFlag(glDepthMask, false);
+	EnableState(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+
+	// The camera may be inside a box, so draw both faces
+	DisableState(GL_CULL_FACE);
+
+	DisableState(GL_TEXTURE_2D);
+	DisableState(GL_BLEND);
+	DisableState(GL_LIGHTING);
+	DisableState(GL_FOG);
+	DisableState(GL_ALPHA_TEST);
+
+	EnableClientState(GL_VERTEX_ARRAY);
+	DisableClientState(GL_COLOR_ARRAY);
+	DisableClientState(GL_NORMAL_ARRAY);
+	DisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	gState.shadingStateValid = false;
+}
+
+void Render_EndOcclusionQueries(void)
+{
+	SetColorMask(GL_TRUE);
+	EnableState(GL_CULL_FACE);
+}
+
 /****************************/
 /*    2D    */
 /****************************/
@@ -0,0 +1,358 @@
+// RENDERER OCCLUSION.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+//
+// Occlusion culling for the enclosed levels (hive, anthill), where the ceiling
+// and the walls hide most of what's inside the view frustum.
+//
+// Supertiles and objects that pass the frustum test get their bounding box
+// tested against the depth buffer with a GL occlusion query, once the scene's
+// opaque geometry has been drawn. The result is picked up on the next frame:
+// if no sample of the box passed the depth test, the supertile/object is
+// skipped. The box keeps getting queried while it's skipped, so it reappears
+// one frame after it becomes visible again.
+//
+
+#include "game.h"
+#include <SDL_opengl.h>
+#include <stdio.h>
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define	NUM_SUPERTILE_OCCLUSION_SLOTS	((MAX_SUPERTILES + MAX_SUPERTILE_CACHE) * 2)
+#define	NUM_OBJECT_OCCLUSION_SLOTS		512
+#define	NUM_OCCLUSION_SLOTS				(NUM_SUPERTILE_OCCLUSION_SLOTS + NUM_OBJECT_OCCLUSION_SLOTS)
+
+#define	CAMERA_INSIDE_MARGIN			50.0f		// boxes this close to the camera may be clipped by the near plane
+
+/****************************/
+/*    GL ENTRY POINTS       */
+/****************************/
+
+// Occlusion queries are GL 1.5 (ARB_occlusion_query); get them from the driver.
+#define OCCLUSION_GL_PROCS(X)										\
+	X(PFNGLGENQUERIESPROC,			glGenQueries)					\
+	X(PFNGLDELETEQUERIESPROC,		glDeleteQueries)				\
+	X(PFNGLBEGINQUERYPROC,			glBeginQuery)					\
+	X(PFNGLENDQUERYPROC,			glEndQuery)						\
+	X(PFNGLGETQUERYOBJECTUIVPROC,	glGetQueryObjectuiv)			\
+	X(PFNGLGETQUERYIVPROC,			glGetQueryiv)
+
+#define DECLARE_PROC(type, name) static type g##name = NULL;
+OCCLUSION_GL_PROCS(DECLARE_PROC)
+#undef DECLARE_PROC
+
+/****************************/
+/*    TYPES                 */
+/****************************/
+
+typedef struct
+{
+	GLuint			query;				// 0 until first used
+	bool			pending;			// query issued, result not read back yet
+	bool			occluded;			// last result
+	bool			inUse;				// object slots only
+	uint32_t		lastTestedScene;	// result is stale if the slot wasn't tested last scene
+	TQ3BoundingBox	box;				// box to query at the end of this scene
+} OcclusionSlot;
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+static bool				gOcclusionAvailable = false;
+static bool				gOcclusionActive = false;
+static uint32_t			gOcclusionSceneCounter = 1;
+
+static OcclusionSlot	gOcclusionSlots[NUM_OCCLUSION_SLOTS];
+
+static int				gQueryList[NUM_OCCLUSION_SLOTS];		// slots to query at the end of this scene
+static int				gNumQueries = 0;
+
+static int				gObjectSlotFreeList[NUM_OBJECT_OCCLUSION_SLOTS];
+static int				gNumFreeObjectSlots = 0;
+static bool				gObjectSlotsInitialized = false;
+
+static const GLubyte	kBoxTriangles[36] =
+{
+	0,1,3, 0,3,2,		// -x
+	4,6,7, 4,7,5,		// +x
+	0,4,5, 0,5,1,		// -y
+	2,3,7, 2,7,6,		// +y
+	0,2,6, 0,6,4,		// -z
+	1,5,7, 1,7,3,		// +z
+};
+
+/****************************/
+/*    INIT                  */
+/****************************/
+
+static bool LoadProcs(void)
+{
+#define LOAD_PROC(type, name)											\
+	g##name = (type) SDL_GL_GetProcAddress(#name);						\
+	if (!g##name) { printf("Occlusion culling: missing %s\n", #name); return false; }
+	OCCLUSION_GL_PROCS(LOAD_PROC)
+#undef LOAD_PROC
+	return true;
+}
+
+bool RenderOcclusion_Init(void)
+{
+	GLint counterBits = 0;
+
+	gOcclusionAvailable = false;
+
+	if (gCommandLine.noOcclusionCulling)
+		return false;
+
+	if (!LoadProcs())
+		return false;
+
+	gglGetQueryiv(GL_SAMPLES_PASSED, GL_QUERY_COUNTER_BITS, &counterBits);
+	if (counterBits == 0)												// allowed by the spec: queries always return 0
+	{
+		printf("Occlusion culling: no sample counter\n");
+		return false;
+	}
+
+	RenderOcclusion_Reset();
+
+	gOcclusionAvailable = true;
+	return true;
+}
+
+void RenderOcclusion_Shutdown(void)
+{
+	if (!gOcclusionAvailable)
+		return;
+
+	for (int i = 0; i < NUM_OCCLUSION_SLOTS; i++)
+	{
+		if (gOcclusionSlots[i].query)
+			gglDeleteQueries(1, &gOcclusionSlots[i].query);
+		gOcclusionSlots[i].query = 0;				// query objects go away with the context
+	}
+
+	RenderOcclusion_Reset();
+	gOcclusionAvailable = false;
+	gOcclusionActive = false;
+}
+
+//
+// Forget all results (new scene setup).
+// Object slots stay with their ObjNodes, which free them in DeleteObject.
+//
+
+void RenderOcclusion_Reset(void)
+{
+	for (int i = 0; i < NUM_OCCLUSION_SLOTS; i++)
+	{
+		OcclusionSlot* slot = &gOcclusionSlots[i];
+		slot->pending = false;
+		slot->occluded = false;
+		slot->lastTestedScene = 0;
+	}
+
+	gNumQueries = 0;
+	gOcclusionActive = false;
+}
+
+/****************************/
+/*    SLOTS                 */
+/****************************/
+
+int RenderOcclusion_GetSuperTileSlot(int superTileNum, int layer)
+{
+	GAME_ASSERT(superTileNum >= 0 && superTileNum < MAX_SUPERTILES + MAX_SUPERTILE_CACHE);
+	return superTileNum * 2 + layer;
+}
+
+//
+// Drops the slot's last result, e.g. when a supertile slot gets rebuilt with another piece of terrain.
+//
+
+void RenderOcclusion_ForgetSlot(int i)
+{
+	OcclusionSlot* slot = &gOcclusionSlots[i];
+	slot->pending = false;
+	slot->occluded = false;
+	slot->lastTestedScene = 0;
+}
+
+//
+// Object slots are handed out on demand.
+// OUTPUT: -1 if none are left (the object just won't be occlusion culled).
+//
+
+int RenderOcclusion_AllocObjectSlot(void)
+{
+	if (!gObjectSlotsInitialized)
+	{
+		gNumFreeObjectSlots = 0;
+		for (int i = NUM_OBJECT_OCCLUSION_SLOTS - 1; i >= 0; i--)
+			gObjectSlotFreeList[gNumFreeObjectSlots++] = NUM_SUPERTILE_OCCLUSION_SLOTS + i;
+		gObjectSlotsInitialized = true;
+	}
+
+	if (gNumFreeObjectSlots == 0)
+		return -1;
+
+	int i = gObjectSlotFreeList[--gNumFreeObjectSlots];
+	gOcclusionSlots[i].inUse = true;
+	RenderOcclusion_ForgetSlot(i);		// an in-flight query from the previous owner is simply reissued
+	return i;
+}
+
+void RenderOcclusion_FreeObjectSlot(int i)
+{
+	if (i < 0)
+		return;
+
+	GAME_ASSERT(i >= NUM_SUPERTILE_OCCLUSION_SLOTS && i < NUM_OCCLUSION_SLOTS);
+
+	OcclusionSlot* slot = &gOcclusionSlots[i];
+	GAME_ASSERT(slot->inUse);
+
+	slot->inUse = false;
+	gObjectSlotFreeList[gNumFreeObjectSlots++] = i;
+}
+
+/****************************/
+/*    PER-SCENE             */
+/****************************/
+
+void RenderOcclusion_BeginScene(bool enable)
+{
+	gOcclusionActive = enable && gOcclusionAvailable;
+	gNumQueries = 0;
+}
+
+bool RenderOcclusion_IsActive(void)
+{
+	return gOcclusionActive;
+}
+
+static bool IsCameraNearBox(const TQ3BoundingBox* box)
+{
+	const TQ3Point3D* cam = &gGameViewInfoPtr->currentCameraCoords;
+	const float m = CAMERA_INSIDE_MARGIN + gGameViewInfoPtr->hither;
+
+	return	cam->x > box->min.x - m && cam->x < box->max.x + m
+		&&	cam->y > box->min.y - m && cam->y < box->max.y + m
+		&&	cam->z > box->min.z - m && cam->z < box->max.z + m;
+}
+
+//
+// Call this for each supertile/object that passed the frustum test.
+// The box is queried at the end of this scene.
+//
+// OUTPUT: true if the box was completely hidden last scene, i.e. skip drawing it.
+//
+
+bool RenderOcclusion_TestBox(int i, const TQ3BoundingBox* box)
+{
+	if (!gOcclusionActive || i < 0)
+		return false;
+
+	OcclusionSlot* slot = &gOcclusionSlots[i];
+
+			/* PICK UP LAST SCENE'S RESULT IF IT'S READY */
+
+	bool freshResult = false;
+
+	if (slot->pending)
+	{
+		GLuint available = GL_FALSE;
+		gglGetQueryObjectuiv(slot->query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint samples = 0;
+			gglGetQueryObjectuiv(slot->query, GL_QUERY_RESULT, &samples);
+			slot->occluded = (samples == 0);
+			slot->pending = false;
+			freshResult = true;
+		}
+	}
+
+			/* ONLY TRUST A RESULT THAT WAS JUST READ BACK FOR LAST SCENE'S QUERY */
+			//
+			// If the query is still in flight, or wasn't issued last scene,
+			// draw the box rather than act on an older result.
+			//
+
+	if (!freshResult || slot->lastTestedScene + 1 != gOcclusionSceneCounter)
+		slot->occluded = false;
+
+	slot->lastTestedScene = gOcclusionSceneCounter;
+
+			/* THE NEAR PLANE MAY CLIP THE BOX, SO IT CAN'T BE QUERIED */
+
+	if (IsCameraNearBox(box))
+	{
+		slot->occluded = false;
+		return false;
+	}
+
+			/* QUEUE A NEW QUERY */
+
+	if (!slot->pending)
+	{
+		slot->box = *box;
+		gQueryList[gNumQueries++] = i;
+	}
+
+	return slot->occluded;
+}
+
+//
+// Issues the queries for all boxes tested during this scene.
+// Call this once the scene's opaque geometry is in the depth buffer.
+//
+
+void RenderOcclusion_EndScene(void)
+{
+	if (!gOcclusionActive)
+		return;
+
+	gOcclusionActive = false;
+	gOcclusionSceneCounter++;
+
+	if (gNumQueries == 0)
+		return;
+
+	Render_BeginOcclusionQueries();
+
+	for (int q = 0; q < gNumQueries; q++)
+	{
+		OcclusionSlot* slot = &gOcclusionSlots[gQueryList[q]];
+		const TQ3BoundingBox* b = &slot->box;
+
+		const TQ3Point3D corners[8] =
+		{
+			{ b->min.x, b->min.y, b->min.z },
+			{ b->min.x, b->min.y, b->max.z },
+			{ b->min.x, b->max.y, b->min.z },
+			{ b->min.x, b->max.y, b->max.z },
+			{ b->max.x, b->min.y, b->min.z },
+			{ b->max.x, b->min.y, b->max.z },
+			{ b->max.x, b->max.y, b->min.z },
+			{ b->max.x, b->max.y, b->max.z },
+		};
+
+		if (!slot->query)
+			gglGenQueries(1, &slot->query);
+
+		gglBeginQuery(GL_SAMPLES_PASSED, slot->query);
+		glVertexPointer(3, GL_FLOAT, 0, corners);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, kBoxTriangles);
+		gglEndQuery(GL_SAMPLES_PASSED);
+
+		slot->pending = true;
+	}
+
+	Render_EndOcclusionQueries();
+
+	gNumQueries = 0;
+}
@@ -0,0 +1,272 @@
+// RENDERER SHADERS.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+//
+// Uber-shader backend for the renderer (--shader-renderer).
+//
+// The fixed-function switches that Renderer.c flips per mesh (lighting, fog,
+// texturing, alpha test) become uniforms of a single GLSL program, and the
+// auto-fade factor is applied in the shader instead of rewriting the vertex
+// color array on the CPU. Lights, fog parameters and matrices are still set
+// through the regular GL calls; the shader reads them back via the built-in
+// gl_LightSource/gl_Fog/gl_ModelViewMatrix state.
+//
+
+#include "game.h"
+#include <SDL_opengl.h>
+#include <stdio.h>
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define SHADER_INFO_LOG_SIZE	1024
+
+static const char* kVertexShaderSource =
+	"#version 120\n"
+	"uniform bool uLighting;\n"
+	"uniform int uNumLights;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 eyePos = gl_ModelViewMatrix * gl_Vertex;\n"
+	"	gl_Position = ftransform();\n"
+	"	gl_FogFragCoord = abs(eyePos.z);\n"
+	"	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+	"	vec4 color = gl_Color;\n"
+	"	if (uLighting)\n"
+	"	{\n"
+	"		vec3 n = normalize(gl_NormalMatrix * gl_Normal);\n"		// same as GL_NORMALIZE
+	"		vec3 lit = gl_LightModel.ambient.rgb;\n"
+	"		for (int i = 0; i < MAX_FILL_LIGHTS; i++)\n"
+	"		{\n"
+	"			if (i < uNumLights)\n"								// fill lights are all directional
+	"				lit += gl_LightSource[i].diffuse.rgb * max(dot(n, normalize(gl_LightSource[i].position.xyz)), 0.0);\n"
+	"		}\n"
+	"		color.rgb = clamp(color.rgb * lit, 0.0, 1.0);\n"		// GL_COLOR_MATERIAL: ambient & diffuse track the vertex color
+	"	}\n"
+	"	gl_FrontColor = color;\n"
+	"	gl_BackColor = color;\n"
+	"}\n";
+
+static const char* kFragmentShaderSource =
+	"#version 120\n"
+	"uniform sampler2D uDiffuseMap;\n"
+	"uniform bool uTexture;\n"
+	"uniform bool uAlphaTest;\n"
+	"uniform bool uFog;\n"
+	"uniform float uAlphaScale;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 color = gl_Color;\n"
+	"	if (uTexture)\n"
+	"		color *= texture2D(uDiffuseMap, gl_TexCoord[0].st);\n"
+	"	color.a *= uAlphaScale;\n"
+	"	if (uAlphaTest && color.a <= 0.4999)\n"						// matches glAlphaFunc in Render_InitState
+	"		discard;\n"
+	"	if (uFog)\n"
+	"		color.rgb = mix(gl_Fog.color.rgb, color.rgb, clamp((gl_Fog.end - gl_FogFragCoord) * gl_Fog.scale, 0.0, 1.0));\n"
+	"	gl_FragColor = color;\n"
+	"}\n";
+
+/****************************/
+/*    GL ENTRY POINTS       */
+/****************************/
+
+// GL 2.0 entry points aren't exported by every platform's GL library (e.g. opengl32.dll),
+// so get them from the driver once the context exists.
+#define SHADER_GL_PROCS(X)										\
+	X(PFNGLCREATESHADERPROC,		glCreateShader)				\
+	X(PFNGLSHADERSOURCEPROC,		glShaderSource)				\
+	X(PFNGLCOMPILESHADERPROC,		glCompileShader)			\
+	X(PFNGLGETSHADERIVPROC,			glGetShaderiv)				\
+	X(PFNGLGETSHADERINFOLOGPROC,	glGetShaderInfoLog)			\
+	X(PFNGLDELETESHADERPROC,		glDeleteShader)				\
+	X(PFNGLCREATEPROGRAMPROC,		glCreateProgram)			\
+	X(PFNGLATTACHSHADERPROC,		glAttachShader)				\
+	X(PFNGLLINKPROGRAMPROC,			glLinkProgram)				\
+	X(PFNGLGETPROGRAMIVPROC,		glGetProgramiv)				\
+	X(PFNGLGETPROGRAMINFOLOGPROC,	glGetProgramInfoLog)		\
+	X(PFNGLDELETEPROGRAMPROC,		glDeleteProgram)			\
+	X(PFNGLUSEPROGRAMPROC,			glUseProgram)				\
+	X(PFNGLGETUNIFORMLOCATIONPROC,	glGetUniformLocation)		\
+	X(PFNGLUNIFORM1IPROC,			glUniform1i)				\
+	X(PFNGLUNIFORM1FPROC,			glUniform1f)
+
+#define DECLARE_PROC(type, name) static type g##name = NULL;
+SHADER_GL_PROCS(DECLARE_PROC)
+#undef DECLARE_PROC
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+static GLuint		gProgram = 0;
+
+static GLint		gFeatureUniforms[NUM_SHADER_FEATURES];
+static GLint		gAlphaScaleUniform = -1;
+static GLint		gNumLightsUniform = -1;
+
+	/* CACHED UNIFORM VALUES (avoid redundant glUniform calls) */
+
+static uint32_t		gFeatureBits = 0;
+static float		gAlphaScale = 1.0f;
+static int			gNumLights = -1;
+
+/****************************/
+/*    INIT                  */
+/****************************/
+
+static bool LoadProcs(void)
+{
+#define LOAD_PROC(type, name)											\
+	g##name = (type) SDL_GL_GetProcAddress(#name);						\
+	if (!g##name) { printf("Shader renderer: missing %s\n", #name); return false; }
+	SHADER_GL_PROCS(LOAD_PROC)
+#undef LOAD_PROC
+	return true;
+}
+
+static GLuint CompileShader(GLenum type, const char* source)
+{
+	char defines[64];
+	snprintf(defines, sizeof(defines), "#define MAX_FILL_LIGHTS %d\n", MAX_FILL_LIGHTS);
+
+	// #version must come first, so splice the defines in after it
+	const char* versionEnd = strchr(source, '\n') + 1;
+	const GLchar* parts[3] = { source, defines, versionEnd };
+	const GLint lengths[3] = { (GLint) (versionEnd - source), -1, -1 };
+
+	GLuint shader = gglCreateShader(type);
+	gglShaderSource(shader, 3, parts, lengths);
+	gglCompileShader(shader);
+
+	GLint ok = GL_FALSE;
+	gglGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok)
+	{
+		char log[SHADER_INFO_LOG_SIZE];
+		gglGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		printf("Shader renderer: compile error:\n%s\n", log);
+		gglDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+bool RenderShaders_Init(void)
+{
+	GAME_ASSERT(gProgram == 0);
+
+	if (!LoadProcs())
+		return false;
+
+	GLuint vs = CompileShader(GL_VERTEX_SHADER, kVertexShaderSource);
+	GLuint fs = CompileShader(GL_FRAGMENT_SHADER, kFragmentShaderSource);
+
+	if (!vs || !fs)
+	{
+		if (vs) gglDeleteShader(vs);
+		if (fs) gglDeleteShader(fs);
+		return false;
+	}
+
+	GLuint program = gglCreateProgram();
+	gglAttachShader(program, vs);
+	gglAttachShader(program, fs);
+	gglLinkProgram(program);
+	gglDeleteShader(vs);			// flagged for deletion; freed along with the program
+	gglDeleteShader(fs);
+
+	GLint ok = GL_FALSE;
+	gglGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok)
+	{
+		char log[SHADER_INFO_LOG_SIZE];
+		gglGetProgramInfoLog(program, sizeof(log), NULL, log);
+		printf("Shader renderer: link error:\n%s\n", log);
+		gglDeleteProgram(program);
+		return false;
+	}
+
+	gProgram = program;
+
+	gFeatureUniforms[kShaderFeature_Lighting]	= gglGetUniformLocation(program, "uLighting");
+	gFeatureUniforms[kShaderFeature_Fog]		= gglGetUniformLocation(program, "uFog");
+	gFeatureUniforms[kShaderFeature_Texture]	= gglGetUniformLocation(program, "uTexture");
+	gFeatureUniforms[kShaderFeature_AlphaTest]	= gglGetUniformLocation(program, "uAlphaTest");
+	gAlphaScaleUniform							= gglGetUniformLocation(program, "uAlphaScale");
+	gNumLightsUniform							= gglGetUniformLocation(program, "uNumLights");
+
+	// Set initial uniform values to match our cache
+	gglUseProgram(program);
+	gglUniform1i(gglGetUniformLocation(program, "uDiffuseMap"), 0);
+	for (int i = 0; i < NUM_SHADER_FEATURES; i++)
+		gglUniform1i(gFeatureUniforms[i], 0);
+	gglUniform1f(gAlphaScaleUniform, 1.0f);
+	gglUseProgram(0);
+
+	gFeatureBits = 0;
+	gAlphaScale = 1.0f;
+	gNumLights = -1;
+
+	CHECK_GL_ERROR();
+
+	printf("Shader renderer enabled\n");
+	return true;
+}
+
+void RenderShaders_Shutdown(void)
+{
+	if (gProgram)
+	{
+		gglDeleteProgram(gProgram);
+		gProgram = 0;
+	}
+}
+
+/****************************/
+/*    PER-FLUSH STATE       */
+/****************************/
+
+void RenderShaders_Begin(int numFillLights)
+{
+	GAME_ASSERT(gProgram);
+
+	gglUseProgram(gProgram);
+
+	if (numFillLights != gNumLights)
+	{
+		gglUniform1i(gNumLightsUniform, numFillLights);
+		gNumLights = numFillLights;
+	}
+}
+
+void RenderShaders_End(void)
+{
+	// Hand the pipeline back to fixed-function for immediate-mode debug drawing
+	gglUseProgram(0);
+}
+
+/****************************/
+/*    PER-MESH STATE        */
+/****************************/
+
+void RenderShaders_SetFeature(ShaderFeature feature, bool enable)
+{
+	uint32_t bit = 1u << feature;
+
+	if (!!(gFeatureBits & bit) == enable)
+		return;
+
+	gglUniform1i(gFeatureUniforms[feature], enable);
+	gFeatureBits ^= bit;
+}
+
+void RenderShaders_SetAlphaScale(float alphaScale)
+{
+	if (alphaScale == gAlphaScale)
+		return;
+
+	gglUniform1f(gAlphaScaleUniform, alphaScale);
+	gAlphaScale = alphaScale;
+}
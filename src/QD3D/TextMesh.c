@@ -22,6 +22,37 @@ static GLuint gFontTexture = 0;
 static float gLineHeight = 0;
 static AtlasGlyph gAtlasGlyphs[MAX_CODEPOINTS];
 
+#define TEXT_LAYOUT_CACHE_SIZE		32
+#define TEXT_LAYOUT_MEMO_MAX_LENGTH	4096
+
+// Everything in a TextMeshDef that affects glyph placement
+typedef struct
+{
+	TQ3Point3D		origin;
+	int				align;
+	float			spacing;
+} TextLayoutParams;
+
+typedef struct
+{
+	TQ3TriMeshData*		mesh;			// prebuilt layout (nil if slot is free)
+	char*				text;
+	uint32_t			hash;
+	TextLayoutParams	params;
+	uint32_t			lastUsed;
+} TextLayoutCacheEntry;
+
+static TextLayoutCacheEntry	gTextLayoutCache[TEXT_LAYOUT_CACHE_SIZE];
+static uint32_t				gTextLayoutCacheClock = 0;
+
+// Remembers what was last laid out into a recycled mesh, so we can rewrite just the glyphs that changed
+static struct
+{
+	const TQ3TriMeshData*	mesh;
+	TextLayoutParams		params;
+	char					text[TEXT_LAYOUT_MEMO_MAX_LENGTH];
+} gRecycledLayoutMemo;
+
 static const TextMeshDef gDefaultTextMeshDef =
 {
 	.coord				= { 0, 0, 0 },
@@ -36,54 +67,288 @@ static const TextMeshDef gDefaultTextMeshDef =
 	.letterSpacing		= 0,
 };
 
-TQ3TriMeshData* TextMesh_CreateMesh(const TextMeshDef* def, const char* text)
+/****************************/
+/*    LAYOUT HELPERS        */
+/****************************/
+
+static void GetLayoutParams(const TextMeshDef* def, TextLayoutParams* params)
 {
-	return TextMesh_SetMesh(def, text, NULL);
+	if (!def)
+		def = &gDefaultTextMeshDef;
+
+	*params = (TextLayoutParams)
+	{
+		.origin		= def->meshOrigin,
+		.align		= def->align,
+		.spacing	= def->letterSpacing,
+	};
 }
 
-TQ3TriMeshData* TextMesh_SetMesh(const TextMeshDef* def, const char* text, TQ3TriMeshData* recycleMesh)
+static bool LayoutParamsEqual(const TextLayoutParams* a, const TextLayoutParams* b)
 {
-	float x = gDefaultTextMeshDef.meshOrigin.x;
-	float y = gDefaultTextMeshDef.meshOrigin.y;
-	float z = gDefaultTextMeshDef.meshOrigin.z;
-	int align = gDefaultTextMeshDef.align;
-	float spacing = gDefaultTextMeshDef.letterSpacing;
-	if (def)
+	return a->origin.x == b->origin.x
+		&& a->origin.y == b->origin.y
+		&& a->origin.z == b->origin.z
+		&& a->align == b->align
+		&& a->spacing == b->spacing;
+}
+
+static int CountQuads(const char* text)
+{
+	int numQuads = 0;
+	for (const char* c = text; *c; c++)
 	{
-		x = def->meshOrigin.x;
-		y = def->meshOrigin.y;
-		z = def->meshOrigin.z;
-		align = def->align;
-		spacing = def->letterSpacing;
+		if (*c != ' ' && *c != '\n')
+			numQuads++;
 	}
+	return numQuads;
+}
 
-//	GAME_ASSERT(gAtlasGlyphs);
-	GAME_ASSERT(gFontTexture);
+// Returns the start x of the line beginning at 'line', taking alignment into account.
+static float GetLineStartX(const TextLayoutParams* params, const char* line)
+{
+	if (params->align == TEXTMESH_ALIGN_LEFT)
+		return params->origin.x;
 
-	// Compute number of quads and line width
 	float lineWidth = 0;
-	int numQuads = 0;
+	for (const char* c = line; *c && *c != '\n'; c++)
+		lineWidth += gAtlasGlyphs[(uint8_t) *c].xadv + params->spacing;
+
+	if (params->align == TEXTMESH_ALIGN_CENTER)
+		return params->origin.x - lineWidth * .5f;
+	else
+		return params->origin.x - lineWidth;
+}
+
+// Writes a quad for each glyph in the text.
+// Glyphs before firstDirtyChar are assumed to already be in the mesh and are skipped.
+static void WriteGlyphQuads(TQ3TriMeshData* mesh, const TextLayoutParams* params, const char* text, int firstDirtyChar)
+{
+	const float z = params->origin.z;
+	float y = params->origin.y + gLineHeight * .7f;			// adjust y for ascender
+	float x = GetLineStartX(params, text);
+
+	int t = 0;
+	int p = 0;
 	for (const char* c = text; *c; c++)
 	{
-		if (*c == '\n')		// TODO: line widths for strings containing line breaks aren't supported yet
+		if (*c == '\n')
+		{
+			x = GetLineStartX(params, c + 1);
+			y -= gLineHeight;
 			continue;
+		}
 
 		const AtlasGlyph g = gAtlasGlyphs[(uint8_t) *c];
-		lineWidth += g.xadv + spacing;
-		if (*c != ' ')
-			numQuads++;
+
+		if (*c == ' ')
+		{
+			x += g.xadv + params->spacing;
+			continue;
+		}
+
+		if (c - text >= firstDirtyChar)
+		{
+			float qx = x + g.xoff + g.w*.5f;
+			float qy = y - g.yoff - g.h*.5f;
+
+			mesh->triangles[t + 0].pointIndices[0] = p + 0;
+			mesh->triangles[t + 0].pointIndices[1] = p + 1;
+			mesh->triangles[t + 0].pointIndices[2] = p + 2;
+			mesh->triangles[t + 1].pointIndices[0] = p + 0;
+			mesh->triangles[t + 1].pointIndices[1] = p + 2;
+			mesh->triangles[t + 1].pointIndices[2] = p + 3;
+			mesh->points[p + 0] = (TQ3Point3D) { qx - g.w*.5f, qy - g.h*.5f, z };
+			mesh->points[p + 1] = (TQ3Point3D) { qx + g.w*.5f, qy - g.h*.5f, z };
+			mesh->points[p + 2] = (TQ3Point3D) { qx + g.w*.5f, qy + g.h*.5f, z };
+			mesh->points[p + 3] = (TQ3Point3D) { qx - g.w*.5f, qy + g.h*.5f, z };
+			mesh->vertexUVs[p + 0] = (TQ3Param2D) { g.x/512.0f,			(g.y+g.h)/256.0f };
+			mesh->vertexUVs[p + 1] = (TQ3Param2D) { (g.x+g.w)/512.0f,	(g.y+g.h)/256.0f };
+			mesh->vertexUVs[p + 2] = (TQ3Param2D) { (g.x+g.w)/512.0f,	g.y/256.0f };
+			mesh->vertexUVs[p + 3] = (TQ3Param2D) { g.x/512.0f,			g.y/256.0f };
+		}
+
+		x += g.xadv + params->spacing;
+		t += 2;
+		p += 4;
+	}
+
+	GAME_ASSERT(p == mesh->numPoints);
+}
+
+/****************************/
+/*    RECYCLED MESH MEMO    */
+/****************************/
+
+//
+// Returns how many leading characters of the text are laid out exactly as they
+// already are in the recycled mesh (i.e. the glyph quads needn't be rewritten).
+//
+
+static int GetReusableLayoutPrefix(const TQ3TriMeshData* mesh, const TextLayoutParams* params, const char* text)
+{
+	if (gRecycledLayoutMemo.mesh != mesh || !LayoutParamsEqual(&gRecycledLayoutMemo.params, params))
+		return 0;
+
+	const char* prev = gRecycledLayoutMemo.text;
+	int n = 0;
+	while (text[n] && text[n] == prev[n])
+		n++;
+
+	// With centered/right alignment, the line where the first change occurs may have a different
+	// width, which would shift all of its glyphs. So only reuse the lines before it.
+	if (params->align != TEXTMESH_ALIGN_LEFT && (text[n] || prev[n]))
+	{
+		while (n > 0 && text[n-1] != '\n')
+			n--;
+	}
+
+	return n;
+}
+
+static void RememberLayout(const TQ3TriMeshData* mesh, const TextLayoutParams* params, const char* text)
+{
+	size_t length = strlen(text);
+
+	if (length >= sizeof(gRecycledLayoutMemo.text))		// too long to remember
+	{
+		gRecycledLayoutMemo.mesh = NULL;
+		return;
+	}
+
+	gRecycledLayoutMemo.mesh = mesh;
+	gRecycledLayoutMemo.params = *params;
+	memcpy(gRecycledLayoutMemo.text, text, length + 1);
+}
+
+void TextMesh_ForgetRecycledMesh(const TQ3TriMeshData* mesh)
+{
+	if (gRecycledLayoutMemo.mesh == mesh)
+		gRecycledLayoutMemo.mesh = NULL;
+}
+
+/****************************/
+/*    LAYOUT CACHE          */
+/****************************/
+
+static uint32_t HashText(const char* text)
+{
+	uint32_t hash = 2166136261u;			// FNV-1a
+	for (const char* c = text; *c; c++)
+	{
+		hash ^= (uint8_t) *c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static TextLayoutCacheEntry* FindCachedLayout(const TextLayoutParams* params, const char* text, uint32_t hash)
+{
+	for (int i = 0; i < TEXT_LAYOUT_CACHE_SIZE; i++)
+	{
+		TextLayoutCacheEntry* entry = &gTextLayoutCache[i];
+		if (entry->mesh
+			&& entry->hash == hash
+			&& LayoutParamsEqual(&entry->params, params)
+			&& 0 == strcmp(entry->text, text))
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void CacheLayout(const TextLayoutParams* params, const char* text, uint32_t hash, const TQ3TriMeshData* mesh)
+{
+	// Pick a free slot or the least recently used one
+	TextLayoutCacheEntry* victim = &gTextLayoutCache[0];
+	for (int i = 0; i < TEXT_LAYOUT_CACHE_SIZE; i++)
+	{
+		TextLayoutCacheEntry* entry = &gTextLayoutCache[i];
+		if (!entry->mesh)
+		{
+			victim = entry;
+			break;
+		}
+		if (entry->lastUsed < victim->lastUsed)
+			victim = entry;
+	}
+
+	if (victim->mesh)
+	{
+		Q3TriMeshData_Dispose(victim->mesh);
+		DisposePtr(victim->text);
+	}
+
+	size_t length = strlen(text);
+	victim->text = NewPtr(length + 1);
+	memcpy(victim->text, text, length + 1);
+	victim->hash = hash;
+	victim->params = *params;
+	victim->mesh = Q3TriMeshData_Duplicate(mesh);
+	victim->lastUsed = ++gTextLayoutCacheClock;
+}
+
+static void PurgeLayoutCache(void)
+{
+	for (int i = 0; i < TEXT_LAYOUT_CACHE_SIZE; i++)
+	{
+		TextLayoutCacheEntry* entry = &gTextLayoutCache[i];
+		if (entry->mesh)
+		{
+			Q3TriMeshData_Dispose(entry->mesh);
+			DisposePtr(entry->text);
+		}
 	}
+	memset(gTextLayoutCache, 0, sizeof(gTextLayoutCache));
+	gRecycledLayoutMemo.mesh = NULL;
+}
 
-	// Adjust start x for text alignment
-	if (align == TEXTMESH_ALIGN_CENTER)
-		x -= lineWidth * .5f;
-	else if (align == TEXTMESH_ALIGN_RIGHT)
-		x -= lineWidth;
+/****************************/
+/*    MESH CREATION         */
+/****************************/
 
-	float x0 = x;
+//
+// Returns a new mesh that the caller owns.
+// Layouts of recently-created strings are cached, so recreating the same
+// text (e.g. when a menu screen is rebuilt) is just a copy.
+//
 
-	// Adjust y for ascender
-	y += gLineHeight * .7f;
+TQ3TriMeshData* TextMesh_CreateMesh(const TextMeshDef* def, const char* text)
+{
+	TextLayoutParams params;
+	GetLayoutParams(def, &params);
+
+	uint32_t hash = HashText(text);
+
+	TextLayoutCacheEntry* cached = FindCachedLayout(&params, text, hash);
+	if (cached)
+	{
+		cached->lastUsed = ++gTextLayoutCacheClock;
+		return Q3TriMeshData_Duplicate(cached->mesh);
+	}
+
+	TQ3TriMeshData* mesh = TextMesh_SetMesh(def, text, NULL);
+	CacheLayout(&params, text, hash, mesh);
+	return mesh;
+}
+
+//
+// Lays out the text into a mesh.
+// If recycleMesh is given, it must have enough capacity for all the glyphs.
+// When the same recycleMesh is passed in repeatedly, only the glyphs that changed
+// since the previous call are rewritten.
+//
+
+TQ3TriMeshData* TextMesh_SetMesh(const TextMeshDef* def, const char* text, TQ3TriMeshData* recycleMesh)
+{
+	TextLayoutParams params;
+	GetLayoutParams(def, &params);
+
+	GAME_ASSERT(gFontTexture);
+
+	int numQuads = CountQuads(text);
+	int firstDirtyChar = 0;
 
 	// Create the mesh
 	TQ3TriMeshData* mesh;
@@ -95,6 +360,7 @@ TQ3TriMeshData* TextMesh_SetMesh(const TextMeshDef* def, const char* text, TQ3Tr
 		GAME_ASSERT(mesh->vertexUVs);
 		mesh->numTriangles = numQuads*2;
 		mesh->numPoints = numQuads*4;
+		firstDirtyChar = GetReusableLayoutPrefix(mesh, &params, text);
 	}
 	else
 	{
@@ -104,49 +370,10 @@ TQ3TriMeshData* TextMesh_SetMesh(const TextMeshDef* def, const char* text, TQ3Tr
 	mesh->glTextureName = gFontTexture;
 
 	// Create a quad for each character
-	int t = 0;
-	int p = 0;
-	for (const char* c = text; *c; c++)
-	{
-		if (*c == '\n')
-		{
-			x = x0;
-			y -= gLineHeight;
-			continue;
-		}
-
-		const AtlasGlyph g = gAtlasGlyphs[(uint8_t) *c];
+	WriteGlyphQuads(mesh, &params, text, firstDirtyChar);
 
-		if (*c == ' ')
-		{
-			x += g.xadv + spacing;
-			continue;
-		}
-
-		float qx = x + g.xoff + g.w*.5f;
-		float qy = y - g.yoff - g.h*.5f;
-
-		mesh->triangles[t + 0].pointIndices[0] = p + 0;
-		mesh->triangles[t + 0].pointIndices[1] = p + 1;
-		mesh->triangles[t + 0].pointIndices[2] = p + 2;
-		mesh->triangles[t + 1].pointIndices[0] = p + 0;
-		mesh->triangles[t + 1].pointIndices[1] = p + 2;
-		mesh->triangles[t + 1].pointIndices[2] = p + 3;
-		mesh->points[p + 0] = (TQ3Point3D) { qx - g.w*.5f, qy - g.h*.5f, z };
-		mesh->points[p + 1] = (TQ3Point3D) { qx + g.w*.5f, qy - g.h*.5f, z };
-		mesh->points[p + 2] = (TQ3Point3D) { qx + g.w*.5f, qy + g.h*.5f, z };
-		mesh->points[p + 3] = (TQ3Point3D) { qx - g.w*.5f, qy + g.h*.5f, z };
-		mesh->vertexUVs[p + 0] = (TQ3Param2D) { g.x/512.0f,			(g.y+g.h)/256.0f };
-		mesh->vertexUVs[p + 1] = (TQ3Param2D) { (g.x+g.w)/512.0f,	(g.y+g.h)/256.0f };
-		mesh->vertexUVs[p + 2] = (TQ3Param2D) { (g.x+g.w)/512.0f,	g.y/256.0f };
-		mesh->vertexUVs[p + 3] = (TQ3Param2D) { g.x/512.0f,			g.y/256.0f };
-
-		x += g.xadv + spacing;
-		t += 2;
-		p += 4;
-	}
-
-	GAME_ASSERT(p == mesh->numPoints);
+	if (recycleMesh)
+		RememberLayout(mesh, &params, text);
 
 	return mesh;
 }
@@ -252,6 +479,8 @@ void TextMesh_Init(void)
 
 void TextMesh_Shutdown(void)
 {
+	PurgeLayoutCache();			// cached meshes refer to the font texture
+
 #if 0
 	if (gAtlasGlyphs)
 	{
@@ -12,6 +12,12 @@
 
 #include "game.h"
 #include <stdio.h>
+#include <limits.h>
+
+#if __SSE2__ || _M_X64 || (_M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INFOBAR_SSE2 1
+#endif
 
 
 /****************************/
@@ -67,6 +73,11 @@ static void ShowBossHealth(void);
 
 #define	INFOBAR_TEXTURE_WIDTH	1024
 #define	INFOBAR_TEXTURE_HEIGHT	128
+
+#define	MAX_INFOBAR_DAMAGE_RECTS	8
+#define	INFOBAR_DAMAGE_MERGE_SLACK	2048		// merge two damage rects if their union wastes fewer pixels than this
+
+#define	NITRO_GAUGE_LEVELS		181				// arc positions 0..180 (degrees)
 #define	BOTTOM_BAR_Y_IN_TEXTURE	64
 
 
@@ -157,8 +168,8 @@ static TQ3TriMeshData*	gInfobarBottomMesh = nil;
 
 static uint32_t*	gInfobarTexture = nil;
 static GLuint		gInfobarTextureName = 0;
-static Rect			gInfobarTextureDirtyRect;
-static Boolean		gInfobarTextureIsDirty = true;
+static Rect			gInfobarDamageRects[MAX_INFOBAR_DAMAGE_RECTS];
+static int			gNumInfobarDamageRects = 0;
 
 static Byte		gLeftArmType, gRightArmType;
 static Byte		gOldLeftArmType, gOldRightArmType;
@@ -166,10 +177,12 @@ static Byte		gOldLeftArmType, gOldRightArmType;
 static Boolean	gBallIconIsDisplayed;
 static Boolean	gBossHealthWasUpdated;
 
-static const int	gNitroGaugeMaxSkipsPerRow = 8;
 static Rect			gNitroGaugeRect;
 static uint8_t*		gNitroGaugeData		= nil;
-static int*			gNitroGaugeAlphaSkips	= nil;
+static uint32_t*	gNitroGaugePixels	= nil;							// infobar texture offsets of opaque gauge pixels, sorted by arc position
+static int			gNitroGaugeLevelStart[NITRO_GAUGE_LEVELS + 1];		// index of 1st pixel of each arc position in gNitroGaugePixels
+static Rect			gNitroGaugeLevelBounds[NITRO_GAUGE_LEVELS];			// bounding rect of the pixels at each arc position
+static int			gNitroGaugeDrawnSpan = -1;							// arc span currently in the texture (-1: must redraw everything)
 
 /**************** INIT INVENTORY FOR GAME *********************/
 
@@ -244,7 +257,8 @@ void DisposeInfobarTexture(void)
 		gInfobarBottomMesh = nil;
 	}
 
-	gInfobarTextureIsDirty = true;
+	gNumInfobarDamageRects = 0;
+	gNitroGaugeDrawnSpan = -1;
 }
 
 /*************** INIT INFOBAR **********************/
@@ -285,6 +299,8 @@ void InitInfobar(void)
 	);
 	CHECK_GL_ERROR();
 
+	gNumInfobarDamageRects = 0;			// whole texture was just uploaded
+
 			/* CREATE TOP MESH */
 
 	float uMult = 1.0f / INFOBAR_TEXTURE_WIDTH;
@@ -456,34 +472,52 @@ static void LoadNitroGaugeTemplate(void)
 	gNitroGaugeRect.top			= TIMER_Y;
 	gNitroGaugeRect.bottom		= gNitroGaugeRect.top + tga.height;
 
-	// Prepare alpha skip table. The nitro gauge is mostly made up of transparent pixels,
-	// so this will speed up rendering a little.
+	// Sort the opaque pixels by arc position, so that redrawing the gauge only
+	// needs to touch the pixels whose color depends on the arc positions that changed.
+
+	const int numTemplatePixels = tga.width * tga.height;
+	int levelCounts[NITRO_GAUGE_LEVELS] = {0};
+	int numOpaque = 0;
+
+	for (int i = 0; i < numTemplatePixels; i++)
+	{
+		uint8_t t = gNitroGaugeData[i];
+		if (t == 0)													// zero is reserved for mask
+			continue;
+		GAME_ASSERT(t <= NITRO_GAUGE_LEVELS);
+		levelCounts[t - 1]++;
+		numOpaque++;
+	}
+
+	gNitroGaugePixels = (uint32_t*) NewPtrClear(sizeof(uint32_t) * (numOpaque > 0 ? numOpaque : 1));
+
+	gNitroGaugeLevelStart[0] = 0;
+	for (int t = 0; t < NITRO_GAUGE_LEVELS; t++)
+	{
+		gNitroGaugeLevelStart[t + 1] = gNitroGaugeLevelStart[t] + levelCounts[t];
+		gNitroGaugeLevelBounds[t] = (Rect) { .top=SHRT_MAX, .left=SHRT_MAX, .bottom=SHRT_MIN, .right=SHRT_MIN };
+		levelCounts[t] = 0;											// reuse as fill cursor
+	}
 
-	gNitroGaugeAlphaSkips	= (int*) NewPtrClear(tga.height * gNitroGaugeMaxSkipsPerRow * sizeof(int));
-	uint8_t*	grayscale	= gNitroGaugeData;
-	int*		skipTable	= gNitroGaugeAlphaSkips;
 	for (int y = 0; y < tga.height; y++)
 	{
-		int skipsThisRow = 0;
-		int* currentSkip = nil;
 		for (int x = 0; x < tga.width; x++)
 		{
-			if ((*grayscale++) != 0)
-			{
-				currentSkip = nil;
-			}
-			else if (!currentSkip)
-			{
-				GAME_ASSERT(skipsThisRow < gNitroGaugeMaxSkipsPerRow);
-				currentSkip = &skipTable[skipsThisRow++];
-				*currentSkip = 1;
-			}
-			else
-			{
-				(*currentSkip)++;
-			}
+			uint8_t t = gNitroGaugeData[y * tga.width + x];
+			if (t == 0)
+				continue;
+			t--;
+
+			int tx = gNitroGaugeRect.left + x;
+			int ty = gNitroGaugeRect.top + y;
+			gNitroGaugePixels[gNitroGaugeLevelStart[t] + levelCounts[t]++] = ty * INFOBAR_TEXTURE_WIDTH + tx;
+
+			Rect* bounds = &gNitroGaugeLevelBounds[t];
+			if (tx < bounds->left)		bounds->left	= tx;
+			if (ty < bounds->top)		bounds->top		= ty;
+			if (tx >= bounds->right)	bounds->right	= tx + 1;
+			if (ty >= bounds->bottom)	bounds->bottom	= ty + 1;
 		}
-		skipTable += gNitroGaugeMaxSkipsPerRow;
 	}
 }
 
@@ -512,10 +546,10 @@ void FreeInfobarArt(void)
 		gNitroGaugeData = nil;
 	}
 	
-	if (gNitroGaugeAlphaSkips != nil)
+	if (gNitroGaugePixels != nil)
 	{
-		DisposePtr((Ptr) gNitroGaugeAlphaSkips);
-		gNitroGaugeAlphaSkips = nil;
+		DisposePtr((Ptr) gNitroGaugePixels);
+		gNitroGaugePixels = nil;
 	}
 
 	if (gInfobarArtLoaded)
@@ -540,39 +574,90 @@ static uint32_t* GetInfobarTextureOffset(int x, int y)
 	return out;
 }
 
+static inline int RectArea(const Rect* r)
+{
+	return (r->right - r->left) * (r->bottom - r->top);
+}
+
+static inline Rect RectUnion(const Rect* a, const Rect* b)
+{
+	Rect u;
+	u.left		= a->left	< b->left	? a->left	: b->left;
+	u.top		= a->top	< b->top	? a->top	: b->top;
+	u.right		= a->right	> b->right	? a->right	: b->right;
+	u.bottom	= a->bottom	> b->bottom	? a->bottom	: b->bottom;
+	return u;
+}
+
+//
+// Adds a rect to the damage list.
+//
+// Each damage rect costs one glTexSubImage2D call when the infobar is submitted,
+// so rects that are close together are merged if the union doesn't waste too
+// many pixels. Distant rects (e.g. health vs. lives) are uploaded separately.
+//
+
 static void DamageInfobarTextureRect(int x, int y, int w, int h)
 {
-	int left	= x;
-	int top		= y;
-	int right	= x + w;
-	int bottom	= y + h;
+	if (w <= 0 || h <= 0)
+		return;
 
-	if (!gInfobarTextureIsDirty)
-	{
-		gInfobarTextureDirtyRect.left		= left;
-		gInfobarTextureDirtyRect.top		= top;
-		gInfobarTextureDirtyRect.right		= right;
-		gInfobarTextureDirtyRect.bottom		= bottom;
-	}
-	else
+	Rect r = { .top=y, .left=x, .bottom=y+h, .right=x+w };
+
+	while (1)
 	{
-#define MIN(a,b) ((a)<(b) ? (a) : (b))
-#define MAX(a,b) ((a)>(b) ? (a) : (b))
-		// Already dirty, expand existing dirty rect
-		gInfobarTextureDirtyRect.top    = MIN(gInfobarTextureDirtyRect.top,    top);
-		gInfobarTextureDirtyRect.left   = MIN(gInfobarTextureDirtyRect.left,   left);
-		gInfobarTextureDirtyRect.bottom = MAX(gInfobarTextureDirtyRect.bottom, bottom);
-		gInfobarTextureDirtyRect.right  = MAX(gInfobarTextureDirtyRect.right,  right);
-#undef MIN
-#undef MAX
-	}
+		int bestIndex = -1;
+		int bestWaste = INT_MAX;
+
+		for (int i = 0; i < gNumInfobarDamageRects; i++)
+		{
+			Rect u = RectUnion(&r, &gInfobarDamageRects[i]);
+			int waste = RectArea(&u) - RectArea(&r) - RectArea(&gInfobarDamageRects[i]);		// negative if they overlap
+			if (waste < bestWaste)
+			{
+				bestWaste = waste;
+				bestIndex = i;
+			}
+		}
+
+		// Merge with the closest existing rect if it's cheap enough, or if we're out of slots
+		if (bestIndex >= 0
+			&& (bestWaste <= INFOBAR_DAMAGE_MERGE_SLACK || gNumInfobarDamageRects == MAX_INFOBAR_DAMAGE_RECTS))
+		{
+			r = RectUnion(&r, &gInfobarDamageRects[bestIndex]);
+			gInfobarDamageRects[bestIndex] = gInfobarDamageRects[--gNumInfobarDamageRects];		// pop it, then retry merging the grown rect
+			continue;
+		}
 
-	gInfobarTextureIsDirty = true;
+		gInfobarDamageRects[gNumInfobarDamageRects++] = r;
+		break;
+	}
 }
 
 
 /********************** DRAW SPRITE ****************************/
 
+static void BlitMaskedRow(uint32_t* out, const uint32_t* in, const uint32_t* inMask, int width)
+{
+	int col = 0;
+
+#if INFOBAR_SSE2
+	for (; col + 4 <= width; col += 4)
+	{
+		__m128i dst		= _mm_loadu_si128((const __m128i*) (out + col));
+		__m128i src		= _mm_loadu_si128((const __m128i*) (in + col));
+		__m128i mask	= _mm_loadu_si128((const __m128i*) (inMask + col));
+		dst = _mm_or_si128(_mm_andnot_si128(mask, dst), src);
+		_mm_storeu_si128((__m128i*) (out + col), dst);
+	}
+#endif
+
+	for (; col < width; col++)
+	{
+		out[col] = (out[col] & ~inMask[col]) | in[col];
+	}
+}
+
 static void DrawSprite(int spriteNum, int x, int y)
 {
 	GAME_ASSERT(gInfobarArtLoaded);
@@ -587,15 +672,10 @@ static void DrawSprite(int spriteNum, int x, int y)
 
 	for (int row = 0; row < spriteHeight; row++)
 	{
-		for (int col = 0; col < spriteWidth; col++)
-		{
-			*out = (*out & ~*inMask) | *in;
-			out++;
-			in++;
-			inMask++;
-		}
-
-		out += INFOBAR_TEXTURE_WIDTH - spriteWidth;
+		BlitMaskedRow(out, in, inMask, spriteWidth);
+		out += INFOBAR_TEXTURE_WIDTH;
+		in += spriteWidth;
+		inMask += spriteWidth;
 	}
 
 	GAME_ASSERT(out <= gInfobarTexture + INFOBAR_TEXTURE_WIDTH * INFOBAR_TEXTURE_HEIGHT);
@@ -631,6 +711,14 @@ static void EraseSprite(int spriteNum, int x, int y)
 	GAME_ASSERT(out <= gInfobarTexture + (INFOBAR_TEXTURE_WIDTH * INFOBAR_TEXTURE_HEIGHT * 4));
 
 	DamageInfobarTextureRect(x, y, spriteWidth, spriteHeight);
+
+			/* IF WE ERASED PART OF THE NITRO GAUGE, IT MUST BE FULLY REDRAWN */
+
+	if (x < gNitroGaugeRect.right && x + spriteWidth > gNitroGaugeRect.left
+		&& y < gNitroGaugeRect.bottom && y + spriteHeight > gNitroGaugeRect.top)
+	{
+		gNitroGaugeDrawnSpan = -1;
+	}
 }
 
 
@@ -654,56 +742,62 @@ static int GetSpriteWidth(int spriteNum)
 
 static void DrawNitroGauge(int arcSpan)
 {
+	const uint32_t green	= UnpackU32BE(&(uint32_t){0x00bd29FF});		// original: 0x0000,0xBDEF,0x294A
+	const uint32_t margin	= UnpackU32BE(&(uint32_t){0xfff700FF});		// original: 0xffff,0xF7BD,0x0000
+	const uint32_t black	= UnpackU32BE(&(uint32_t){0x000000FF});
+
 	Boolean wantMargin = (arcSpan < 178) && (arcSpan > 2);
 
-	uint8_t* templateRow = gNitroGaugeData;
-	int nitroGaugeWidth = gNitroGaugeRect.right - gNitroGaugeRect.left;
-	int nitroGaugeHeight = gNitroGaugeRect.bottom - gNitroGaugeRect.top;
-	
-	uint32_t* outRow = GetInfobarTextureOffset(gNitroGaugeRect.left, gNitroGaugeRect.top);
+			/* ONLY REDRAW ARC POSITIONS WHOSE COLOR MAY HAVE CHANGED */
+			//
+			// A pixel's color only depends on whether its arc position is within the span,
+			// or within the 3-degree margin past the span. So only the positions between
+			// the old span and the new span (plus margin) need to be redrawn.
+			//
 
-	int* skipTable = gNitroGaugeAlphaSkips;
+	int lo = 0;
+	int hi = NITRO_GAUGE_LEVELS - 1;
 
-	for (int y = 0; y < nitroGaugeHeight; y++)
+	if (gNitroGaugeDrawnSpan >= 0)
 	{
-		int* skipData = &skipTable[y * gNitroGaugeMaxSkipsPerRow];
-		int x = 0;
-		while (x < nitroGaugeWidth)
-		{
-			uint8_t t = templateRow[x];
-			if (t == 0)
-			{
-				x += (*skipData++);
-				continue;
-			}
+		if (gNitroGaugeDrawnSpan == arcSpan)
+			return;
 
-			t--;	// move value from [1;181] to [0;180] (zero is reserved for mask)
-			
-			uint32_t fillColor = 0;
+		lo = arcSpan < gNitroGaugeDrawnSpan ? arcSpan : gNitroGaugeDrawnSpan;
+		hi = (arcSpan > gNitroGaugeDrawnSpan ? arcSpan : gNitroGaugeDrawnSpan) + 3;
+		if (lo < 0)
+			lo = 0;
+		if (hi > NITRO_GAUGE_LEVELS - 1)
+			hi = NITRO_GAUGE_LEVELS - 1;
+	}
 
-			if (t <= arcSpan)						// green (original: 0x0000,0xBDEF,0x294A)
-			{
-				fillColor = 0x00bd29FF;
-			}
-			else if (wantMargin && t <= arcSpan+3)	// margin line (original: 0xffff,0xF7BD,0x0000)
-			{
-				fillColor = 0xfff700FF;
-			}
-			else									// black
-			{
-				fillColor = 0x000000FF;
-			}
+	for (int t = lo; t <= hi; t++)
+	{
+		uint32_t fillColor;
+
+		if (t <= arcSpan)
+			fillColor = green;
+		else if (wantMargin && t <= arcSpan+3)
+			fillColor = margin;
+		else
+			fillColor = black;
 
-			outRow[x] = UnpackU32BE(&fillColor);
+		const int first = gNitroGaugeLevelStart[t];
+		const int last = gNitroGaugeLevelStart[t + 1];
 
-			x++;
+		if (first == last)
+			continue;
+
+		for (int i = first; i < last; i++)
+		{
+			gInfobarTexture[gNitroGaugePixels[i]] = fillColor;
 		}
 
-		templateRow += nitroGaugeWidth;
-		outRow += INFOBAR_TEXTURE_WIDTH;
+		const Rect* b = &gNitroGaugeLevelBounds[t];
+		DamageInfobarTextureRect(b->left, b->top, b->right - b->left, b->bottom - b->top);
 	}
 
-	DamageInfobarTextureRect(gNitroGaugeRect.left, gNitroGaugeRect.top, nitroGaugeWidth, nitroGaugeHeight);
+	gNitroGaugeDrawnSpan = arcSpan;
 }
 
 
@@ -1271,23 +1365,25 @@ void SubmitInfobarOverlay(void)
 		return;
 
 	// If the screen port has dirty pixels ("damaged"), update the texture
-	if (gInfobarTextureIsDirty)
+	for (int i = 0; i < gNumInfobarDamageRects; i++)
 	{
+		const Rect* r = &gInfobarDamageRects[i];
+
 		Render_UpdateTexture(
 				gInfobarTextureName,
-				gInfobarTextureDirtyRect.left,
-				gInfobarTextureDirtyRect.top,
-				gInfobarTextureDirtyRect.right - gInfobarTextureDirtyRect.left,
-				gInfobarTextureDirtyRect.bottom - gInfobarTextureDirtyRect.top,
+				r->left,
+				r->top,
+				r->right - r->left,
+				r->bottom - r->top,
 				GL_RGBA,
 				GL_UNSIGNED_BYTE,
-				GetInfobarTextureOffset(gInfobarTextureDirtyRect.left, gInfobarTextureDirtyRect.top),
+				GetInfobarTextureOffset(r->left, r->top),
 				INFOBAR_TEXTURE_WIDTH);
-
-		// Clear damage
-		gInfobarTextureIsDirty = false;
 	}
 
+	// Clear damage
+	gNumInfobarDamageRects = 0;
+
 	Render_SubmitMesh(gInfobarTopMesh, NULL, &kDefaultRenderMods_UI, &kQ3Point3D_Zero);
 
 	if (gGamePrefs.showBottomBar || gBossHealthWasUpdated)
@@ -191,6 +191,9 @@ static const TQ3Point2D po[4] =
 	gNewObjectDefinition.scale 		= 2.1;
 	gThrone = MakeNewDisplayGroupObject(&gNewObjectDefinition);
 
+	GAME_ASSERT_MESSAGE(gThrone->NumMeshes > WIN_THRONE_WATER_SUBMESH, "water mesh ID not found in win throne");
+	gThrone->MeshList[WIN_THRONE_WATER_SUBMESH]->texturingMode |= kQ3TexturingModeExt_UVTransformFlag;	// UVs scrolled in WaitAndDraw
+
 
 			/* PLAYER BUG */
 			
@@ -423,6 +426,10 @@ static const TQ3Point2D po[4] =
 	gNewObjectDefinition.scale 		= 2.1;
 	gThrone = MakeNewDisplayGroupObject(&gNewObjectDefinition);
 
+	GAME_ASSERT_MESSAGE(gThrone->NumMeshes > LOSE_THRONE_LAVA_SUBMESH, "lava mesh ID not found in lose throne");
+	gThrone->MeshList[LOSE_THRONE_LAVA_SUBMESH]->texturingMode |= kQ3TexturingModeExt_UVTransformFlag;	// UVs scrolled in WaitAndDraw
+	gThrone->MeshList[LOSE_THRONE_LAVA_SUBMESH]->hasVertexNormals = false;  // make it pop - don't shade lava
+
 
 			/* KING ON THRONE */
 			
@@ -542,18 +549,10 @@ float	fps;
 			return(true);		
 		
 		if (fire)
-		{
  			UpdateLoseFire();
 
- 			GAME_ASSERT_MESSAGE(gThrone->NumMeshes > LOSE_THRONE_LAVA_SUBMESH, "lava mesh ID not found in lose throne");
-			QD3D_ScrollUVs(gThrone->MeshList[LOSE_THRONE_LAVA_SUBMESH], fps*.1f, -fps*.05f);
-			gThrone->MeshList[LOSE_THRONE_LAVA_SUBMESH]->hasVertexNormals = false;  // make it pop - don't shade lava
-		}
-		else
-		{
-			GAME_ASSERT_MESSAGE(gThrone->NumMeshes > WIN_THRONE_WATER_SUBMESH, "water mesh ID not found in win throne");
-			QD3D_ScrollUVs(gThrone->MeshList[WIN_THRONE_WATER_SUBMESH], fps*.1f, -fps*.05f);
-		}
+		gThrone->RenderModifiers.uvOffset.u += fps*.1f;
+		gThrone->RenderModifiers.uvOffset.v -= fps*.05f;
 		
 	}while(duration > 0.0f);
 
@@ -195,6 +195,8 @@ void UpdateSkinnedGeometry(ObjNode *theNode)
 	if (theNode->CType == INVALID_NODE_FLAG)
 		return;
 
+	PROFILE_BEGIN(Skinning);
+
 	GAME_ASSERT(theNode->Skeleton);
 
 	const SkeletonDefType* skeletonDef = theNode->Skeleton->skeletonDefinition;
@@ -219,6 +221,9 @@ void UpdateSkinnedGeometry(ObjNode *theNode)
 	{
 		theNode->MeshList[i]->bBox = gBBox;				// apply to local copy of trimesh
 	}
+
+	PROFILE_COUNT(SkinnedMeshes, theNode->NumMeshes);
+	PROFILE_END(Skinning);
 }
 
 
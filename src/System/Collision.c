@@ -287,6 +287,9 @@ short		numSolidHits, numPasses = 0;
 Boolean		hitImpenetrable = false;
 short		oldNumCollisions;
 
+	PROFILE_BEGIN(Collision);
+	PROFILE_COUNT(CollisionQueries, 1);
+
 	gNumCollisions = oldNumCollisions = 0;
 	gTotalSides = 0;
 
@@ -308,7 +311,10 @@ again:
 			/* GET BASE BOX INFO */
 			
 	if (theNode->NumCollisionBoxes == 0)					// it's gotta have a collision box
+	{
+		PROFILE_END(Collision);
 		return(0);
+	}
 	boxList = theNode->CollisionBoxes;
 
 
@@ -472,6 +478,7 @@ again:
 		}
 	}
 
+	PROFILE_END(Collision);
 	return(totalSides);
 }
 
@@ -721,31 +728,29 @@ short DoSimplePointCollision(TQ3Point3D *thePoint, u_long cType)
 ObjNode	*thisNode;
 short	targetNumBoxes,target;
 CollisionBoxType *targetBoxList;
+ObjNode * const	*candidates;
+int				numCandidates;
 
 	gNumCollisions = 0;
 
-	thisNode = gFirstNodePtr;									// start on 1st node
+	candidates = SpatialIndex_QueryBox(thePoint->x, thePoint->x, thePoint->z, thePoint->z, cType, &numCandidates);
 
-	do
+	for (int i = 0; i < numCandidates; i++)				// candidates are in object list order
 	{
-		if (!(thisNode->CType & cType))							// see if we want to check this Type
-			goto next;
-
-		if (thisNode->Slot >= SLOT_OF_DUMB)						// see if reach end of usable list
-			break;
+		thisNode = candidates[i];
 
 		if (thisNode->StatusBits & STATUS_BIT_NOCOLLISION)	// don't collide against these
-			goto next;
+			continue;
 		
 		if (!thisNode->CBits)									// see if this obj doesn't need collisioning
-			goto next;
+			continue;
 
 	
 				/* GET BOX INFO FOR THIS NODE */
 					
 		targetNumBoxes = thisNode->NumCollisionBoxes;			// if target has no boxes, then skip
 		if (targetNumBoxes == 0)
-			goto next;
+			continue;
 		targetBoxList = thisNode->CollisionBoxes;
 	
 	
@@ -782,10 +787,7 @@ CollisionBoxType *targetBoxList;
 			gCollisionList[gNumCollisions].objectPtr = thisNode;
 			gNumCollisions++;	
 		}
-		
-next:	
-		thisNode = thisNode->NextNode;							// next target node
-	}while(thisNode != nil);
+	}
 
 	return(gNumCollisions);
 }
@@ -802,31 +804,29 @@ short DoSimpleBoxCollision(float top, float bottom, float left, float right,
 ObjNode			*thisNode;
 short			targetNumBoxes,target;
 CollisionBoxType *targetBoxList;
+ObjNode * const	*candidates;
+int				numCandidates;
 
 	gNumCollisions = 0;
 
-	thisNode = gFirstNodePtr;									// start on 1st node
+	candidates = SpatialIndex_QueryBox(left, right, back, front, cType, &numCandidates);
 
-	do
+	for (int i = 0; i < numCandidates; i++)				// candidates are in object list order
 	{
-		if (!(thisNode->CType & cType))							// see if we want to check this Type
-			goto next;
-
-		if (thisNode->Slot >= SLOT_OF_DUMB)						// see if reach end of usable list
-			break;
+		thisNode = candidates[i];
 
 		if (thisNode->StatusBits & STATUS_BIT_NOCOLLISION)	// don't collide against these
-			goto next;
+			continue;
 		
 		if (!thisNode->CBits)									// see if this obj doesn't need collisioning
-			goto next;
+			continue;
 
 	
 				/* GET BOX INFO FOR THIS NODE */
 					
 		targetNumBoxes = thisNode->NumCollisionBoxes;			// if target has no boxes, then skip
 		if (targetNumBoxes == 0)
-			goto next;
+			continue;
 		targetBoxList = thisNode->CollisionBoxes;
 	
 	
@@ -863,10 +863,7 @@ CollisionBoxType *targetBoxList;
 			gCollisionList[gNumCollisions].objectPtr = thisNode;
 			gNumCollisions++;	
 		}
-		
-next:	
-		thisNode = thisNode->NextNode;							// next target node
-	}while(thisNode != nil);
+	}
 
 	return(gNumCollisions);
 }
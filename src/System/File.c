@@ -789,6 +789,45 @@ short	fRefNum;
 }
 
 
+/********************** TRANSLATE MAP LAYER ************************/
+//
+// Copies a 'Layr' resource into a 2D map, replacing each tile # with its image #
+// from the 'Xlat' table. Bands of rows are translated in parallel.
+//
+
+typedef struct
+{
+	const u_short*	src;
+	u_short**		map;
+	const short*	xlateTbl;
+}MapLayerJob;
+
+static void TranslateMapLayerRows(void* userData, int firstRow, int endRow)
+{
+const MapLayerJob* job = (const MapLayerJob*) userData;
+
+	for (int row = firstRow; row < endRow; row++)
+	{
+		const u_short* src = job->src + row * gTerrainTileWidth;
+
+		for (int col = 0; col < gTerrainTileWidth; col++)
+		{
+			u_short	tile, imageNum;
+			
+			tile = *src++;														// get original tile with all bits
+			imageNum = job->xlateTbl[tile & TILENUM_MASK];						// get image # from xlate table
+			job->map[row][col] = (tile&(~TILENUM_MASK)) | imageNum;			// insert image # into bitfield
+		}
+	}
+}
+
+static void TranslateMapLayer(const u_short* src, u_short** map, const short* xlateTbl)
+{
+	MapLayerJob job = { .src = src, .map = map, .xlateTbl = xlateTbl };
+	Parallel_ForBands(gTerrainTileDepth, TranslateMapLayerRows, &job);
+}
+
+
 /********************** READ DATA FROM PLAYFIELD FILE ************************/
 
 static void ReadDataFromPlayfieldFile(void)
@@ -869,16 +908,7 @@ short					**xlateTableHand,*xlateTbl;
 																					// copy rez into 2D array
 	{
 		UNPACK_BE_SCALARS_HANDLE(u_short, gTerrainTileDepth * gTerrainTileWidth, hand);
-		u_short	*src = (u_short*) *hand;
-		for (row = 0; row < gTerrainTileDepth; row++)
-			for (col = 0; col < gTerrainTileWidth; col++)
-			{
-				u_short	tile, imageNum;
-				
-				tile = *src++;														// get original tile with all bits
-				imageNum = xlateTbl[tile & TILENUM_MASK];							// get image # from xlate table
-				gFloorMap[row][col] = (tile&(~TILENUM_MASK)) | imageNum;			// insert image # into bitfield
-			}
+		TranslateMapLayer((const u_short*) *hand, gFloorMap, xlateTbl);
 		ReleaseResource(hand);
 	}		
 
@@ -894,16 +924,7 @@ short					**xlateTableHand,*xlateTbl;
 																						// copy rez into 2D array
 		{
 			UNPACK_BE_SCALARS_HANDLE(u_short, gTerrainTileDepth * gTerrainTileWidth, hand);
-			u_short	*src = (u_short*) *hand;
-			for (row = 0; row < gTerrainTileDepth; row++)
-				for (col = 0; col < gTerrainTileWidth; col++)
-				{
-					u_short	tile, imageNum;
-
-					tile = *src++;														// get original tile with all bits
-					imageNum = xlateTbl[tile & TILENUM_MASK];							// get image # from xlate table
-					gCeilingMap[row][col] = (tile&(~TILENUM_MASK)) | imageNum;			// insert image # into bitfield
-				}
+			TranslateMapLayer((const u_short*) *hand, gCeilingMap, xlateTbl);
 			ReleaseResource(hand);
 		}
 	}
@@ -1280,6 +1301,7 @@ FSSpec	spec;
 						
 				FSMakeFSSpec(gDataSpec.vRefNum, gDataSpec.parID, ":models:BeeHive_Models.3dmf", &spec);
 				LoadGrouped3DMF(&spec,MODEL_GROUP_LEVELSPECIFIC);	
+				InitHoneyTubeTextureAnimation();
 				
 				
 				/* LOAD SKELETON FILES */
@@ -0,0 +1,205 @@
+// FRAME PACING.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+
+#include "game.h"
+#include <SDL_opengl.h>
+#include <stdio.h>
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define PACING_HISTORY			128				// frames kept for variance stats (power of 2)
+#define SLEEP_SLICE_MS			1
+#define JITTER_DECAY_SHIFT		4				// sleep jitter estimate decays by 1/16 per frame
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+static uint64_t		gPerfFrequency = 0;
+static uint64_t		gTargetFrameTicks = 0;
+static uint64_t		gSleepSliceTicks = 0;
+static uint64_t		gSleepJitterTicks = 0;			// decaying peak of how late SDL_Delay wakes us up
+
+static float		gFrameHistoryMS[PACING_HISTORY];
+static uint32_t		gFrameHistoryCount = 0;
+
+	/* GPU FENCES (--gpu-fence) */
+
+static bool						gFencesInitialized = false;
+static PFNGLFENCESYNCPROC		gglFenceSync = NULL;
+static PFNGLCLIENTWAITSYNCPROC	gglClientWaitSync = NULL;
+static PFNGLDELETESYNCPROC		gglDeleteSync = NULL;
+static GLsync					gPrevFrameFence = NULL;
+static float					gGPUWaitMS = 0;
+
+/****************************/
+/*    INIT                  */
+/****************************/
+
+static void LazyInit(void)
+{
+	if (gPerfFrequency != 0)
+		return;
+
+	gPerfFrequency		= SDL_GetPerformanceFrequency();
+	gSleepSliceTicks	= gPerfFrequency * SLEEP_SLICE_MS / 1000;
+
+	int targetFPS = gCommandLine.maxFPS > 0 ? gCommandLine.maxFPS : MAX_FPS;
+	gTargetFrameTicks	= gPerfFrequency / targetFPS;
+
+	gSleepJitterTicks	= gSleepSliceTicks;				// be pessimistic until we've measured it
+}
+
+static void InitFences(void)
+{
+	gFencesInitialized = true;
+
+	if (!gCommandLine.gpuFence)
+		return;
+
+	if (!SDL_GL_ExtensionSupported("GL_ARB_sync"))
+	{
+		printf("GL_ARB_sync not supported; ignoring --gpu-fence\n");
+		return;
+	}
+
+	gglFenceSync		= (PFNGLFENCESYNCPROC) SDL_GL_GetProcAddress("glFenceSync");
+	gglClientWaitSync	= (PFNGLCLIENTWAITSYNCPROC) SDL_GL_GetProcAddress("glClientWaitSync");
+	gglDeleteSync		= (PFNGLDELETESYNCPROC) SDL_GL_GetProcAddress("glDeleteSync");
+
+	if (!gglFenceSync || !gglClientWaitSync || !gglDeleteSync)
+	{
+		gglFenceSync = NULL;
+		printf("Couldn't load GL_ARB_sync functions; ignoring --gpu-fence\n");
+	}
+}
+
+/****************************/
+/*    WAIT                  */
+/****************************/
+
+//
+// Hybrid sleep-then-spin until the target frame duration has elapsed since prevFrameTime.
+//
+// SDL_Delay(1) commonly oversleeps by up to a few ms depending on the OS timer resolution.
+// We keep track of the worst recent overshoot and only sleep while we have at least that
+// much headroom left; the remainder is spent spinning on the performance counter.
+// The estimate decays every frame (even frames where we don't get to sleep), so a single
+// outlier can't turn sleeping off for good.
+//
+
+void FramePacing_WaitForNextFrame(uint64_t prevFrameTime)
+{
+	LazyInit();
+
+	uint64_t deadline = prevFrameTime + gTargetFrameTicks;
+
+	gSleepJitterTicks -= gSleepJitterTicks >> JITTER_DECAY_SHIFT;
+
+	while (1)
+	{
+		uint64_t now = SDL_GetPerformanceCounter();
+		if (now >= deadline)
+			return;
+
+		uint64_t remaining = deadline - now;
+
+		if (remaining > gSleepSliceTicks + gSleepJitterTicks)
+		{
+			SDL_Delay(SLEEP_SLICE_MS);
+
+			uint64_t slept = SDL_GetPerformanceCounter() - now;
+			uint64_t overshoot = slept > gSleepSliceTicks ? slept - gSleepSliceTicks : 0;
+
+			if (overshoot > gSleepJitterTicks)
+				gSleepJitterTicks = overshoot;
+		}
+	}
+}
+
+/****************************/
+/*    GPU FENCE             */
+/****************************/
+
+//
+// Call right after swapping buffers.
+// With --gpu-fence, waits for the GPU to finish the *previous* frame before letting the
+// CPU race ahead, so that the CPU is never more than 1 frame ahead of the GPU.
+// The time spent waiting tells us how far the GPU lags behind the CPU.
+//
+
+void FramePacing_OnSwap(void)
+{
+	if (!gFencesInitialized)
+		InitFences();
+
+	if (!gglFenceSync)
+		return;
+
+	if (gPrevFrameFence)
+	{
+		uint64_t t0 = SDL_GetPerformanceCounter();
+		gglClientWaitSync(gPrevFrameFence, GL_SYNC_FLUSH_COMMANDS_BIT, 100 * 1000000ull);	// 100 ms timeout
+		uint64_t t1 = SDL_GetPerformanceCounter();
+		gglDeleteSync(gPrevFrameFence);
+
+		float waitMS = 1000.0f * (float)(t1 - t0) / (float)gPerfFrequency;
+		gGPUWaitMS += (waitMS - gGPUWaitMS) * 0.1f;
+	}
+
+	gPrevFrameFence = gglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FramePacing_Shutdown(void)
+{
+	if (gPrevFrameFence)
+	{
+		gglDeleteSync(gPrevFrameFence);
+		gPrevFrameFence = NULL;
+	}
+
+	gFencesInitialized = false;
+	gglFenceSync = NULL;
+}
+
+/****************************/
+/*    STATS                 */
+/****************************/
+
+void FramePacing_RecordFrame(uint64_t frameTicks)
+{
+	LazyInit();
+	gFrameHistoryMS[gFrameHistoryCount & (PACING_HISTORY-1)] = 1000.0f * (float)frameTicks / (float)gPerfFrequency;
+	gFrameHistoryCount++;
+}
+
+int FramePacing_FormatStats(char* buf, int bufSize)
+{
+	int n = gFrameHistoryCount < PACING_HISTORY ? (int) gFrameHistoryCount : PACING_HISTORY;
+	if (n == 0 || gPerfFrequency == 0)
+		return 0;
+
+	float mean = 0;
+	for (int i = 0; i < n; i++)
+		mean += gFrameHistoryMS[i];
+	mean /= n;
+
+	float variance = 0;
+	for (int i = 0; i < n; i++)
+		variance += (gFrameHistoryMS[i] - mean) * (gFrameHistoryMS[i] - mean);
+	variance /= n;
+
+	float jitterMS = 1000.0f * (float)gSleepJitterTicks / (float)gPerfFrequency;
+
+	int len = snprintf(buf, bufSize, "pacing: %.2f+-%.2fms, oversleep %.2fms",
+			mean, sqrtf(variance), jitterMS);
+
+	if (gglFenceSync && len >= 0 && len < bufSize)
+		len += snprintf(buf + len, bufSize - len, ", gpu %.2fms", gGPUWaitMS);
+
+	if (len < 0)
+		return 0;
+	return len < bufSize ? len : bufSize - 1;
+}
@@ -20,6 +20,8 @@
 static void InitArea(void);
 static void CleanupLevel(void);
 static void PlayArea(void);
+static void UpdateAreaSimulation(void);
+static void RunFixedSimulationTicks(void);
 static void DoDeathReset(void);
 static void PlayGame(void);
 static void CheckForCheats(void);
@@ -31,6 +33,8 @@ static void CheckForCheats(void);
 
 #define	KILL_DELAY	4
 
+#define	MAX_TICKS_PER_FRAME	5				// fixed tick: cap catch-up after a hitch so we don't spiral
+
 typedef struct
 {
 	Byte	levelType;
@@ -60,6 +64,9 @@ static LevelType	gLevelTable[NUM_LEVELS] =
 Boolean		gIsInGame = false;
 Boolean		gIsGamePaused = false;
 
+static float	gTickAccumulator = 0;				// fixed tick: simulation time owed to the renderer
+static float	gTickAlpha = 1;						// fixed tick: fraction of a tick elapsed since the latest tick
+
 u_short		gRealLevel = 0;
 u_short		gLevelType = 0;
 u_short		gAreaNum = 0;
@@ -360,33 +367,41 @@ float fps;
 		/* MAIN GAME LOOP */
 		/******************/
 
+	gTickAccumulator = 0;
+	gTickAlpha = 1;
+	SnapshotObjectTransforms();
+	SnapshotCameraTransform();
+
 	while(true)
 	{
 		fps = gFramesPerSecondFrac;
 		UpdateInput();
 
-				/* SPECIFIC MAINTENANCE */
+				/* SIMULATE */
 
-		CheckPlayerMorph();				
-		UpdateLiquidAnimation();
-		UpdateHoneyTubeTextureAnimation();
-		UpdateRootSwings();
-		
-	
-				/* MOVE OBJECTS */
-				
-		MoveObjects();
-		MoveSplineObjects();
-		QD3D_MoveShards();
-		MoveParticleGroups();
-		UpdateCamera();
+		if (gCommandLine.fixedTickRate > 0)
+			RunFixedSimulationTicks();
+		else
+			UpdateAreaSimulation();
 	
 			/* DRAW OBJECTS & TERRAIN */
 					
 		UpdateInfobar();
 
 		DoMyTerrainUpdate();
-		QD3D_DrawScene(gGameViewInfoPtr,DrawTerrain);
+
+		if (gCommandLine.fixedTickRate > 0)
+		{
+			ApplyObjectInterpolation(gTickAlpha);
+			ApplyCameraInterpolation(gTickAlpha);
+			QD3D_DrawScene(gGameViewInfoPtr,DrawTerrain);
+			RestoreCameraInterpolation();
+			RestoreObjectInterpolation();
+		}
+		else
+		{
+			QD3D_DrawScene(gGameViewInfoPtr,DrawTerrain);
+		}
 
 		QD3D_CalcFramesPerSecond();
 		DoSDLMaintenance();
@@ -438,6 +453,76 @@ float fps;
 }
 
 
+/**************** UPDATE AREA SIMULATION ************************/
+//
+// Advances the gameplay by gFramesPerSecondFrac seconds.
+//
+
+static void UpdateAreaSimulation(void)
+{
+			/* SPECIFIC MAINTENANCE */
+
+	CheckPlayerMorph();
+	UpdateLiquidAnimation();
+	UpdateHoneyTubeTextureAnimation();
+	UpdateRootSwings();
+
+
+			/* MOVE OBJECTS */
+
+	MoveObjects();
+	MoveSplineObjects();
+	QD3D_MoveShards();
+	MoveParticleGroups();
+	UpdateCamera();
+}
+
+
+/**************** RUN FIXED SIMULATION TICKS ************************/
+//
+// Fixed-tick mode (--fixed-tick): steps the simulation as many times as needed
+// to catch up with real time, at a constant gFramesPerSecondFrac.
+// Frames that are rendered faster than the tick rate may not simulate at all;
+// the renderer interpolates between the last two ticks instead.
+//
+
+static void RunFixedSimulationTicks(void)
+{
+	const float frameFPS		= gFramesPerSecond;
+	const float frameFrac		= gFramesPerSecondFrac;
+	const float tickDuration	= 1.0f / gCommandLine.fixedTickRate;
+
+	gTickAccumulator += frameFrac;
+	if (gTickAccumulator > MAX_TICKS_PER_FRAME * tickDuration)
+		gTickAccumulator = MAX_TICKS_PER_FRAME * tickDuration;
+
+	gFramesPerSecond		= gCommandLine.fixedTickRate;		// all movement code scales by these
+	gFramesPerSecondFrac	= tickDuration;
+
+	while (gTickAccumulator >= tickDuration)
+	{
+		SnapshotObjectTransforms();
+		SnapshotCameraTransform();
+
+		BeginInputTick();
+		UpdateAreaSimulation();
+		EndInputTick();
+
+		gTickAccumulator -= tickDuration;
+
+		if (gGameOverFlag || gAreaCompleted)
+			break;
+	}
+
+	gFramesPerSecond		= frameFPS;
+	gFramesPerSecondFrac	= frameFrac;
+
+	gTickAlpha = gTickAccumulator / tickDuration;
+	if (gTickAlpha > 1.0f)
+		gTickAlpha = 1.0f;
+}
+
+
 /***************** INIT AREA ************************/
 
 static void InitArea(void)
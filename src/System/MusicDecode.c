@@ -0,0 +1,325 @@
+// MUSIC DECODE.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+//
+// The songs ship as AIFF-C files with Apple IMA4 compression (4:1 vs. 16-bit PCM).
+// Rather than have the game thread decode a whole song in PlaySong, we read the
+// compressed bytes and hand them to a worker thread that decodes them into a PCM
+// buffer behind an extended sound header. The game thread polls for completion in
+// DoSoundMaintenance and starts playback from there.
+//
+
+#include "game.h"
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define	IMA4_PACKET_SIZE			34				// 2-byte header + 32 bytes of nibbles, per channel
+#define	IMA4_FRAMES_PER_PACKET		64
+#define	MAX_SONG_CHANNELS			2
+
+#define	EXT_SOUND_HEADER_SIZE		64				// size of ExtSoundHeader before sampleArea
+#define	EXT_SOUND_HEADER_ENCODE		0xFF			// extSH
+
+/****************************/
+/*    TYPES                 */
+/****************************/
+
+struct MusicDecodeJob
+{
+	Ptr				fileData;						// compressed AIFF-C file
+	const uint8_t*	packets;						// start of SSND sample data in fileData
+	int				numChannels;
+	int				numPackets;						// per channel
+
+	Ptr				soundHeader;					// ExtSoundHeader + 16-bit big-endian PCM
+
+	SDL_Thread*		thread;
+	SDL_atomic_t	done;
+	SDL_atomic_t	cancel;
+};
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+static const int16_t kIMAStepTable[89] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t kIMAIndexTable[16] =
+{
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/****************************/
+/*    BIG-ENDIAN HELPERS    */
+/****************************/
+
+static inline uint16_t ReadBE16(const uint8_t* p)
+{
+	return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ReadBE32(const uint8_t* p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline void WriteBE16(uint8_t* p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void WriteBE32(uint8_t* p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+/****************************/
+/*    IMA4 DECODING         */
+/****************************/
+
+//
+// Decodes one 34-byte Apple IMA4 packet into 64 big-endian 16-bit samples,
+// written every 'stride' bytes (so channels come out interleaved).
+//
+
+static void DecodeIMA4Packet(const uint8_t* packet, uint8_t* out, int stride)
+{
+	uint16_t	header		= ReadBE16(packet);
+	int			predictor	= (int16_t) (header & 0xFF80);
+	int			stepIndex	= header & 0x7F;
+
+	if (stepIndex > 88)
+		stepIndex = 88;
+
+	for (int i = 0; i < IMA4_FRAMES_PER_PACKET; i++)
+	{
+		uint8_t	byte	= packet[2 + i/2];
+		int		nibble	= (i & 1) ? (byte >> 4) : (byte & 0x0F);		// low nibble first
+		int		step	= kIMAStepTable[stepIndex];
+
+		int diff = step >> 3;
+		if (nibble & 1) diff += step >> 2;
+		if (nibble & 2) diff += step >> 1;
+		if (nibble & 4) diff += step;
+		if (nibble & 8) diff = -diff;
+
+		predictor += diff;
+		if (predictor > 32767) predictor = 32767;
+		if (predictor < -32768) predictor = -32768;
+
+		stepIndex += kIMAIndexTable[nibble];
+		if (stepIndex < 0) stepIndex = 0;
+		if (stepIndex > 88) stepIndex = 88;
+
+		WriteBE16(out, (uint16_t) predictor);
+		out += stride;
+	}
+}
+
+static int DecodeThread(void* data)
+{
+	MusicDecodeJob* job = (MusicDecodeJob*) data;
+
+	const uint8_t*	in		= job->packets;
+	uint8_t*		pcm		= (uint8_t*) job->soundHeader + EXT_SOUND_HEADER_SIZE;
+	int				nChans	= job->numChannels;
+	int				stride	= 2 * nChans;
+
+	for (int p = 0; p < job->numPackets; p++)
+	{
+		if ((p & 255) == 0 && SDL_AtomicGet(&job->cancel))
+			break;
+
+		for (int c = 0; c < nChans; c++)							// packets are interleaved by channel
+		{
+			DecodeIMA4Packet(in, pcm + 2*c, stride);
+			in += IMA4_PACKET_SIZE;
+		}
+
+		pcm += IMA4_FRAMES_PER_PACKET * stride;
+	}
+
+	SDL_AtomicSet(&job->done, 1);
+	return 0;
+}
+
+/****************************/
+/*    SOUND HEADER          */
+/****************************/
+
+static void WriteExtSoundHeader(uint8_t* h, int numChannels, int numFrames, const uint8_t* aiffSampleRate)
+{
+	uint32_t rate = 0;												// decode 80-bit extended to 16.16 fixed
+	int exponent = (ReadBE16(aiffSampleRate) & 0x7FFF) - 16383;
+	if (exponent >= 0 && exponent < 32)
+		rate = (uint32_t) ((((uint64_t) ReadBE32(aiffSampleRate + 2) << 16) >> (31 - exponent)));
+
+	memset(h, 0, EXT_SOUND_HEADER_SIZE);
+	WriteBE32(h + 0,	0);											// samplePtr: samples follow header
+	WriteBE32(h + 4,	numChannels);
+	WriteBE32(h + 8,	rate);										// sampleRate (Fixed)
+	WriteBE32(h + 12,	0);											// loopStart
+	WriteBE32(h + 16,	0);											// loopEnd
+	h[20] = EXT_SOUND_HEADER_ENCODE;
+	h[21] = kMiddleC;												// baseFrequency
+	WriteBE32(h + 22,	numFrames);
+	memcpy(h + 26, aiffSampleRate, 10);								// AIFFSampleRate
+	WriteBE16(h + 48,	16);										// sampleSize
+}
+
+/****************************/
+/*    JOB                   */
+/****************************/
+
+//
+// Reads the whole file and starts decoding it in the background.
+//
+// OUTPUT:	nil if the file isn't an IMA4 AIFF-C; the caller should play it some other way.
+//			Either way, the file has been read to the end.
+//
+
+MusicDecodeJob* MusicDecode_Start(short refNum)
+{
+long	eof = 0;
+OSErr	err;
+
+	GetEOF(refNum, &eof);
+	if (eof < 12)
+		return nil;
+
+	Ptr fileData = NewPtr(eof);
+	GAME_ASSERT(fileData);
+
+	err = FSRead(refNum, &eof, fileData);
+	if (err != noErr)
+		goto fail;
+
+			/* FIND COMM & SSND CHUNKS */
+
+	const uint8_t*	bytes	= (const uint8_t*) fileData;
+	const uint8_t*	comm	= nil;
+	const uint8_t*	ssnd	= nil;
+	uint32_t		ssndSize = 0;
+
+	if (memcmp(bytes, "FORM", 4) != 0 || memcmp(bytes + 8, "AIFC", 4) != 0)
+		goto fail;
+
+	for (long pos = 12; pos + 8 <= eof; )
+	{
+		uint32_t chunkSize = ReadBE32(bytes + pos + 4);
+		if (chunkSize > (uint32_t) (eof - pos - 8))
+			break;
+
+		if (memcmp(bytes + pos, "COMM", 4) == 0 && chunkSize >= 22)
+			comm = bytes + pos + 8;
+		else if (memcmp(bytes + pos, "SSND", 4) == 0 && chunkSize >= 8)
+		{
+			ssnd = bytes + pos + 8;
+			ssndSize = chunkSize;
+		}
+
+		pos += 8 + ((chunkSize + 1) & ~1u);							// chunks are padded to even sizes
+	}
+
+	if (!comm || !ssnd || memcmp(comm + 18, "ima4", 4) != 0)
+		goto fail;
+
+	int			numChannels	= ReadBE16(comm);
+	int			numPackets	= (int) ReadBE32(comm + 2);				// for ima4, "sample frames" counts packets
+	uint32_t	dataOffset	= 8 + ReadBE32(ssnd);
+
+	if (numChannels < 1 || numChannels > MAX_SONG_CHANNELS ||
+		dataOffset + (uint64_t) numPackets * numChannels * IMA4_PACKET_SIZE > ssndSize)
+	{
+		goto fail;
+	}
+
+			/* SET UP JOB */
+
+	int numFrames = numPackets * IMA4_FRAMES_PER_PACKET;
+
+	MusicDecodeJob* job = (MusicDecodeJob*) AllocPtr(sizeof(MusicDecodeJob));
+	GAME_ASSERT(job);
+	job->fileData		= fileData;
+	job->packets		= ssnd + dataOffset;
+	job->numChannels	= numChannels;
+	job->numPackets		= numPackets;
+	job->soundHeader	= NewPtr(EXT_SOUND_HEADER_SIZE + (long) numFrames * numChannels * 2);
+	GAME_ASSERT(job->soundHeader);
+
+	WriteExtSoundHeader((uint8_t*) job->soundHeader, numChannels, numFrames, comm + 8);
+
+	SDL_AtomicSet(&job->done, 0);
+	SDL_AtomicSet(&job->cancel, 0);
+
+	job->thread = SDL_CreateThread(DecodeThread, "MusicDecode", job);
+	if (!job->thread)												// no thread, decode here
+		DecodeThread(job);
+
+	return job;
+
+fail:
+	DisposePtr(fileData);
+	return nil;
+}
+
+Boolean MusicDecode_IsDone(MusicDecodeJob* job)
+{
+	if (SDL_AtomicGet(&job->done) == 0)
+		return false;
+
+	if (job->fileData)												// the compressed file isn't needed anymore
+	{
+		if (job->thread)
+		{
+			SDL_WaitThread(job->thread, NULL);						// already returned; just reap it
+			job->thread = NULL;
+		}
+
+		DisposePtr(job->fileData);
+		job->fileData = nil;
+		job->packets = nil;
+	}
+
+	return true;
+}
+
+Ptr MusicDecode_GetSoundHeader(MusicDecodeJob* job)
+{
+	GAME_ASSERT(MusicDecode_IsDone(job));
+	return job->soundHeader;
+}
+
+//
+// Stops the worker if it's still running and frees everything.
+// The channel playing the sound header must have been stopped first.
+//
+
+void MusicDecode_Dispose(MusicDecodeJob* job)
+{
+	if (!job)
+		return;
+
+	SDL_AtomicSet(&job->cancel, 1);
+	if (job->thread)
+		SDL_WaitThread(job->thread, NULL);
+
+	if (job->fileData)
+		DisposePtr(job->fileData);
+	DisposePtr(job->soundHeader);
+	DisposePtr((Ptr) job);
+}
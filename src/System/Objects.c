@@ -18,6 +18,7 @@
 
 static void FlushObjectDeleteQueue(int queueID);
 static void DisposeObjNodeMemory(ObjNode* node);
+static void RebuildCTypeRegistries(void);
 
 
 /****************************/
@@ -27,6 +28,8 @@ static void DisposeObjNodeMemory(ObjNode* node);
 #define	OBJ_DEL_Q_SIZE	100
 #define	OBJ_BUDGET		500
 
+#define	INTERP_MAX_TICK_DIST	400.0f		// objects that moved farther than this in 1 tick were teleported; don't interpolate them
+
 
 /**********************/
 /*     VARIABLES      */
@@ -54,6 +57,21 @@ static int			gNumObjsInDeleteQueue[2];
 static ObjNode*		gObjectDeleteQueue[2][OBJ_DEL_Q_SIZE];
 static int			gObjectDeleteQueueFlipFlop = 0;
 
+static uint32_t		gInterpolationTick = 0;
+
+// Per-CType membership lists, in object list order.
+// Rebuilt lazily by the first query after the object list changed (or after a new
+// frame started, which picks up CType bits that objects flipped on themselves).
+static const uint32_t	kRegisteredCTypes[NUM_CTYPE_REGISTRIES] =
+{
+	CTYPE_BLOCKSHADOW,
+};
+
+static ObjNode**	gCTypeRegistry[NUM_CTYPE_REGISTRIES];
+static int			gCTypeRegistryCount[NUM_CTYPE_REGISTRIES];
+static int			gCTypeRegistryCapacity = 0;
+static Boolean		gCTypeRegistryDirty = true;
+
 Boolean		gDoAutoFade;
 float		gAutoFadeStartDist;
 
@@ -73,6 +91,8 @@ void InitObjectManager(void)
 	gCurrentNode = nil;
 	gFirstNodePtr = nil;									// no node yet
 	gNumObjNodes = 0;
+	gCTypeRegistryDirty = true;
+	SpatialIndex_Reset();
 
 		/* INIT OBJECT POOL */
 
@@ -94,6 +114,8 @@ void InitObjectManager(void)
 		.ParticleGroup			= -1,						// no particle group
 		.SplineObjectIndex		= -1,						// no index yet
 		.StatusBits				= STATUS_BIT_DETACHED,		// not attached to linked list yet
+		.SpatialCell			= SPATIAL_CELL_NONE,		// not in spatial index yet
+		.OcclusionSlot			= -1,						// no occlusion query slot yet
 	};
 
 	Render_SetDefaultModifiers(&gObjNodeTemplate.RenderModifiers);
@@ -338,6 +360,8 @@ ObjNode		*thisNodePtr;
 	if (gFirstNodePtr == nil)								// see if there are any objects
 		return;
 
+	gCTypeRegistryDirty = true;								// catch CType bits changed in place last frame
+
 	thisNodePtr = gFirstNodePtr;
 	
 	do
@@ -361,6 +385,9 @@ ObjNode		*thisNodePtr;
 		{
 			thisNodePtr->MoveCall(thisNodePtr);				// call object's move routine
 		}
+
+		SpatialIndex_Update(thisNodePtr);					// re-bin if it crossed a cell (no-op if it got deleted)
+
 		thisNodePtr = gNextNode;							// next node
 	}
 	while (thisNodePtr != nil);
@@ -380,6 +407,78 @@ ObjNode		*thisNodePtr;
 
 
 
+/******************** SNAPSHOT OBJECT TRANSFORMS ***********************/
+//
+// Fixed-tick mode: call before each simulation tick to remember where every
+// object was, so that frames drawn between ticks can be interpolated.
+//
+
+void SnapshotObjectTransforms(void)
+{
+	gInterpolationTick++;
+
+	for (ObjNode* theNode = gFirstNodePtr; theNode != nil; theNode = theNode->NextNode)
+	{
+		const TQ3Matrix4x4* m = &theNode->BaseTransformMatrix;
+		theNode->InterpPrevTranslation = (TQ3Point3D) { m->value[3][0], m->value[3][1], m->value[3][2] };
+		theNode->InterpTick = gInterpolationTick;
+	}
+}
+
+
+/******************** APPLY OBJECT INTERPOLATION ***********************/
+//
+// Temporarily moves each object's BaseTransformMatrix back towards its position
+// at the start of the latest tick. alpha is the fraction of a tick elapsed since then.
+// Must be undone with RestoreObjectInterpolation after the scene has been drawn.
+//
+
+void ApplyObjectInterpolation(float alpha)
+{
+	float back = 1.0f - alpha;
+
+	for (ObjNode* theNode = gFirstNodePtr; theNode != nil; theNode = theNode->NextNode)
+	{
+		TQ3Matrix4x4* m = &theNode->BaseTransformMatrix;
+
+		theNode->InterpOffset = (TQ3Vector3D) {0,0,0};
+
+		if (theNode->InterpTick != gInterpolationTick)			// created during the tick: nothing to interpolate from
+			continue;
+
+		TQ3Vector3D d =
+		{
+			theNode->InterpPrevTranslation.x - m->value[3][0],
+			theNode->InterpPrevTranslation.y - m->value[3][1],
+			theNode->InterpPrevTranslation.z - m->value[3][2],
+		};
+
+		if (d.x*d.x + d.y*d.y + d.z*d.z > INTERP_MAX_TICK_DIST*INTERP_MAX_TICK_DIST)
+			continue;
+
+		theNode->InterpOffset = (TQ3Vector3D) { d.x * back, d.y * back, d.z * back };
+		m->value[3][0] += theNode->InterpOffset.x;
+		m->value[3][1] += theNode->InterpOffset.y;
+		m->value[3][2] += theNode->InterpOffset.z;
+	}
+}
+
+
+/******************** RESTORE OBJECT INTERPOLATION ***********************/
+
+void RestoreObjectInterpolation(void)
+{
+	for (ObjNode* theNode = gFirstNodePtr; theNode != nil; theNode = theNode->NextNode)
+	{
+		TQ3Matrix4x4* m = &theNode->BaseTransformMatrix;
+		m->value[3][0] -= theNode->InterpOffset.x;
+		m->value[3][1] -= theNode->InterpOffset.y;
+		m->value[3][2] -= theNode->InterpOffset.z;
+		theNode->InterpOffset = (TQ3Vector3D) {0,0,0};
+	}
+}
+
+
 /**************************** DRAW OBJECTS ***************************/
 
 void DrawObjects(const QD3DSetupOutputType *setupInfo)
@@ -415,7 +514,7 @@ float			cameraX, cameraZ;
 		if (theNode->CType == INVALID_NODE_FLAG)				// see if already deleted
 			goto next;
 
-		if (statusBits & (STATUS_BIT_ISCULLED | STATUS_BIT_HIDDEN))
+		if (statusBits & (STATUS_BIT_ISCULLED | STATUS_BIT_HIDDEN | STATUS_BIT_OCCLUDED))
 			goto next;
 
 
@@ -578,6 +677,12 @@ void DeleteObject(ObjNode	*theNode)
 	StopObjectStreamEffect(theNode);
 
 
+			/* GIVE BACK OCCLUSION QUERY SLOT */
+
+	RenderOcclusion_FreeObjectSlot(theNode->OcclusionSlot);
+	theNode->OcclusionSlot = -1;
+
+
 		/* SEE IF NEED TO DEREFERENCE A QD3D OBJECT */
 
 	for (int i = 0; i < theNode->NumMeshes; i++)
@@ -677,6 +782,8 @@ void DetachObject(ObjNode *theNode)
 	theNode->NextNode = nil;
 	
 	theNode->StatusBits |= STATUS_BIT_DETACHED;	
+	gCTypeRegistryDirty = true;
+	SpatialIndex_Remove(theNode);
 }
 
 
@@ -741,6 +848,8 @@ out:
 	
 	
 	theNode->StatusBits &= ~STATUS_BIT_DETACHED;	
+	gCTypeRegistryDirty = true;
+	SpatialIndex_Insert(theNode);
 }
 
 
@@ -789,6 +898,82 @@ static void FlushObjectDeleteQueue(int qid)
 
 
 
+//============================================================================================================
+//============================================================================================================
+//============================================================================================================
+
+#pragma mark ----- CTYPE REGISTRY ------
+
+/****************** REBUILD CTYPE REGISTRIES ***************************/
+//
+// One walk of the object list files every node under each registered CType bit it has,
+// so that the queries below only visit matching nodes instead of the whole list.
+//
+
+static void RebuildCTypeRegistries(void)
+{
+		/* MAKE SURE EVERY LIST CAN HOLD ALL NODES */
+
+	if (gCTypeRegistryCapacity < gNumObjNodes)
+	{
+		int capacity = gNumObjNodes * 2;
+
+		for (int i = 0; i < NUM_CTYPE_REGISTRIES; i++)
+		{
+			if (gCTypeRegistry[i])
+				DisposePtr((Ptr) gCTypeRegistry[i]);
+			gCTypeRegistry[i] = (ObjNode**) AllocPtr(sizeof(ObjNode*) * capacity);
+			GAME_ASSERT(gCTypeRegistry[i]);
+		}
+		gCTypeRegistryCapacity = capacity;
+	}
+
+	for (int i = 0; i < NUM_CTYPE_REGISTRIES; i++)
+		gCTypeRegistryCount[i] = 0;
+
+		/* FILE EACH NODE */
+
+	for (ObjNode* node = gFirstNodePtr; node != nil; node = node->NextNode)
+	{
+		uint32_t ctype = node->CType;
+
+		for (int i = 0; i < NUM_CTYPE_REGISTRIES; i++)
+		{
+			if (ctype & kRegisteredCTypes[i])
+				gCTypeRegistry[i][gCTypeRegistryCount[i]++] = node;
+		}
+	}
+
+	gCTypeRegistryDirty = false;
+}
+
+
+/****************** GET OBJECTS WITH CTYPE ***************************/
+//
+// Returns the attached nodes that had the given CType bit when the registry was last built,
+// in object list order. ctypeBit must be one of kRegisteredCTypes.
+//
+// A node can have dropped the bit since then, so callers should still test node->CType.
+//
+
+ObjNode* const* GetObjectsWithCType(uint32_t ctypeBit, int* outCount)
+{
+	for (int i = 0; i < NUM_CTYPE_REGISTRIES; i++)
+	{
+		if (kRegisteredCTypes[i] != ctypeBit)
+			continue;
+
+		if (gCTypeRegistryDirty)
+			RebuildCTypeRegistries();
+
+		*outCount = gCTypeRegistryCount[i];
+		return gCTypeRegistry[i];
+	}
+
+	DoFatalAlert("GetObjectsWithCType: CType 0x%x isn't registered", (unsigned int) ctypeBit);
+}
+
+
 //============================================================================================================
 //============================================================================================================
 //============================================================================================================
@@ -288,23 +288,26 @@ float	dist;
 		
 	if (shadowNode->CheckForBlockers)
 	{
-		thisNodePtr = gFirstNodePtr;
-		do
+		int				numBlockers;
+		ObjNode* const*	blockers = GetObjectsWithCType(CTYPE_BLOCKSHADOW, &numBlockers);
+
+		for (int i = 0; i < numBlockers; i++)
 		{
+			thisNodePtr = blockers[i];
 			if (thisNodePtr->CType & CTYPE_BLOCKSHADOW)						// look for things which can block the shadow
 			{
 				if (thisNodePtr->CollisionBoxes)
 				{
 					if (y < thisNodePtr->CollisionBoxes[0].bottom)
-						goto next;
+						continue;
 					if (x < thisNodePtr->CollisionBoxes[0].left)
-						goto next;
+						continue;
 					if (x > thisNodePtr->CollisionBoxes[0].right)
-						goto next;
+						continue;
 					if (z > thisNodePtr->CollisionBoxes[0].front)
-						goto next;
+						continue;
 					if (z < thisNodePtr->CollisionBoxes[0].back)
-						goto next;
+						continue;
 
 						/* SHADOW IS ON OBJECT  */
 
@@ -325,10 +328,7 @@ float	dist;
 					
 				}
 			}		
-	next:					
-			thisNodePtr = (ObjNode *)thisNodePtr->NextNode;		// next node
 		}
-		while (thisNodePtr != nil);
 	}		
 		
 			/************************/
@@ -379,6 +379,8 @@ ObjNode				*theNode;
 					
 	do
 	{	
+		theNode->StatusBits &= ~STATUS_BIT_OCCLUDED;
+
 		if (theNode->StatusBits & STATUS_BIT_ALWAYSCULL)
 			goto try_cull;
 			
@@ -402,6 +404,33 @@ try_cull:
 		if (!IsSphereInFrustum_XZ(&worldCoord, radius))
 			goto draw_off;
 
+					/* SEE IF HIDDEN BEHIND WALLS LAST FRAME */
+					//
+					// Only skip drawing it: unlike frustum culling, this must not
+					// set ISCULLED, which gameplay code uses to delete far-away objects.
+					//
+
+		if (RenderOcclusion_IsActive()
+			&& (theNode->Genre == SKELETON_GENRE || theNode->Genre == DISPLAY_GROUP_GENRE)
+			&& !(theNode->StatusBits & STATUS_BIT_DONTCULL))
+		{
+			if (theNode->OcclusionSlot < 0)
+				theNode->OcclusionSlot = RenderOcclusion_AllocObjectSlot();
+
+			TQ3BoundingBox box =
+			{
+				.min = { worldCoord.x - radius, worldCoord.y - radius, worldCoord.z - radius },
+				.max = { worldCoord.x + radius, worldCoord.y + radius, worldCoord.z + radius },
+				.isEmpty = kQ3False,
+			};
+
+			if (RenderOcclusion_TestBox(theNode->OcclusionSlot, &box))
+			{
+				gRenderStats.occludedObjects++;
+				theNode->StatusBits |= STATUS_BIT_OCCLUDED;
+			}
+		}
+
 draw_on:
 		theNode->StatusBits &= ~STATUS_BIT_ISCULLED;							// clear cull bit
 		goto next;
@@ -0,0 +1,75 @@
+// PARALLEL.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+
+#include "game.h"
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define	MAX_BANDS		8
+
+/****************************/
+/*    TYPES                 */
+/****************************/
+
+typedef struct
+{
+	ParallelBandFunc	func;
+	void*				userData;
+	int					firstRow;
+	int					endRow;				// exclusive
+}BandJob;
+
+/****************************/
+/*    BANDS                 */
+/****************************/
+
+static int BandThread(void* data)
+{
+	const BandJob* job = (const BandJob*) data;
+	job->func(job->userData, job->firstRow, job->endRow);
+	return 0;
+}
+
+void Parallel_ForBands(int numRows, ParallelBandFunc func, void* userData)
+{
+BandJob		jobs[MAX_BANDS];
+SDL_Thread*	threads[MAX_BANDS];
+
+	if (numRows <= 0)
+		return;
+
+	int numBands = SDL_GetCPUCount();
+	if (numBands > MAX_BANDS)
+		numBands = MAX_BANDS;
+	if (numBands > numRows)
+		numBands = numRows;
+	if (numBands < 1)
+		numBands = 1;
+
+	for (int band = 0; band < numBands; band++)
+	{
+		jobs[band].func		= func;
+		jobs[band].userData	= userData;
+		jobs[band].firstRow	= numRows * band / numBands;
+		jobs[band].endRow	= numRows * (band + 1) / numBands;
+	}
+
+			/* BANDS 1..N ON WORKER THREADS, BAND 0 ON THIS THREAD */
+
+	for (int band = 1; band < numBands; band++)
+	{
+		threads[band] = SDL_CreateThread(BandThread, "Band", &jobs[band]);
+		if (!threads[band])												// couldn't spawn thread, do it here
+			BandThread(&jobs[band]);
+	}
+
+	BandThread(&jobs[0]);
+
+	for (int band = 1; band < numBands; band++)
+	{
+		if (threads[band])
+			SDL_WaitThread(threads[band], NULL);
+	}
+}
@@ -0,0 +1,266 @@
+// PROFILER.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+
+#include "game.h"
+
+#if ENABLE_PROFILER
+
+#include <stdio.h>
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define PROF_HISTORY_FRAMES		128			// must be a power of 2
+#define PROF_MAX_EVENTS			16384		// must be a power of 2
+#define PROF_GRAPH_WIDTH		32			// number of frames shown in the overlay graphs
+
+static const char* kZoneNames[NUM_PROF_ZONES] =
+{
+	[kProfZone_Frame]			= "frame",
+	[kProfZone_Skinning]		= "skin",
+	[kProfZone_Collision]		= "collide",
+	[kProfZone_TerrainBuild]	= "terrain",
+	[kProfZone_Particles]		= "particles",
+	[kProfZone_Sound]			= "sound",
+	[kProfZone_Flush]			= "flush",
+};
+
+static const char* kCounterNames[NUM_PROF_COUNTERS] =
+{
+	[kProfCounter_SkinnedMeshes]	= "skinned",
+	[kProfCounter_CollisionQueries]	= "collqueries",
+	[kProfCounter_SupertilesBuilt]	= "stbuilt",
+	[kProfCounter_Particles]		= "particles",
+	[kProfCounter_SoundUpdates]		= "sndupdates",
+	[kProfCounter_FlushedMeshes]	= "flushed",
+};
+
+// Characters used to draw the rolling graphs, from lowest to highest.
+// The debug font only has printable ASCII.
+static const char kGraphRamp[] = " _.-=+*#";
+
+/****************************/
+/*    TYPES                 */
+/****************************/
+
+typedef struct
+{
+	uint64_t	zoneTicks[NUM_PROF_ZONES];
+	uint32_t	counters[NUM_PROF_COUNTERS];
+} ProfFrame;
+
+typedef struct
+{
+	uint64_t	start;
+	uint32_t	duration;
+	uint16_t	zone;
+	uint16_t	depth;
+} ProfEvent;
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+static uint64_t		gProfFrequency = 0;
+static uint64_t		gProfEpoch = 0;
+static uint64_t		gProfFrameStart = 0;
+static int			gProfDepth = 0;
+
+static ProfFrame	gProfFrames[PROF_HISTORY_FRAMES];
+static uint32_t		gProfFrameIndex = 0;				// frame currently being recorded
+
+static ProfEvent	gProfEvents[PROF_MAX_EVENTS];
+static uint32_t		gProfEventHead = 0;					// total number of events ever recorded
+
+/****************************/
+/*    HELPERS               */
+/****************************/
+
+static inline ProfFrame* CurrentFrame(void)
+{
+	return &gProfFrames[gProfFrameIndex & (PROF_HISTORY_FRAMES-1)];
+}
+
+static inline ProfFrame* PastFrame(int framesAgo)
+{
+	return &gProfFrames[(gProfFrameIndex - framesAgo) & (PROF_HISTORY_FRAMES-1)];
+}
+
+static inline float TicksToMS(uint64_t ticks)
+{
+	return (float)(1000.0 * (double)ticks / (double)gProfFrequency);
+}
+
+static void LazyInit(void)
+{
+	if (gProfFrequency != 0)
+		return;
+
+	gProfFrequency = SDL_GetPerformanceFrequency();
+	gProfEpoch = SDL_GetPerformanceCounter();
+	gProfFrameStart = gProfEpoch;
+}
+
+static void PushEvent(ProfZone zone, uint64_t start, uint64_t duration, int depth)
+{
+	ProfEvent* e = &gProfEvents[gProfEventHead & (PROF_MAX_EVENTS-1)];
+	e->start	= start;
+	e->duration	= duration > UINT32_MAX ? UINT32_MAX : (uint32_t) duration;
+	e->zone		= zone;
+	e->depth	= depth;
+	gProfEventHead++;
+}
+
+/****************************/
+/*    API                   */
+/****************************/
+
+uint64_t Profiler_BeginZone(void)
+{
+	LazyInit();
+	gProfDepth++;
+	return SDL_GetPerformanceCounter();
+}
+
+void Profiler_EndZone(ProfZone zone, uint64_t startTime)
+{
+	uint64_t now = SDL_GetPerformanceCounter();
+	uint64_t duration = now - startTime;
+
+	gProfDepth--;
+	GAME_ASSERT(gProfDepth >= 0);
+
+	CurrentFrame()->zoneTicks[zone] += duration;
+	PushEvent(zone, startTime, duration, gProfDepth + 1);
+}
+
+void Profiler_Count(ProfCounter counter, int amount)
+{
+	CurrentFrame()->counters[counter] += amount;
+}
+
+void Profiler_EndFrame(void)
+{
+	LazyInit();
+
+	uint64_t now = SDL_GetPerformanceCounter();
+	uint64_t duration = now - gProfFrameStart;
+
+	CurrentFrame()->zoneTicks[kProfZone_Frame] = duration;
+	PushEvent(kProfZone_Frame, gProfFrameStart, duration, 0);
+
+	gProfFrameStart = now;
+	gProfFrameIndex++;
+	memset(CurrentFrame(), 0, sizeof(ProfFrame));
+}
+
+int Profiler_FormatStats(char* buf, int bufSize)
+{
+	int len = 0;
+
+#define APPEND(...) do { \
+		int n = snprintf(buf + len, bufSize - len, __VA_ARGS__); \
+		if (n < 0 || n >= bufSize - len) return len; \
+		len += n; \
+	} while(0)
+
+	if (gProfFrequency == 0)
+		return 0;
+
+	for (int z = 0; z < NUM_PROF_ZONES; z++)
+	{
+		// Find average and peak over the graph window (excluding the frame being recorded)
+		uint64_t peak = 0;
+		uint64_t total = 0;
+		for (int f = 1; f <= PROF_GRAPH_WIDTH; f++)
+		{
+			uint64_t t = PastFrame(f)->zoneTicks[z];
+			total += t;
+			if (t > peak)
+				peak = t;
+		}
+
+		char graph[PROF_GRAPH_WIDTH + 1];
+		for (int f = 0; f < PROF_GRAPH_WIDTH; f++)
+		{
+			uint64_t t = PastFrame(PROF_GRAPH_WIDTH - f)->zoneTicks[z];		// oldest on the left
+			int level = peak == 0 ? 0 : (int) ((sizeof(kGraphRamp) - 2) * t / peak);
+			graph[f] = kGraphRamp[level];
+		}
+		graph[PROF_GRAPH_WIDTH] = '\0';
+
+		APPEND("%-9s %5.2f %5.2f |%s|\n",
+				kZoneNames[z],
+				TicksToMS(total) / PROF_GRAPH_WIDTH,
+				TicksToMS(peak),
+				graph);
+	}
+
+	const ProfFrame* last = PastFrame(1);
+	for (int c = 0; c < NUM_PROF_COUNTERS; c++)
+	{
+		APPEND("%s: %u%s", kCounterNames[c], last->counters[c], (c % 3 == 2) ? "\n" : "  ");
+	}
+
+#undef APPEND
+
+	return len;
+}
+
+bool Profiler_ExportChromeTrace(const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	uint32_t numEvents = gProfEventHead < PROF_MAX_EVENTS ? gProfEventHead : PROF_MAX_EVENTS;
+	uint32_t first = gProfEventHead - numEvents;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (uint32_t i = 0; i < numEvents; i++)
+	{
+		const ProfEvent* e = &gProfEvents[(first + i) & (PROF_MAX_EVENTS-1)];
+
+		// Timestamps are in microseconds
+		double ts	= 1e6 * (double)(e->start - gProfEpoch) / (double)gProfFrequency;
+		double dur	= 1e6 * (double)e->duration / (double)gProfFrequency;
+
+		fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"bugdom\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"depth\":%d}}\n",
+				i == 0 ? "" : ",",
+				kZoneNames[e->zone],
+				ts,
+				dur,
+				e->depth);
+	}
+
+	// Emit per-frame counters for the frames still in the history ring
+	int numFrames = gProfFrameIndex < PROF_HISTORY_FRAMES ? (int) gProfFrameIndex : PROF_HISTORY_FRAMES - 1;
+	uint64_t frameEnd = gProfFrameStart;
+	for (int f = 1; f <= numFrames; f++)
+	{
+		const ProfFrame* frame = PastFrame(f);
+		uint64_t frameStart = frameEnd - frame->zoneTicks[kProfZone_Frame];
+		double ts = 1e6 * (double)(frameStart - gProfEpoch) / (double)gProfFrequency;
+
+		fprintf(file, "%s{\"name\":\"counters\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{",
+				numEvents == 0 && f == 1 ? "" : ",",
+				ts);
+		for (int c = 0; c < NUM_PROF_COUNTERS; c++)
+		{
+			fprintf(file, "%s\"%s\":%u", c == 0 ? "" : ",", kCounterNames[c], frame->counters[c]);
+		}
+		fprintf(file, "}}\n");
+
+		frameEnd = frameStart;
+	}
+
+	fprintf(file, "]}\n");
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+#endif // ENABLE_PROFILER
@@ -12,9 +12,10 @@
 char						gTypedAsciiKey = '\0';
 
 static const uint32_t	kDebugTextUpdateInterval = 0;//50;
+static const float		kDebugNearbyEnemyRadius = 2000.0f;
 static uint32_t			gDebugTextFrameAccumulator = 0;
 static uint32_t			gDebugTextLastUpdatedAt = 0;
-static char				gDebugTextBuffer[1024];
+static char				gDebugTextBuffer[2048];
 
 static void UpdateDebugStats(void)
 {
@@ -36,17 +37,22 @@ static void UpdateDebugStats(void)
 			case 3: debugModeName = "show splines"; break;
 		}
 
-		snprintf(
+		int len = snprintf(
 				gDebugTextBuffer, sizeof(gDebugTextBuffer),
-				"fps: %d\ntris: %d\nmeshes: %d+%d\ntiles: %ld/%ld%s\nnodes: %d\nheap: %dK, %dp\n\nx: %d\nz: %d\ny: %.3f %s%s\n%s\n%s\n\n\n\n\n\n\n\n\n"
-				"Bugdom %s\nOpenGL %s, %s @ %dx%d",
+				"fps: %d\ntris: %d\nmeshes: %d+%d\nfade copy avoided: %dK\noccluded: %d tiles, %d objs\ntiles: %ld/%ld%s\ntile cache: %ld, hit %ld, miss %ld\nnodes: %d\nheap: %dK, %dp\n\nx: %d\nz: %d\ny: %.3f %s%s\n%s\n%s\n",
 				(int)roundf(fps),
 				gRenderStats.triangles,
 				gRenderStats.meshesPass1,
 				gRenderStats.meshesPass2,
-				gSupertileBudget - gNumFreeSupertiles,
+				gRenderStats.fadeCopyBytesAvoided / 1024,
+				gRenderStats.occludedSupertiles,
+				gRenderStats.occludedObjects,
+				gSupertileBudget - gNumFreeSupertiles - gNumCachedSupertiles,
 				gSupertileBudget,
 				gSuperTileMemoryListExists ? "" : " (no terrain)",
+				gNumCachedSupertiles,
+				gSuperTileCacheHits,
+				gSuperTileCacheMisses,
 				gNumObjNodes,
 				(int)(Pomme_GetHeapSize() / 1024),
 				(int)Pomme_GetNumAllocs(),
@@ -56,7 +62,29 @@ static void UpdateDebugStats(void)
 				(gPlayerObj && gPlayerObj->StatusBits & STATUS_BIT_ONGROUND)? "G" : "",
 				(gPlayerObj && gPlayerObj->MPlatform)? "M" : "",
 				debugModeName,
-				gLiquidCheat ? "Liquid cheat ON" : "",
+				gLiquidCheat ? "Liquid cheat ON" : ""
+		);
+
+		len += FramePacing_FormatStats(gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len);
+		len += snprintf(gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len, "\n");
+
+		if (gPlayerObj)
+		{
+			int numNearbyEnemies;
+			SpatialIndex_QueryRadius(gPlayerObj->Coord.x, gPlayerObj->Coord.z, kDebugNearbyEnemyRadius, CTYPE_ENEMY, &numNearbyEnemies);
+			len += snprintf(gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len, "enemies within %d: %d\n",
+					(int) kDebugNearbyEnemyRadius, numNearbyEnemies);
+		}
+
+#if ENABLE_PROFILER
+		len += snprintf(gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len, "\nzone       avg  peak (ms)\n");
+		len += Profiler_FormatStats(gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len);
+		len += snprintf(gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len, "\n");
+#endif
+
+		snprintf(
+				gDebugTextBuffer + len, sizeof(gDebugTextBuffer) - len,
+				"\n\n\n\n\n\n\n\nBugdom %s\nOpenGL %s, %s @ %dx%d",
 				PROJECT_VERSION,
 				glGetString(GL_VERSION),
 				glGetString(GL_RENDERER),
@@ -72,6 +100,8 @@ static void UpdateDebugStats(void)
 
 void DoSDLMaintenance(void)
 {
+	PROFILE_END_FRAME();
+
 	switch (gDebugMode)
 	{
 		case DEBUG_MODE_OFF:
@@ -156,4 +186,15 @@ void DoSDLMaintenance(void)
 
 		glPolygonMode(GL_FRONT_AND_BACK, gDebugMode == DEBUG_MODE_WIREFRAME? GL_LINE: GL_FILL);
 	}
+
+#if ENABLE_PROFILER
+	if (gDebugMode != DEBUG_MODE_OFF && GetNewKeyState_SDL(SDL_SCANCODE_F9))
+	{
+		const char* tracePath = "BugdomTrace.json";
+		if (Profiler_ExportChromeTrace(tracePath))
+			printf("Wrote profiler trace to %s\n", tracePath);
+		else
+			DoAlert("Couldn't write profiler trace to %s", tracePath);
+	}
+#endif
 }
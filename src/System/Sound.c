@@ -11,6 +11,7 @@
 /***************/
 
 #include "game.h"
+#include "version.h"
 #include <stdio.h>
 
 
@@ -19,8 +20,10 @@
 /****************************/
 
 static void SongCompletionProc(SndChannelPtr chan);
+static void StartDecodedSong(void);
 static short FindSilentChannel(void);
 static void Calc3DEffectVolume(short effectNum, TQ3Point3D *where, float volAdjust, u_long *leftVolOut, u_long *rightVolOut);
+static void Update3DSoundChannelVolumes(void);
 
 
 /****************************/
@@ -40,13 +43,44 @@ typedef struct
 
 typedef struct
 {
-	SndListHandle	sndHandle;
-	long			sndOffset;
+	Ptr				soundHeader;				// points into the bank's arena
 	short			lastPlayedOnChannel;
 	u_long			lastLoudness;
 } LoadedEffect;
 
 
+		/* SOUND BANK CACHE FILE */
+		//
+		// Once a bank's effects have been decompressed, the packed arena is written
+		// to the prefs folder so that later loads skip the AIFF parsing/decoding.
+		// Native byte order; the file is only ever read back on the same machine.
+		// Each entry remembers the size of the AIFF it came from, so replacing
+		// a sound file invalidates the cache.
+		//
+
+#define	SOUNDBANK_CACHE_MAGIC		"BgSndBk2"
+#define	SOUNDBANK_BYTE_ORDER		0x01020304
+#define	SOUNDBANK_ALIGN(size)		(((size) + 7) & ~7L)
+
+typedef struct
+{
+	char			magic[8];
+	char			version[16];				// PROJECT_VERSION that built the cache
+	uint32_t		byteOrder;
+	int32_t			bank;
+	int32_t			numEffects;
+	int32_t			arenaSize;
+} SoundBankFileHeader;
+
+typedef struct
+{
+	int32_t			effectNum;
+	int32_t			offset;						// offset of the effect's SoundHeader in the arena
+	int32_t			size;						// SoundHeader + samples
+	int32_t			sourceFileSize;				// size of the AIFF it was decoded from
+} SoundBankFileEntry;
+
+
 #define	VOLUME_DISTANCE_FACTOR	.005f		// bigger == sound decays FASTER with dist, smaller = louder far away
 
 
@@ -74,11 +108,16 @@ float						gSongVolume = 1;		// multiplied by gGlobalVolume
 
 TQ3Point3D					gEarCoords;				// coord of camera plus a bit to get pt in front of camera
 static	TQ3Vector3D			gEyeVector;
+static	TQ3Vector2D			gEarLookVec;			// gEyeVector flattened to XZ & normalized
 
 static	LoadedEffect		gLoadedEffects[NUM_EFFECTS];
+static	Ptr					gSoundBankArena[NUM_SOUNDBANKS];		// all decoded effects of a bank in one block
 
 static	SndChannelPtr		gSndChannel[MAX_CHANNELS];
 static	ChannelInfoType		gChannelInfo[MAX_CHANNELS];
+static	TQ3Point3D			gChannelEmitterCoord[MAX_CHANNELS];		// last position given to Update3DSoundChannel
+static	Boolean				gChannelEmitterMoved[MAX_CHANNELS];		// volume needs recomputing this frame
+static	Boolean				gChannelInaudible[MAX_CHANNELS];		// muted by the batch update; the owner frees it on its next update
 
 static short				gMaxChannels = 0;
 
@@ -90,6 +129,10 @@ static	SndChannelPtr		gMusicChannel=nil;
 Boolean						gMuteMusicFlag = false;
 static short				gCurrentSong = -1;
 
+static MusicDecodeJob*		gSongDecodeJob = nil;		// non-nil if current song is played from a decoded buffer
+static Boolean				gAllChannelsPaused = false;	// set by PauseAllChannels
+static Boolean				gSongDecodePending = false;	// song is still being decoded, start it when done
+
 
 		/*****************/
 		/* EFFECTS TABLE */
@@ -166,6 +209,7 @@ OSErr		iErr;
 			/* INIT BANK INFO */
 
 	memset(gLoadedEffects, 0, sizeof(gLoadedEffects));
+	memset(gSoundBankArena, 0, sizeof(gSoundBankArena));
 
 			/******************/
 			/* ALLOC CHANNELS */
@@ -189,79 +233,320 @@ OSErr		iErr;
 }
 
 /******************* LOAD A SOUND EFFECT ************************/
+//
+// Loads and decompresses one AIFF from the bank's folder.
+//
+// OUTPUT:	the decompressed 'snd ' resource, the offset of its SoundHeader and the AIFF's size;
+//			nil if the file is missing.
+//
+
+static OSErr MakeSoundEffectFSSpec(int effectNum, char* path, size_t pathSize, FSSpec* spec)
+{
+	const EffectDef* effectDef = &kEffectsTable[effectNum];
 
-void LoadSoundEffect(int effectNum)
+	snprintf(path, pathSize, ":audio:%s.sounds:%s.aiff", kSoundBankNames[effectDef->bank], effectDef->filename);
+
+	return FSMakeFSSpec(gDataSpec.vRefNum, gDataSpec.parID, path, spec);
+}
+
+//
+// OUTPUT:	size of the effect's AIFF, or -1 if it's missing.
+//
+
+static long GetSoundEffectFileSize(int effectNum)
 {
 char path[256];
 FSSpec spec;
 short refNum;
-OSErr err;
+long eof = -1;
 
-	LoadedEffect* loadedSound = &gLoadedEffects[effectNum];
-	const EffectDef* effectDef = &kEffectsTable[effectNum];
+	if (MakeSoundEffectFSSpec(effectNum, path, sizeof(path), &spec) != noErr)
+		return -1;
 
-	if (loadedSound->sndHandle)
-	{
-		// already loaded
-		return;
-	}
+	if (FSpOpenDF(&spec, fsRdPerm, &refNum) != noErr)
+		return -1;
+
+	GetEOF(refNum, &eof);
+	FSClose(refNum);
 
-	snprintf(path, sizeof(path), ":audio:%s.sounds:%s.aiff", kSoundBankNames[effectDef->bank], effectDef->filename);
+	return eof;
+}
 
-	err = FSMakeFSSpec(gDataSpec.vRefNum, gDataSpec.parID, path, &spec);
+static SndListHandle LoadSoundEffectFile(int effectNum, long* outHeaderOffset, long* outFileSize)
+{
+char path[256];
+FSSpec spec;
+short refNum;
+OSErr err;
+SndListHandle sndHandle;
+
+	err = MakeSoundEffectFSSpec(effectNum, path, sizeof(path), &spec);
 	if (err != noErr)
 	{
 		DoAlert(path);
-		return;
+		return nil;
 	}
 
 	err = FSpOpenDF(&spec, fsRdPerm, &refNum);
 	GAME_ASSERT_MESSAGE(err == noErr, path);
 
-	loadedSound->sndHandle = Pomme_SndLoadFileAsResource(refNum);
-	GAME_ASSERT_MESSAGE(loadedSound->sndHandle, path);
+	*outFileSize = 0;
+	GetEOF(refNum, outFileSize);
+
+	sndHandle = Pomme_SndLoadFileAsResource(refNum);
+	GAME_ASSERT_MESSAGE(sndHandle, path);
 
 	FSClose(refNum);
 
 			/* GET OFFSET INTO IT */
 
-	GetSoundHeaderOffset(loadedSound->sndHandle, &loadedSound->sndOffset);
+	GetSoundHeaderOffset(sndHandle, outHeaderOffset);
 
 			/* PRE-DECOMPRESS IT */
 
-	Pomme_DecompressSoundResource(&loadedSound->sndHandle, &loadedSound->sndOffset);
+	Pomme_DecompressSoundResource(&sndHandle, outHeaderOffset);
+
+	return sndHandle;
 }
 
-/******************* DISPOSE OF A SOUND EFFECT ************************/
+/******************* INSTALL SOUND BANK ARENA ************************/
 
-void DisposeSoundEffect(int effectNum)
+static void InstallSoundBankArena(int bankNum, Ptr arena, const SoundBankFileEntry* entries, int numEntries)
 {
-	LoadedEffect* loadedSound = &gLoadedEffects[effectNum];
+	gSoundBankArena[bankNum] = arena;
 
-	if (loadedSound->sndHandle)
+	for (int i = 0; i < numEntries; i++)
 	{
-		DisposeHandle((Handle) loadedSound->sndHandle);
-		memset(loadedSound, 0, sizeof(LoadedEffect));
+		gLoadedEffects[entries[i].effectNum].soundHeader = arena + entries[i].offset;
 	}
 }
 
+/******************* SOUND BANK CACHE ************************/
+
+static void MakeSoundBankCacheFSSpec(int bankNum, bool createFolder, FSSpec* spec)
+{
+char filename[64];
+
+	snprintf(filename, sizeof(filename), "SoundCache-%s", kSoundBankNames[bankNum]);
+	MakePrefsFSSpec(filename, createFolder, spec);
+}
+
+static int CountEffectsInBank(int bankNum)
+{
+	int n = 0;
+	for (int i = 0; i < NUM_EFFECTS; i++)
+	{
+		if (kEffectsTable[i].bank == bankNum)
+			n++;
+	}
+	return n;
+}
+
+//
+// OUTPUT:	true if the bank was installed from its cache file.
+//
+
+static Boolean LoadSoundBankCache(int bankNum)
+{
+FSSpec				spec;
+short				refNum;
+long				count, eof = 0;
+SoundBankFileHeader	header;
+SoundBankFileEntry	entries[NUM_EFFECTS];
+Ptr					arena = nil;
+
+	MakeSoundBankCacheFSSpec(bankNum, false, &spec);
+	if (FSpOpenDF(&spec, fsRdPerm, &refNum) != noErr)
+		return false;
+
+	GetEOF(refNum, &eof);
+
+			/* READ & CHECK HEADER */
+
+	if (eof < (long) sizeof(header))
+		goto bad;
+
+	count = sizeof(header);
+	if (FSRead(refNum, &count, (Ptr) &header) != noErr || count != sizeof(header))
+		goto bad;
+
+	if (0 != memcmp(header.magic, SOUNDBANK_CACHE_MAGIC, sizeof(header.magic))
+		|| 0 != strncmp(header.version, PROJECT_VERSION, sizeof(header.version))
+		|| header.byteOrder != SOUNDBANK_BYTE_ORDER
+		|| header.bank != bankNum
+		|| header.numEffects != CountEffectsInBank(bankNum)
+		|| header.arenaSize <= 0
+		|| header.arenaSize > eof
+		|| eof != (long) (sizeof(header) + header.numEffects * sizeof(SoundBankFileEntry) + header.arenaSize))
+	{
+		goto bad;
+	}
+
+			/* READ & CHECK OFFSET TABLE */
+
+	count = header.numEffects * sizeof(SoundBankFileEntry);
+	if (FSRead(refNum, &count, (Ptr) entries) != noErr || count != (long) (header.numEffects * sizeof(SoundBankFileEntry)))
+		goto bad;
+
+	for (int i = 0; i < header.numEffects; i++)
+	{
+		if (entries[i].effectNum < 0
+			|| entries[i].effectNum >= NUM_EFFECTS
+			|| kEffectsTable[entries[i].effectNum].bank != bankNum
+			|| entries[i].offset < 0
+			|| entries[i].size <= 0
+			|| entries[i].offset > header.arenaSize - entries[i].size		// samples must fit in the arena
+			|| entries[i].sourceFileSize != GetSoundEffectFileSize(entries[i].effectNum))	// AIFF was replaced
+		{
+			goto bad;
+		}
+	}
+
+			/* READ ARENA IN ONE GO */
+
+	arena = NewPtr(header.arenaSize);
+	GAME_ASSERT(arena);
+
+	count = header.arenaSize;
+	if (FSRead(refNum, &count, arena) != noErr || count != header.arenaSize)
+		goto bad;
+
+	FSClose(refNum);
+
+	InstallSoundBankArena(bankNum, arena, entries, header.numEffects);
+	return true;
+
+bad:
+	if (arena)
+		DisposePtr(arena);
+	FSClose(refNum);
+	return false;
+}
+
+static void SaveSoundBankCache(int bankNum, Ptr arena, long arenaSize, const SoundBankFileEntry* entries, int numEntries)
+{
+FSSpec				spec;
+short				refNum;
+long				count;
+OSErr				iErr;
+SoundBankFileHeader	header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SOUNDBANK_CACHE_MAGIC, sizeof(header.magic));
+	snprintf(header.version, sizeof(header.version), "%s", PROJECT_VERSION);
+	header.byteOrder	= SOUNDBANK_BYTE_ORDER;
+	header.bank			= bankNum;
+	header.numEffects	= numEntries;
+	header.arenaSize	= (int32_t) arenaSize;
+
+			/* CREATE BLANK FILE */
+
+	MakeSoundBankCacheFSSpec(bankNum, true, &spec);
+	FSpDelete(&spec);
+	if (FSpCreate(&spec, 'BalZ', 'Snds', smSystemScript) != noErr)
+		return;
+
+	if (FSpOpenDF(&spec, fsRdWrPerm, &refNum) != noErr)
+	{
+		FSpDelete(&spec);
+		return;
+	}
+
+			/* WRITE HEADER, OFFSET TABLE & ARENA */
+
+	count = sizeof(header);
+	iErr = FSWrite(refNum, &count, (Ptr) &header);
+
+	if (!iErr)
+	{
+		count = numEntries * sizeof(SoundBankFileEntry);
+		iErr = FSWrite(refNum, &count, (Ptr) entries);
+	}
+
+	if (!iErr)
+	{
+		count = arenaSize;
+		iErr = FSWrite(refNum, &count, arena);
+	}
+
+	FSClose(refNum);
+
+	if (iErr)													// don't leave a truncated cache behind
+		FSpDelete(&spec);
+}
+
 /******************* LOAD SOUND BANK ************************/
+//
+// All of a bank's decompressed effects live in a single block (the "arena"),
+// each SoundHeader followed by its samples, 8-byte aligned. The arena comes
+// straight from the bank's cache file if there is a valid one, otherwise it's
+// built from the AIFFs and the cache is written for next time.
+//
 
 void LoadSoundBank(int bankNum)
 {
+SoundBankFileEntry	entries[NUM_EFFECTS];
+SndListHandle		handles[NUM_EFFECTS];
+long				headerOffsets[NUM_EFFECTS];
+long				sizes[NUM_EFFECTS];
+int					numEntries = 0;
+long				arenaSize = 0;
+
 	StopAllEffectChannels();
 
+	if (gSoundBankArena[bankNum])								// already loaded
+		return;
+
+	if (LoadSoundBankCache(bankNum))
+		return;
+
 			/****************************/
 			/* LOAD ALL EFFECTS IN BANK */
 			/****************************/
 
 	for (int i = 0; i < NUM_EFFECTS; i++)
 	{
-		if (kEffectsTable[i].bank == bankNum)
-		{
-			LoadSoundEffect(i);
-		}
+		if (kEffectsTable[i].bank != bankNum)
+			continue;
+
+		long fileSize = 0;
+		SndListHandle sndHandle = LoadSoundEffectFile(i, &headerOffsets[numEntries], &fileSize);
+		if (!sndHandle)
+			continue;
+
+		handles[numEntries]				= sndHandle;
+		sizes[numEntries]				= GetHandleSize((Handle) sndHandle) - headerOffsets[numEntries];
+		entries[numEntries].effectNum	= i;
+		entries[numEntries].offset		= (int32_t) arenaSize;
+		entries[numEntries].size		= (int32_t) sizes[numEntries];
+		entries[numEntries].sourceFileSize = (int32_t) fileSize;
+
+		arenaSize += SOUNDBANK_ALIGN(sizes[numEntries]);
+		numEntries++;
 	}
+
+	if (numEntries == 0)
+		return;
+
+			/**************************/
+			/* PACK THEM IN ONE BLOCK */
+			/**************************/
+
+	Ptr arena = AllocPtr(arenaSize);
+	GAME_ASSERT(arena);
+
+	for (int i = 0; i < numEntries; i++)
+	{
+		memcpy(arena + entries[i].offset, ((Ptr) *handles[i]) + headerOffsets[i], sizes[i]);
+		DisposeHandle((Handle) handles[i]);
+	}
+
+	InstallSoundBankArena(bankNum, arena, entries, numEntries);
+
+			/* SKIP DECODING NEXT TIME */
+
+	if (numEntries == CountEffectsInBank(bankNum))				// only cache complete banks
+		SaveSoundBankCache(bankNum, arena, arenaSize, entries, numEntries);
 }
 
 /******************** DISPOSE SOUND BANK **************************/
@@ -270,15 +555,21 @@ void DisposeSoundBank(int bankNum)
 {
 	StopAllEffectChannels();									// make sure all sounds are stopped before nuking any banks
 
+	if (!gSoundBankArena[bankNum])
+		return;
+
 			/* FREE ALL SAMPLES */
 
 	for (int i = 0; i < NUM_EFFECTS; i++)
 	{
 		if (kEffectsTable[i].bank == bankNum)
 		{
-			DisposeSoundEffect(i);
+			memset(&gLoadedEffects[i], 0, sizeof(LoadedEffect));
 		}
 	}
+
+	DisposePtr(gSoundBankArena[bankNum]);
+	gSoundBankArena[bankNum] = nil;
 }
 
 
@@ -324,6 +615,8 @@ short		c = *channelNum;
 	*channelNum = -1;
 	
 	gChannelInfo[c].effectNum = -1;	
+	gChannelEmitterMoved[c] = false;
+	gChannelInaudible[c] = false;
 	
 }
 
@@ -350,6 +643,8 @@ void PauseAllChannels(Boolean pause)
 {
 	SndCommand cmd = { .cmd = pause ? pommePausePlaybackCmd : pommeResumePlaybackCmd };
 
+	gAllChannelsPaused = pause;
+
 	for (int c = 0; c < gMaxChannels; c++)
 	{
 		SndDoImmediate(gSndChannel[c], &cmd);
@@ -455,6 +750,10 @@ OSErr	iErr;
 	short musicFileRefNum = OpenGameFile(path);
 	volume = FULL_CHANNEL_VOLUME * gSongVolume;
 
+			/* DECODE IMA4 SONGS IN THE BACKGROUND */
+
+	gSongDecodeJob = MusicDecode_Start(musicFileRefNum);
+
 
 	gCurrentSong = songNum;
 	
@@ -477,7 +776,21 @@ OSErr	iErr;
 					
 			
 			
-			/* START PLAYING FROM FILE */
+			/* PLAY DECODED SONG ONCE IT'S READY (SEE DoSoundMaintenance) */
+
+	if (gSongDecodeJob)
+	{
+		FSClose(musicFileRefNum);
+		gSongDecodePending = true;
+		gSongPlayingFlag = true;
+		StartDecodedSong();										// in case it's already done
+		return;
+	}
+
+	FSClose(musicFileRefNum);									// reopen it to rewind it for SndStartFilePlay
+	musicFileRefNum = OpenGameFile(path);
+
+			/* OTHERWISE, START PLAYING FROM FILE */
 
 	iErr = SndStartFilePlay(
 			gMusicChannel,
@@ -517,6 +830,45 @@ OSErr	iErr;
 //		SndPauseFilePlay(gMusicChannel);						// pause it	
 }
 
+/***************** START DECODED SONG *********************/
+//
+// Starts playing the current song from its decoded buffer, if the decoder is done with it.
+// A looping song wraps around within the buffer, so there's no gap at the loop point.
+//
+
+static void StartDecodedSong(void)
+{
+SndCommand	cmd;
+
+	if (!gSongDecodePending || !MusicDecode_IsDone(gSongDecodeJob))
+		return;
+
+	gSongDecodePending = false;
+
+	cmd.cmd = bufferCmd;
+	cmd.param1 = 0;
+	cmd.ptr = MusicDecode_GetSoundHeader(gSongDecodeJob);
+	if (SndDoImmediate(gMusicChannel, &cmd))
+	{
+		DoAlert("PlaySong: bufferCmd failed!");
+		KillSong();
+		return;
+	}
+
+	cmd.cmd = pommeSetLoopCmd;
+	cmd.param1 = gLoopSongFlag ? 1 : 0;
+	cmd.param2 = 0;
+	if (SndDoImmediate(gMusicChannel, &cmd))
+		DoFatalAlert("PlaySong: SndDoImmediate (pomme loop extension) failed!");
+
+	if (gMuteMusicFlag)											// muted while we were decoding
+	{
+		cmd.cmd = pommePausePlaybackCmd;
+		SndDoImmediate(gMusicChannel, &cmd);
+	}
+}
+
+
 /***************** SONG COMPLETION PROC *********************/
 
 static void SongCompletionProc(SndChannelPtr chan)
@@ -541,7 +893,18 @@ void KillSong(void)
 
 	gSongPlayingFlag = false;											// tell callback to do nothing
 
-	SndStopFilePlay(gMusicChannel, true);								// stop it
+	if (gSongDecodeJob)
+	{
+		SndCommand cmd = { .cmd = quietCmd };
+		SndDoImmediate(gMusicChannel, &cmd);							// stop it before freeing its buffer
+		MusicDecode_Dispose(gSongDecodeJob);
+		gSongDecodeJob = nil;
+		gSongDecodePending = false;
+	}
+	else
+	{
+		SndStopFilePlay(gMusicChannel, true);							// stop it
+	}
 }
 
 #pragma mark -
@@ -615,7 +978,6 @@ u_long			leftVol, rightVol;
 Boolean Update3DSoundChannel(int effectNum, short *channel, TQ3Point3D *where)
 {
 SCStatus		theStatus;
-u_long			leftVol,rightVol;
 short			c;
 
 	c = *channel;
@@ -623,15 +985,31 @@ short			c;
 	if (c == -1)
 		return(true);
 
+	PROFILE_BEGIN(Sound);
+	PROFILE_COUNT(SoundUpdates, 1);
+
 			/* MAKE SURE THE SAME SOUND IS STILL ON THIS CHANNEL */
 			
 	if (effectNum != gChannelInfo[c].effectNum)
 	{
 		*channel = -1;
+		PROFILE_END(Sound);
 		return(true);
 	}
 	
 
+			/* SEE IF THE BATCH UPDATE FOUND IT INAUDIBLE */
+			//
+			// Stop it through the owner's pointer so the owner's channel # gets reset.
+			//
+
+	if (gChannelInaudible[c])
+	{
+		StopAChannel(channel);
+		PROFILE_END(Sound);
+		return(true);
+	}
+
 			/* SEE IF SOUND HAS COMPLETED */
 			
 #if 0	// Source port removal
@@ -642,23 +1020,20 @@ short			c;
 		if (!theStatus.scChannelBusy)									// see if channel not busy
 		{
 			StopAChannel(channel);							// make sure it's really stopped (OS X sound manager bug)
+			PROFILE_END(Sound);
 			return(true);
 		}
 	}
 
 			/* UPDATE THE THING */
 
-	if (where)
+	if (where)															// volume is recomputed in DoSoundMaintenance
 	{
-		Calc3DEffectVolume(gChannelInfo[c].effectNum, where, gChannelInfo[c].volumeAdjust, &leftVol, &rightVol);
-		if ((leftVol+rightVol) == 0)										// if volume goes to 0, then kill channel
-		{
-			StopAChannel(channel);
-			return(false);
-		}
+		gChannelEmitterCoord[c] = *where;
+		gChannelEmitterMoved[c] = true;
+	}
 
-		ChangeChannelVolume(c, leftVol, rightVol);
-	}	
+	PROFILE_END(Sound);
 	return(false);
 }
 
@@ -677,6 +1052,7 @@ TQ3Vector3D	v;
 	v.z = gGameViewInfoPtr->currentCameraLookAt.z - gGameViewInfoPtr->currentCameraCoords.z;
 
 	gEyeVector = v;
+	FastNormalizeVector2D(v.x, v.z, &gEarLookVec);
 
 	FastNormalizeVector(v.x, v.y, v.z, &v);
 
@@ -718,7 +1094,7 @@ u_long			lv2,rv2;
 	LoadedEffect* sound = &gLoadedEffects[effectNum];
 
 	GAME_ASSERT_MESSAGE(effectNum >= 0 && effectNum < NUM_EFFECTS, "illegal effect number");
-	GAME_ASSERT_MESSAGE(sound->sndHandle, "effect wasn't loaded!");
+	GAME_ASSERT_MESSAGE(sound->soundHeader, "effect wasn't loaded!");
 
 
 			/* DON'T PLAY EFFECT MULTIPLE TIMES AT ONCE IF EFFECTS TABLE PREVENTS IT */
@@ -752,6 +1128,9 @@ u_long			lv2,rv2;
 		return(-1);
 	}
 
+	gChannelEmitterMoved[theChan] = false;							// don't apply a stale 3D update to the new effect
+	gChannelInaudible[theChan] = false;
+
 	// Remember channel # on which we played this effect
 	sound->lastPlayedOnChannel = theChan;
 	sound->lastLoudness = leftVolume + rightVolume;
@@ -785,7 +1164,7 @@ u_long			lv2,rv2;
 
 	mySndCmd.cmd = bufferCmd;										// make it play
 	mySndCmd.param1 = 0;
-	mySndCmd.ptr = ((Ptr)*sound->sndHandle) + sound->sndOffset;		// pointer to SoundHeader
+	mySndCmd.ptr = sound->soundHeader;								// pointer to SoundHeader
 	myErr = SndDoImmediate(chanPtr, &mySndCmd);
 	if (myErr)
 		return(-1);
@@ -849,7 +1228,14 @@ u_long			lv2,rv2;
 void ToggleMusic(void)
 {
 	gMuteMusicFlag = !gMuteMusicFlag;
-	SndPauseFilePlay(gMusicChannel);			// pause it
+
+	if (gSongDecodeJob)
+	{
+		SndCommand cmd = { .cmd = gMuteMusicFlag ? pommePausePlaybackCmd : pommeResumePlaybackCmd };
+		SndDoImmediate(gMusicChannel, &cmd);
+	}
+	else
+		SndPauseFilePlay(gMusicChannel);			// pause it
 }
 
 
@@ -868,6 +1254,28 @@ void DoSoundMaintenance(void)
 			ToggleMusic();			
 	}
 
+				/* SEE IF DECODED SONG IS READY, OR DONE PLAYING */
+
+	if (gSongDecodeJob)
+	{
+		if (gSongDecodePending)
+			StartDecodedSong();
+		else
+		if (!gLoopSongFlag && !gMuteMusicFlag && !gAllChannelsPaused)	// a paused song may read as not busy
+		{
+			SCStatus status;
+			if (SndChannelStatus(gMusicChannel, sizeof(SCStatus), &status) == noErr
+				&& !status.scChannelBusy && !status.scChannelPaused)
+			{
+				gResetSong = true;
+			}
+		}
+	}
+
+				/* APPLY THIS FRAME'S 3D CHANNEL VOLUMES */
+
+	Update3DSoundChannelVolumes();
+
 				/* SEE IF STREAMED MUSIC STOPPED - SO RESET */
 
 	if (gResetSong)
@@ -917,117 +1325,132 @@ SCStatus	theStatus;
 
 
 
-/******************** CALC 3D EFFECT VOLUME *********************/
+/******************** CALC 3D EFFECT VOLUMES *********************/
+//
+// Computes the left/right volumes of a batch of 3D sounds.
+// The per-sound work is straight-line float math over flat arrays so the
+// compiler can vectorize it; the ear and look vector are shared by all sounds.
+//
 
-static void Calc3DEffectVolume(short effectNum, TQ3Point3D *where, float volAdjust, u_long *leftVolOut, u_long *rightVolOut)
+static void Calc3DEffectVolumes(int n, const short* effectNums, const TQ3Point3D* where, const float* volAdjusts,
+								u_long* leftVolsOut, u_long* rightVolsOut)
 {
-float	dist;
-float	refDist,volumeFactor;
-u_long	volume,left,right;
-u_long	maxLeft,maxRight;
+float	refDist[MAX_CHANNELS];
+float	volAdjust[MAX_CHANNELS];
+float	leftF[MAX_CHANNELS], rightF[MAX_CHANNELS];
+
+	GAME_ASSERT(n <= MAX_CHANNELS);
 
-			/* TONE DOWN ANNOYING BUZZ EFFECT */
+			/* GATHER PER-EFFECT PARAMETERS */
 
-	if (effectNum == EFFECT_BUZZ)
+	for (int i = 0; i < n; i++)
 	{
-		volAdjust *= .5f;
+		refDist[i] = kEffectsTable[effectNums[i]].refDistance;
+		volAdjust[i] = volAdjusts[i];
+
+		if (effectNums[i] == EFFECT_BUZZ)								// tone down annoying buzz effect
+			volAdjust[i] *= .5f;
 	}
 
-	dist 	= Q3Point3D_Distance(where, &gEarCoords);		// calc dist to sound for pane 0
-		
-			/* DO VOLUME CALCS */
-			
-	refDist = kEffectsTable[effectNum].refDistance;			// get ref dist
+			/* DISTANCE ATTENUATION & STEREO SEPARATION */
 
-	dist -= refDist;
-	if (dist <= EPS)
-		volumeFactor = 1.0f;
-	else
+	const float lookX = gEarLookVec.x;
+	const float lookY = gEarLookVec.y;
+
+	for (int i = 0; i < n; i++)
 	{
-		volumeFactor = 1.0f / (dist * VOLUME_DISTANCE_FACTOR);
-		if (volumeFactor > 1.0f)
-			volumeFactor = 1.0f;
+		float dx = where[i].x - gEarCoords.x;
+		float dy = where[i].y - gEarCoords.y;
+		float dz = where[i].z - gEarCoords.z;
+
+		float dist = sqrtf(dx*dx + dy*dy + dz*dz) - refDist[i];
+		float volumeFactor = (dist <= EPS) ? 1.0f : fminf(1.0f, 1.0f / (dist * VOLUME_DISTANCE_FACTOR));
+
+		u_long volume = (float)FULL_CHANNEL_VOLUME * volumeFactor * volAdjust[i];
+		float volF = (volume < 6) ? 0.0f : fminf((float)volume, 256.0f);	// if really quiet, then just turn it off
+
+				/* VECTOR TO SOUND */
+
+		float invMag = (dx == 0.0f && dz == 0.0f) ? 0.0f : 1.0f / (sqrtf(dx*dx + dz*dz) + FLT_MIN);
+		float toX = dx * invMag;
+		float toY = dz * invMag;
+
+				/* DOT PRODUCT TELLS US HOW MUCH STEREO SHIFT, CROSS PRODUCT WHICH SIDE */
+
+		float dot = 1.0f - fabsf(toX * lookX + toY * lookY);
+		dot = ClampFloat(dot, 0.0f, 1.0f);
+
+		float cross = toX * lookY - toY * lookX;
+		float shift = (cross > 0.0f) ? dot : -dot;
+
+		leftF[i]	= volF + (volF * shift);
+		rightF[i]	= volF - (volF * shift);
 	}
-	
-	volume = (float)FULL_CHANNEL_VOLUME * volumeFactor * volAdjust;	
-	
-				
-	if (volume < 6)							// if really quiet, then just turn it off
+
+	for (int i = 0; i < n; i++)
 	{
-		*leftVolOut = *rightVolOut = 0;
-		return;
+		leftVolsOut[i]	= leftF[i];
+		rightVolsOut[i]	= rightF[i];
 	}
+}
 
-			/************************/
-			/* DO STEREO SEPARATION */
-			/************************/
-	
-	else		
+
+/******************** CALC 3D EFFECT VOLUME *********************/
+
+static void Calc3DEffectVolume(short effectNum, TQ3Point3D *where, float volAdjust, u_long *leftVolOut, u_long *rightVolOut)
+{
+	Calc3DEffectVolumes(1, &effectNum, where, &volAdjust, leftVolOut, rightVolOut);
+}
+
+
+/***************** UPDATE 3D SOUND CHANNEL VOLUMES ******************/
+//
+// Once per frame, recomputes the volumes of all the 3D channels whose emitters
+// reported a position through Update3DSoundChannel, in a single batch.
+// Channels that have become inaudible are freed; their owners restart them
+// with PlayEffect3D once they're within earshot again.
+//
+
+static void Update3DSoundChannelVolumes(void)
+{
+short		chans[MAX_CHANNELS];
+short		effectNums[MAX_CHANNELS];
+TQ3Point3D	where[MAX_CHANNELS];
+float		volAdjusts[MAX_CHANNELS];
+u_long		leftVols[MAX_CHANNELS], rightVols[MAX_CHANNELS];
+int			n = 0;
+
+	for (short c = 0; c < gMaxChannels; c++)
 	{
-		float		volF = (float)volume;
-		
-		if (volF > 256.0f)
-		{
-//			printf("Sfx %d volume %f clipped\n", effectNum, volF);
-			volF = 256.0f;
-		}
-		
-		TQ3Vector2D	earToSound,lookVec;
-		float		dot,cross;
-		
-		maxLeft = maxRight = 0;
-		
-			/* CALC VECTOR TO SOUND */
-			
-		earToSound.x = where->x - gEarCoords.x;
-		earToSound.y = where->z - gEarCoords.z;
-		FastNormalizeVector2D(earToSound.x, earToSound.y, &earToSound);
-		
-		
-			/* CALC EYE LOOK VECTOR */
-			
-		FastNormalizeVector2D(gEyeVector.x, gEyeVector.z, &lookVec);
-			
+		if (!gChannelEmitterMoved[c])
+			continue;
 
-			/* DOT PRODUCT  TELLS US HOW MUCH STEREO SHIFT */
-			
-		dot = 1.0f - fabs(Q3Vector2D_Dot(&earToSound,  &lookVec));
-		if (dot < 0.0f)
-			dot = 0.0f;
-		else
-		if (dot > 1.0f)
-			dot = 1.0f;
+		gChannelEmitterMoved[c] = false;
 
+		chans[n]		= c;
+		effectNums[n]	= gChannelInfo[c].effectNum;
+		where[n]		= gChannelEmitterCoord[c];
+		volAdjusts[n]	= gChannelInfo[c].volumeAdjust;
+		n++;
+	}
 
-			/* CROSS PRODUCT TELLS US WHICH SIDE */
-			
-		cross = Q3Vector2D_Cross(&earToSound,  &lookVec);
-		
-		
-				/* DO LEFT/RIGHT CALC */
-				
-		if (cross > 0.0f)
-		{
-			left 	= volF + (volF * dot);
-			right 	= volF - (volF * dot);
-		}
-		else
-		{
-			right 	= volF + (volF * dot);
-			left 	= volF - (volF * dot);
-		}
-		
-		
-				/* KEEP MAX */
-				
-		if (left > maxLeft)
-			maxLeft = left;
-		if (right > maxRight)
-			maxRight = right;
-				
+	if (n == 0)
+		return;
+
+	PROFILE_BEGIN(Sound);
+
+	Calc3DEffectVolumes(n, effectNums, where, volAdjusts, leftVols, rightVols);
+
+	for (int i = 0; i < n; i++)
+	{
+		short c = chans[i];
+
+		if ((leftVols[i] + rightVols[i]) == 0)							// if volume goes to 0, mute it now;
+			gChannelInaudible[c] = true;								// the owner kills it on its next update
+
+		ChangeChannelVolume(c, leftVols[i], rightVols[i]);
 	}
 
-	*leftVolOut = maxLeft;
-	*rightVolOut = maxRight;		
+	PROFILE_END(Sound);
 }
 
@@ -0,0 +1,380 @@
+// SPATIAL INDEX.C
+// This file is part of Bugdom. https://github.com/jorio/bugdom
+//
+// Shared XZ index over the ObjNodes, used by collision and AI/targeting queries
+// instead of walking the whole object list.
+//
+
+#include "game.h"
+#include <stdlib.h>
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define	SPATIAL_GRID_DIM		64									// hashed xz grid (must be a power of 2)
+#define	SPATIAL_CELL_SIZE		TERRAIN_SUPERTILE_UNIT_SIZE
+#define	SPATIAL_MAX_EXTENT		(SPATIAL_CELL_SIZE / 2)				// how far boxes may reach from a binned node's coord
+#define	SPATIAL_CELL_OVERSIZE	(SPATIAL_GRID_DIM * SPATIAL_GRID_DIM)	// extra "cell" for big or not-yet-binned nodes
+#define	NUM_SPATIAL_CELLS		(SPATIAL_CELL_OVERSIZE + 1)
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+static ObjNode*		gSpatialCells[NUM_SPATIAL_CELLS];
+static uint32_t		gSpatialAttachSeq = 0;
+
+static ObjNode**	gSpatialResults = NULL;
+static int			gSpatialResultsCapacity = 0;
+static int			gNumSpatialResults = 0;
+
+/****************************/
+/*    CELLS                 */
+/****************************/
+
+static inline int SpatialGridCoord(float coord)
+{
+	return ((int) floorf(coord * (1.0f / SPATIAL_CELL_SIZE))) & (SPATIAL_GRID_DIM - 1);
+}
+
+static inline int SpatialGridCell(int cx, int cz)
+{
+	return (cz & (SPATIAL_GRID_DIM - 1)) * SPATIAL_GRID_DIM + (cx & (SPATIAL_GRID_DIM - 1));
+}
+
+//
+// Nodes go in the cell containing their coord, unless one of their collision boxes
+// reaches past SPATIAL_MAX_EXTENT, in which case box queries couldn't find them by
+// looking at the neighboring cells only.
+//
+
+static int CalcSpatialCell(const ObjNode* node)
+{
+	float x = node->Coord.x;
+	float z = node->Coord.z;
+
+	for (int i = 0; i < node->NumCollisionBoxes; i++)
+	{
+		const CollisionBoxType* box = &node->CollisionBoxes[i];
+
+		if (box->left < x - SPATIAL_MAX_EXTENT || box->right > x + SPATIAL_MAX_EXTENT ||
+			box->back < z - SPATIAL_MAX_EXTENT || box->front > z + SPATIAL_MAX_EXTENT)
+		{
+			return SPATIAL_CELL_OVERSIZE;
+		}
+	}
+
+	return SpatialGridCell(SpatialGridCoord(x), SpatialGridCoord(z));
+}
+
+static void LinkToCell(ObjNode* node, int cell)
+{
+	node->SpatialCell = cell;
+	node->SpatialPrev = nil;
+	node->SpatialNext = gSpatialCells[cell];
+	if (gSpatialCells[cell])
+		gSpatialCells[cell]->SpatialPrev = node;
+	gSpatialCells[cell] = node;
+}
+
+static void UnlinkFromCell(ObjNode* node)
+{
+	if (node->SpatialPrev)
+		node->SpatialPrev->SpatialNext = node->SpatialNext;
+	else
+		gSpatialCells[node->SpatialCell] = node->SpatialNext;
+
+	if (node->SpatialNext)
+		node->SpatialNext->SpatialPrev = node->SpatialPrev;
+
+	node->SpatialPrev = nil;
+	node->SpatialNext = nil;
+}
+
+/****************************/
+/*    MAINTENANCE           */
+/****************************/
+
+void SpatialIndex_Reset(void)
+{
+	memset(gSpatialCells, 0, sizeof(gSpatialCells));
+	gSpatialAttachSeq = 0;
+}
+
+//
+// Called when a node is attached to the object list.
+// Its boxes usually aren't set up yet, so it starts out on the oversize list
+// (which every query scans) until the next SpatialIndex_Update bins it.
+//
+
+void SpatialIndex_Insert(ObjNode* node)
+{
+	node->AttachSeq = gSpatialAttachSeq++;				// AttachObject puts new nodes after others of the same Slot
+
+	if (node->Slot >= SLOT_OF_DUMB)
+	{
+		node->SpatialCell = SPATIAL_CELL_NONE;
+		return;
+	}
+
+	LinkToCell(node, SPATIAL_CELL_OVERSIZE);
+}
+
+void SpatialIndex_Remove(ObjNode* node)
+{
+	if (node->SpatialCell == SPATIAL_CELL_NONE)
+		return;
+
+	UnlinkFromCell(node);
+	node->SpatialCell = SPATIAL_CELL_NONE;
+}
+
+//
+// Re-bins a node after it moved. Only touches the cell lists if it crossed into another cell.
+//
+
+void SpatialIndex_Update(ObjNode* node)
+{
+	if (node->SpatialCell == SPATIAL_CELL_NONE)
+		return;
+
+	int cell = CalcSpatialCell(node);
+	if (cell == node->SpatialCell)
+		return;
+
+	UnlinkFromCell(node);
+	LinkToCell(node, cell);
+}
+
+/****************************/
+/*    RESULTS               */
+/****************************/
+
+static void BeginResults(void)
+{
+	if (gSpatialResultsCapacity < gNumObjNodes)
+	{
+		if (gSpatialResults)
+			DisposePtr((Ptr) gSpatialResults);
+		gSpatialResultsCapacity = gNumObjNodes * 2;
+		gSpatialResults = (ObjNode**) AllocPtr(sizeof(ObjNode*) * gSpatialResultsCapacity);
+		GAME_ASSERT(gSpatialResults);
+	}
+
+	gNumSpatialResults = 0;
+}
+
+static inline void AddResult(ObjNode* node)
+{
+	GAME_ASSERT(gNumSpatialResults < gSpatialResultsCapacity);
+	gSpatialResults[gNumSpatialResults++] = node;
+}
+
+//
+// The object list is sorted by Slot, and nodes of equal Slot are in attach order,
+// so (Slot, AttachSeq) puts results back in the order a list walk would have seen them.
+//
+
+static inline bool IsBeforeInObjectList(const ObjNode* a, const ObjNode* b)
+{
+	if (a->Slot != b->Slot)
+		return a->Slot < b->Slot;
+	return a->AttachSeq < b->AttachSeq;
+}
+
+static int CompareListOrder(const void* a, const void* b)
+{
+	const ObjNode* na = *(const ObjNode* const*) a;
+	const ObjNode* nb = *(const ObjNode* const*) b;
+	return IsBeforeInObjectList(na, nb) ? -1 : (IsBeforeInObjectList(nb, na) ? 1 : 0);
+}
+
+static inline bool MatchesCType(const ObjNode* node, uint32_t ctypeMask)
+{
+	return node->CType & ctypeMask;
+}
+
+/****************************/
+/*    QUERIES               */
+/****************************/
+
+//
+// Returns every indexed node with any of the ctypeMask bits
+// that may have a collision box overlapping the XZ rectangle, in object list order.
+// Callers still need to do their own box tests.
+//
+
+ObjNode* const* SpatialIndex_QueryBox(float left, float right, float back, float front, uint32_t ctypeMask, int* outCount)
+{
+	BeginResults();
+
+	for (ObjNode* node = gSpatialCells[SPATIAL_CELL_OVERSIZE]; node; node = node->SpatialNext)
+	{
+		if (MatchesCType(node, ctypeMask))
+			AddResult(node);
+	}
+
+	int cx0 = (int) floorf((left - SPATIAL_MAX_EXTENT) * (1.0f / SPATIAL_CELL_SIZE));
+	int cx1 = (int) floorf((right + SPATIAL_MAX_EXTENT) * (1.0f / SPATIAL_CELL_SIZE));
+	int cz0 = (int) floorf((back - SPATIAL_MAX_EXTENT) * (1.0f / SPATIAL_CELL_SIZE));
+	int cz1 = (int) floorf((front + SPATIAL_MAX_EXTENT) * (1.0f / SPATIAL_CELL_SIZE));
+
+	if (cx1 - cx0 >= SPATIAL_GRID_DIM) cx1 = cx0 + SPATIAL_GRID_DIM - 1;		// don't visit wrapped cells twice
+	if (cz1 - cz0 >= SPATIAL_GRID_DIM) cz1 = cz0 + SPATIAL_GRID_DIM - 1;
+
+	for (int cz = cz0; cz <= cz1; cz++)
+	{
+		for (int cx = cx0; cx <= cx1; cx++)
+		{
+			for (ObjNode* node = gSpatialCells[SpatialGridCell(cx, cz)]; node; node = node->SpatialNext)
+			{
+				if (MatchesCType(node, ctypeMask))
+					AddResult(node);
+			}
+		}
+	}
+
+	qsort(gSpatialResults, gNumSpatialResults, sizeof(ObjNode*), CompareListOrder);
+
+	*outCount = gNumSpatialResults;
+	return gSpatialResults;
+}
+
+//
+// Returns the indexed nodes whose coord is within radius of (x,z) on the XZ plane, in object list order.
+//
+
+ObjNode* const* SpatialIndex_QueryRadius(float x, float z, float radius, uint32_t ctypeMask, int* outCount)
+{
+	int numCandidates;
+	ObjNode* const* candidates = SpatialIndex_QueryBox(x - radius, x + radius, z - radius, z + radius, ctypeMask, &numCandidates);
+
+	int n = 0;
+	for (int i = 0; i < numCandidates; i++)
+	{
+		ObjNode* node = candidates[i];
+		if (CalcDistance(x, z, node->Coord.x, node->Coord.z) <= radius)
+			gSpatialResults[n++] = node;						// compacting in place keeps the order
+	}
+
+	gNumSpatialResults = n;
+	*outCount = n;
+	return gSpatialResults;
+}
+
+static void ConsiderNearest(ObjNode* node, float dist, int k, int* numFound, ObjNode** outNodes, float* outDists)
+{
+	int n = *numFound;
+
+	if (n == k)
+	{
+		if (dist > outDists[k-1] ||
+			(dist == outDists[k-1] && !IsBeforeInObjectList(node, outNodes[k-1])))
+		{
+			return;													// not better than current worst
+		}
+	}
+	else
+	{
+		n++;
+	}
+
+		/* INSERTION SORT INTO RESULTS */
+
+	int j = n - 1;
+	while (j > 0 &&
+			(dist < outDists[j-1] || (dist == outDists[j-1] && IsBeforeInObjectList(node, outNodes[j-1]))))
+	{
+		outNodes[j] = outNodes[j-1];
+		outDists[j] = outDists[j-1];
+		j--;
+	}
+	outNodes[j] = node;
+	outDists[j] = dist;
+
+	*numFound = n;
+}
+
+//
+// Finds up to k nodes nearest to (x,z) that are closer than maxDist, have any of the ctypeMask
+// bits and pass the optional filter. Results are sorted nearest first; ties go
+// to the node that comes first in the object list, like a linear scan with "if (d < minDist)".
+//
+// distFunc must never be smaller than max(|dx|,|dz|) (true of CalcDistance and CalcQuickDistance):
+// the search walks rings of cells outward and stops as soon as no unvisited cell can beat the
+// k-th best distance.
+//
+// OUTPUT:	# of nodes found
+//
+
+int SpatialIndex_QueryNearest(float x, float z, float maxDist, uint32_t ctypeMask,
+							SpatialFilterFunc filter, void* userData, SpatialDistanceFunc distFunc,
+							int k, ObjNode** outNodes, float* outDists)
+{
+int	numFound = 0;
+
+	GAME_ASSERT(k > 0);
+
+	for (ObjNode* node = gSpatialCells[SPATIAL_CELL_OVERSIZE]; node; node = node->SpatialNext)
+	{
+		if (!MatchesCType(node, ctypeMask))
+			continue;
+		if (filter && !filter(node, userData))
+			continue;
+
+		float dist = distFunc(x, z, node->Coord.x, node->Coord.z);
+		if (dist < maxDist)
+			ConsiderNearest(node, dist, k, &numFound, outNodes, outDists);
+	}
+
+	int cx = (int) floorf(x * (1.0f / SPATIAL_CELL_SIZE));
+	int cz = (int) floorf(z * (1.0f / SPATIAL_CELL_SIZE));
+
+	for (int ring = 0; ring <= SPATIAL_GRID_DIM / 2; ring++)
+	{
+			/* SEE IF ANY UNVISITED CELL COULD STILL HAVE SOMETHING CLOSER */
+			//
+			// Nodes in rings >= ring are at least (ring-1) cells away from (x,z) on one axis.
+			//
+
+		float ringMinDist = (ring - 1) * SPATIAL_CELL_SIZE;
+		if (ringMinDist >= maxDist)
+			break;
+		if (numFound == k && ringMinDist > outDists[k-1])
+			break;
+
+			/* VISIT CELLS ON THIS RING */
+
+		bool wrapped = (2 * ring + 1) > SPATIAL_GRID_DIM;				// last ring: +ring and -ring hash to the same cells
+
+		for (int dz = -ring; dz <= ring; dz++)
+		{
+			if (wrapped && dz == ring)
+				continue;
+
+			bool edgeRow = (dz == -ring || dz == ring);
+			int step = edgeRow ? 1 : 2 * ring;							// inner rows only have their two end cells on the ring
+
+			for (int dx = -ring; dx <= ring; dx += step)
+			{
+				if (wrapped && dx == ring)
+					continue;
+
+				for (ObjNode* node = gSpatialCells[SpatialGridCell(cx + dx, cz + dz)]; node; node = node->SpatialNext)
+				{
+					if (!MatchesCType(node, ctypeMask))
+						continue;
+					if (filter && !filter(node, userData))
+						continue;
+
+					float dist = distFunc(x, z, node->Coord.x, node->Coord.z);
+					if (dist < maxDist)
+						ConsiderNearest(node, dist, k, &numFound, outNodes, outDists);
+				}
+			}
+		}
+	}
+
+	return numFound;
+}
@@ -92,6 +92,10 @@ static KeyState		gMouseButtonState[NUM_MOUSE_BUTTONS];
 static KeyState		gKeyStates[kKey_MAX];
 static KeyState		gRawKeyboardState[SDLKEYSTATEBUF_SIZE];
 
+static Boolean		gKeyPressLatch[kKey_MAX];			// new presses not yet seen by a fixed simulation tick
+static Boolean		gTickKeyPresses[kKey_MAX];			// new presses visible to the current fixed simulation tick
+static Boolean		gIsInInputTick = false;
+
 Boolean				gPlayerUsingKeyControl 	= false;
 
 TQ3Vector2D			gCameraControlDelta;
@@ -304,6 +308,8 @@ void ResetInputState(void)
 	memset(gKeyStates, KEYSTATE_IGNOREHELD, kKey_MAX);
 	memset(gRawKeyboardState, KEYSTATE_IGNOREHELD, SDL_NUM_SCANCODES);
 	memset(gMouseButtonState, KEYSTATE_IGNOREHELD, sizeof(gMouseButtonState));
+	memset(gKeyPressLatch, 0, sizeof(gKeyPressLatch));
+	memset(gTickKeyPresses, 0, sizeof(gTickKeyPresses));
 
 	MouseSmoothing_ResetState();
 	EatMouseEvents();
@@ -312,6 +318,8 @@ void ResetInputState(void)
 void InvalidateKeyState(int need)
 {
 	gKeyStates[need] = KEYSTATE_IGNOREHELD;
+	gKeyPressLatch[need] = false;
+	gTickKeyPresses[need] = false;
 }
 
 
@@ -359,6 +367,9 @@ void UpdateKeyMap(void)
 			downNow |= 0 != SDL_GameControllerGetButton(gSDLController, kb->gamepadButton);
 
 		UpdateKeyState(&gKeyStates[i], downNow);
+
+		if (gKeyStates[i] == KEYSTATE_PRESSED)
+			gKeyPressLatch[i] = true;
 	}
 
 
@@ -404,9 +415,33 @@ Boolean GetKeyState_SDL(unsigned short key)
 Boolean GetNewKeyState(unsigned short key)
 {
 	GAME_ASSERT(key < kKey_MAX);
+
+	if (gIsInInputTick)
+		return gTickKeyPresses[key];
+
 	return gKeyStates[key] == KEYSTATE_PRESSED;
 }
 
+
+/**************** BEGIN/END INPUT TICK *************/
+//
+// With a fixed simulation tick, a rendered frame may run zero or several ticks.
+// Presses are latched until the next tick sees them, so that a press is
+// neither dropped (frame with no tick) nor reported twice (frame with 2+ ticks).
+//
+
+void BeginInputTick(void)
+{
+	memcpy(gTickKeyPresses, gKeyPressLatch, sizeof(gTickKeyPresses));
+	memset(gKeyPressLatch, 0, sizeof(gKeyPressLatch));
+	gIsInInputTick = true;
+}
+
+void EndInputTick(void)
+{
+	gIsInInputTick = false;
+}
+
 Boolean GetNewKeyState_SDL(unsigned short key)
 {
 	if (key >= SDLKEYSTATEBUF_SIZE)
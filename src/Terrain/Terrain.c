@@ -21,6 +21,8 @@ static void ScrollTerrainUp(long superRow, long superCol);
 static void ScrollTerrainDown(long superRow, long superCol);
 static void ScrollTerrainLeft(void);
 static void ScrollTerrainRight(long superCol, long superRow, long tileCol, long tileRow);
+static void PlaceSuperTile(long superRow, long superCol);
+static void FillTerrainWindowHoles(void);
 static short GetFreeSuperTileMemory(void);
 static inline void ReleaseSuperTileObject(int32_t superTileNum);
 static void CalcNewItemDeleteWindow(void);
@@ -31,7 +33,12 @@ static void	ShrinkSuperTileTextureMap(const u_short *srcPtr,u_short *destPtr);
 //static void	ShrinkSuperTileTextureMapTo64(u_short *srcPtr,u_short *destPtr);
 static void ShrinkHalf(const uint16_t* input, uint16_t* output, int outputSize);
 static inline void ReleaseAllSuperTiles(void);
+static void RetireSuperTile(int32_t superTileNum);
+static short AcquireSuperTile(long superRow, long superCol);
 static void BuildSuperTileLOD(SuperTileMemoryType *superTilePtr, short lod);
+static void BuildSuperTileFarMesh(SuperTileMemoryType *superTilePtr, int layer);
+static void PrecomputeTerrainLighting(void);
+static void DisposeTerrainLighting(void);
 
 
 /****************************/
@@ -41,6 +48,26 @@ static void BuildSuperTileLOD(SuperTileMemoryType *superTilePtr, short lod);
 #define	ITEM_WINDOW		1			// # supertiles for item add window (must be integer)
 #define	OUTER_SIZE		0.6f		// size of border out of add window for delete window (can be float)
 
+#define	HOLE_FILL_BUDGET_MS		2.0f	// time budget per frame for building supertiles deferred by a multi-supertile scroll
+#define	HOLE_FILL_URGENT_DIST	(1.5f*TERRAIN_SUPERTILE_UNIT_SIZE)	// holes this close to the camera are always filled right away
+
+		/* FAR MESH (GEOMETRIC LOD) */
+		//
+		// Beyond SUPERTILE_FAR_MESH_DIST, a supertile is drawn as a single quad spanning its 4 corners.
+		// Neighboring far meshes share their corners exactly (positions and colors), but a far mesh next
+		// to a full mesh doesn't follow the full mesh's edge, so each far mesh hangs a skirt from its edges
+		// (down for the floor, up for the ceiling) that's deep enough to cover the largest such gap.
+		// A supertile switches meshes a little past either side of that distance so that one sitting
+		// right at the threshold doesn't flip back and forth as the camera bobs.
+		//
+
+#define	NUM_FAR_CORNERS					4
+#define	NUM_VERTICES_IN_FAR_SUPERTILE	(NUM_FAR_CORNERS * 2)			// corners + bottom of skirt under each corner
+#define	NUM_TRIS_IN_FAR_SUPERTILE		(2 + NUM_FAR_CORNERS * 2)		// top quad + 1 skirt quad per edge
+#define	SUPERTILE_FAR_MESH_DIST			(6.0f * TERRAIN_SUPERTILE_UNIT_SIZE)
+#define	SUPERTILE_FAR_MESH_HYSTERESIS	(0.25f * TERRAIN_SUPERTILE_UNIT_SIZE)
+#define	SKIRT_MIN_DEPTH					8.0f
+
 #define TILE_TEXTURE_INTERNAL_FORMAT	GL_RGB
 #define TILE_TEXTURE_FORMAT				GL_BGRA_EXT
 #define TILE_TEXTURE_TYPE				GL_UNSIGNED_SHORT_1_5_5_5_REV
@@ -60,12 +87,33 @@ static int		gNumLODs = 0;
 
 static u_char	gHiccupEliminator = 0;
 
+		/* SUPERTILE CACHE */
+		//
+		// Supertiles that scroll out of the active window aren't freed right away; they're marked
+		// SUPERTILE_MODE_CACHED and remembered by their scroll buffer cell, so scrolling back over
+		// them is just a scroll buffer update. Cached supertiles are recycled least-recently-left first
+		// when we run out of free memory blocks. The cache lives as long as the supertile memory
+		// list, so it's implicitly keyed on the texture detail level as well.
+		//
+
+static int16_t	gSuperTileCacheMap[MAX_SUPERTILES_DEEP][MAX_SUPERTILES_WIDE];	// cached supertile # for each cell, or EMPTY_SUPERTILE
+static uint32_t	gSuperTileCacheClock = 0;
+long			gNumCachedSupertiles = 0;
+long			gSuperTileCacheHits = 0;
+long			gSuperTileCacheMisses = 0;
+
+static Boolean	gDeferSuperTileBuilds = false;					// set while stepping the window across several supertiles in one frame
+static Boolean	gTerrainWindowHasHoles = false;					// some on-map cells in the active window still need a supertile
+
 u_short	**gTileDataHandle;
 
 u_short	**gFloorMap = nil;								// 2 dimensional array of u_shorts (allocated below)
 u_short	**gCeilingMap = nil;
 u_short	**gVertexColors[MAX_LAYERS];
 
+static TQ3Vector3D	**gTerrainVertexNormals[MAX_LAYERS];	// per map vertex, computed once per level by PrecomputeTerrainLighting
+static TQ3ColorRGB	**gTerrainVertexLitColors[MAX_LAYERS];	// gVertexColors with the level's lights applied
+
 long	gTerrainTileWidth,gTerrainTileDepth;			// width & depth of terrain in tiles
 long	gTerrainUnitWidth,gTerrainUnitDepth;			// width & depth of terrain in world units (see TERRAIN_POLYGON_SIZE)
 
@@ -78,7 +126,7 @@ int32_t	gTerrainScrollBuffer[MAX_SUPERTILES_DEEP][MAX_SUPERTILES_WIDE];		// 2D a
 
 long	gNumFreeSupertiles = 0;
 long	gSupertileBudget = 0;
-static	SuperTileMemoryType		gSuperTileMemoryList[MAX_SUPERTILES];
+static	SuperTileMemoryType		gSuperTileMemoryList[MAX_SUPERTILES + MAX_SUPERTILE_CACHE];
 Boolean gSuperTileMemoryListExists = false;
 
 float	gTerrainItemDeleteWindow_Near,gTerrainItemDeleteWindow_Far,
@@ -129,6 +177,16 @@ static const Byte   gTileTriangles2_B[SUPERTILE_SIZE][SUPERTILE_SIZE][3] =
 	{ {24,25,31}, {25,26,32}, {26,27,33}, {27,28,34}, {28,29,35} },
 };
 
+						/* CORNERS OF A SUPERTILE, GOING AROUND ITS EDGES */
+						// (indices into the full trimesh; far mesh vertex N is corner N)
+static const	Byte			gFarMeshCorners[NUM_FAR_CORNERS] =
+{
+	0,															// top left
+	SUPERTILE_SIZE,												// top right
+	NUM_VERTICES_IN_SUPERTILE - 1,								// bottom right
+	NUM_VERTICES_IN_SUPERTILE - 1 - SUPERTILE_SIZE,				// bottom left
+};
+
 static const	Byte			gTileTriangleWinding[2][3] =
 {
 	{ 2, 1, 0 },  // floor
@@ -203,6 +261,8 @@ long	row,col;
 			gTerrainScrollBuffer[row][col] = EMPTY_SUPERTILE;
 			
 	gHiccupEliminator = 0;
+	gDeferSuperTileBuilds = false;
+	gTerrainWindowHasHoles = false;
 }
 
 
@@ -267,6 +327,9 @@ int	i;
 		Free2DArray((void**) gVertexColors[1]);
 		gVertexColors[1] = nil;
 	}
+
+	DisposeTerrainLighting();
+
 			/* NUKE SPLINE DATA */
 
 	if (gSplineList)
@@ -370,6 +433,41 @@ retryParseLODPref:
 	}
 
 
+			/* ADD EXTRA BLOCKS FOR THE SUPERTILE CACHE */
+			//
+			// Each block holds its textures twice (our copy + the GL copy),
+			// plus a far mesh per layer.
+			//
+
+	long bytesPerSuperTile = 0;
+	for (int lod = 0; lod < gNumLODs; lod++)
+		bytesPerSuperTile += gTextureSizePerLOD[lod] * gTextureSizePerLOD[lod] * sizeof(uint16_t) * 2 * numLayers;
+
+	bytesPerSuperTile += numLayers * (sizeof(TQ3TriMeshData)
+			+ NUM_TRIS_IN_FAR_SUPERTILE * sizeof(TQ3TriMeshTriangleData)
+			+ NUM_VERTICES_IN_FAR_SUPERTILE * (sizeof(TQ3Point3D) + sizeof(TQ3Vector3D) + sizeof(TQ3ColorRGBA) + sizeof(TQ3Param2D)));
+
+	long cacheSize = (long) gCommandLine.terrainCacheMB * 1024 * 1024 / bytesPerSuperTile;
+	if (cacheSize > MAX_SUPERTILE_CACHE)
+		cacheSize = MAX_SUPERTILE_CACHE;
+	if (gSupertileBudget + cacheSize > upperBound)								// no point caching more than the whole map
+		cacheSize = upperBound - gSupertileBudget;
+
+	gSupertileBudget += cacheSize;
+
+#if _DEBUG
+	printf("Supertile cache: %ld\n", cacheSize);
+#endif
+
+	for (long row = 0; row < MAX_SUPERTILES_DEEP; row++)
+		for (long col = 0; col < MAX_SUPERTILES_WIDE; col++)
+			gSuperTileCacheMap[row][col] = EMPTY_SUPERTILE;
+
+	gNumCachedSupertiles = 0;
+	gSuperTileCacheHits = 0;
+	gSuperTileCacheMisses = 0;
+
+
 	
 			/* INIT UV LIST */
 	
@@ -488,6 +586,30 @@ retryParseLODPref:
 			tmd->texturingMode = kQ3TexturingModeOpaque;
 
 			gSuperTileMemoryList[i].triMeshDataPtrs[layer] = tmd;
+
+				/* CREATE THE FAR MESH */
+				//
+				// Triangles & points are filled in by BuildSuperTileFarMesh
+				//
+
+			TQ3TriMeshData* farTmd = Q3TriMeshData_New(
+					NUM_TRIS_IN_FAR_SUPERTILE,
+					NUM_VERTICES_IN_FAR_SUPERTILE,
+					kQ3TriMeshDataFeatureVertexUVs | kQ3TriMeshDataFeatureVertexNormals | kQ3TriMeshDataFeatureVertexColors
+			);
+			GAME_ASSERT(farTmd);
+
+			for (int c = 0; c < NUM_FAR_CORNERS; c++)
+			{
+				farTmd->vertexUVs[c] = uvs[gFarMeshCorners[c]];
+				farTmd->vertexUVs[c + NUM_FAR_CORNERS] = uvs[gFarMeshCorners[c]];	// skirt is textured with the edge's color
+			}
+
+			farTmd->bBox = tmd->bBox;
+			farTmd->glTextureName = tmd->glTextureName;
+			farTmd->texturingMode = kQ3TexturingModeOpaque;
+
+			gSuperTileMemoryList[i].farMeshDataPtrs[layer] = farTmd;
 		}
 	}
 
@@ -541,6 +663,9 @@ int		numLayers;
 
 			Q3TriMeshData_Dispose(gSuperTileMemoryList[i].triMeshDataPtrs[layer]);
 			gSuperTileMemoryList[i].triMeshDataPtrs[layer] = nil;
+
+			Q3TriMeshData_Dispose(gSuperTileMemoryList[i].farMeshDataPtrs[layer]);
+			gSuperTileMemoryList[i].farMeshDataPtrs[layer] = nil;
 		}
 	}
 	
@@ -571,10 +696,177 @@ static short GetFreeSuperTileMemory(void)
 		}
 	}
 
+				/* NONE FREE, SO RECYCLE THE OLDEST CACHED BLOCK */
+
+	int32_t		oldest = -1;
+
+	for (int32_t i = 0; i < gSupertileBudget; i++)
+	{
+		if (gSuperTileMemoryList[i].mode == SUPERTILE_MODE_CACHED
+			&& (oldest < 0 || gSuperTileMemoryList[i].lastUsed < gSuperTileMemoryList[oldest].lastUsed))
+		{
+			oldest = i;
+		}
+	}
+
+	if (oldest >= 0)
+	{
+		SuperTileMemoryType* superTile = &gSuperTileMemoryList[oldest];
+		gSuperTileCacheMap[superTile->superRow][superTile->superCol] = EMPTY_SUPERTILE;
+		superTile->mode = SUPERTILE_MODE_USED;
+		gNumCachedSupertiles--;
+		return(oldest);
+	}
+
 	DoFatalAlert("No Free Supertiles!");
 	return(-1);											// ERROR, NO FREE BLOCKS!!!! SHOULD NEVER GET HERE!
 }
 
+#pragma mark -
+
+/******************* PRECOMPUTE TERRAIN LIGHTING *******************/
+//
+// The level's lights never change, so instead of lighting every supertile as it scrolls on,
+// we compute the normal and lit color of every map vertex once when the level starts.
+// BuildTerrainSuperTile then just copies its slice of these arrays.
+//
+// Bands of rows are lit in parallel (see Parallel_ForBands).
+//
+
+typedef struct
+{
+	float			ambientR,ambientG,ambientB;
+	float			fillR[2],fillG[2],fillB[2];
+	TQ3Vector3D		fillDir[2];
+	int				numFillLights;
+	int				numLayers;
+}TerrainLightingParams;
+
+static void LightTerrainVertexRows(void* userData, int firstRow, int endRow)
+{
+const TerrainLightingParams* params = (const TerrainLightingParams*) userData;
+
+	for (int layer = 0; layer < params->numLayers; layer++)
+	{
+		for (int row = firstRow; row < endRow; row++)
+		{
+			for (int col = 0; col <= gTerrainTileWidth; col++)
+			{
+				float		avX,avY,avZ;
+				TQ3Vector3D	nA,nB;
+
+					/* AVERAGE THE FACE NORMALS OF THE 4 TILES AROUND THIS VERTEX */
+
+				avX = avY = avZ = 0;
+
+				for (int rr = row-1; rr <= row; rr++)
+				{
+					for (int cc = col-1; cc <= col; cc++)
+					{
+						CalcTileNormals(layer, rr, cc, &nA, &nB);		// returns up vectors for tiles off the map
+						avX += nA.x + nB.x;
+						avY += nA.y + nB.y;
+						avZ += nA.z + nB.z;
+					}
+				}
+
+				TQ3Vector3D* normal = &gTerrainVertexNormals[layer][row][col];
+				FastNormalizeVector(avX, avY, avZ, normal);
+
+					/* GET VERTEX DIFFUSE COLOR */
+
+				u_short	color = gVertexColors[layer][row][col];
+				float	r = (float)(color>>11) * (1.0f/32.0f);
+				float	g = (float)((color>>5) & 0x3f) * (1.0f/64.0f);
+				float	b = (float)(color&0x1f) * (1.0f/32.0f);
+
+					/* APPLY LIGHTING TO THE VERTEX */
+
+				float	lr = params->ambientR;
+				float	lg = params->ambientG;
+				float	lb = params->ambientB;
+
+				for (int f = 0; f < params->numFillLights; f++)
+				{
+					float dot = -Q3Vector3D_Dot(normal, &params->fillDir[f]);
+					if (dot > 0.0f)
+					{
+						lr += params->fillR[f] * dot;
+						lg += params->fillG[f] * dot;
+						lb += params->fillB[f] * dot;
+					}
+				}
+
+				TQ3ColorRGB* lit = &gTerrainVertexLitColors[layer][row][col];
+				lit->r = r * lr < 1.0f ? r * lr : 1.0f;
+				lit->g = g * lg < 1.0f ? g * lg : 1.0f;
+				lit->b = b * lb < 1.0f ? b * lb : 1.0f;
+			}
+		}
+	}
+}
+
+static void PrecomputeTerrainLighting(void)
+{
+TerrainLightingParams	params;
+const QD3DLightDefType*	lights = &gGameViewInfoPtr->lightList;
+
+	DisposeTerrainLighting();
+
+	params.numLayers = gDoCeiling ? 2 : 1;
+
+			/* ALLOC ARRAYS (SAME SIZE AS gVertexColors) */
+
+	for (int layer = 0; layer < params.numLayers; layer++)
+	{
+		Alloc_2d_array(TQ3Vector3D, gTerrainVertexNormals[layer], gTerrainTileDepth+1, gTerrainTileWidth+1);
+		Alloc_2d_array(TQ3ColorRGB, gTerrainVertexLitColors[layer], gTerrainTileDepth+1, gTerrainTileWidth+1);
+		GAME_ASSERT(gTerrainVertexNormals[layer]);
+		GAME_ASSERT(gTerrainVertexLitColors[layer]);
+	}
+
+			/* GET LIGHT DATA */
+
+	params.ambientR = lights->ambientColor.r * lights->ambientBrightness;
+	params.ambientG = lights->ambientColor.g * lights->ambientBrightness;
+	params.ambientB = lights->ambientColor.b * lights->ambientBrightness;
+
+	params.numFillLights = lights->numFillLights > 1 ? 2 : 1;				// fill #0 is always applied, like the original code
+
+	for (int f = 0; f < params.numFillLights; f++)
+	{
+		params.fillR[f] = lights->fillColor[f].r * lights->fillBrightness[f];
+		params.fillG[f] = lights->fillColor[f].g * lights->fillBrightness[f];
+		params.fillB[f] = lights->fillColor[f].b * lights->fillBrightness[f];
+		params.fillDir[f] = lights->fillDirection[f];
+	}
+
+			/* LIGHT BANDS OF VERTEX ROWS IN PARALLEL */
+
+	Parallel_ForBands(gTerrainTileDepth + 1, LightTerrainVertexRows, &params);
+}
+
+
+/******************* DISPOSE TERRAIN LIGHTING *******************/
+
+static void DisposeTerrainLighting(void)
+{
+	for (int layer = 0; layer < MAX_LAYERS; layer++)
+	{
+		if (gTerrainVertexNormals[layer])
+		{
+			Free2DArray((void**) gTerrainVertexNormals[layer]);
+			gTerrainVertexNormals[layer] = nil;
+		}
+		if (gTerrainVertexLitColors[layer])
+		{
+			Free2DArray((void**) gTerrainVertexLitColors[layer]);
+			gTerrainVertexLitColors[layer] = nil;
+		}
+	}
+}
+
+
 #pragma mark -
 
 
@@ -600,14 +892,9 @@ TQ3Point3D			*pointList;
 TQ3TriMeshTriangleData	*triangleList;
 SuperTileMemoryType	*superTilePtr;
 TQ3ColorRGBA		*vertexColorList;
-float				brightness;
-float				ambientR,ambientG,ambientB;
-float				fillR0,fillG0,fillB0;
-float				fillR1,fillG1,fillB1;
-TQ3Vector3D			*fillDir0,*fillDir1;
-Byte				numFillLights, numLayers;
+Byte				numLayers;
 
-static TQ3Vector3D	faceNormal[NUM_TRIS_IN_SUPERTILE];
+	PROFILE_BEGIN(TerrainBuild);
 
 	if (gDoCeiling)
 		numLayers = 2;
@@ -628,6 +915,7 @@ static TQ3Vector3D	faceNormal[NUM_TRIS_IN_SUPERTILE];
 
 	for (int layer = 0; layer < MAX_LAYERS; layer++)
 	{
+		superTilePtr->usingFarMesh[layer] = false;				// pick the mesh afresh once it's drawn
 		superTilePtr->coord[layer] = (TQ3Point3D)				// also remember world coords
 		{
 			startCol*TERRAIN_POLYGON_SIZE + TERRAIN_SUPERTILE_UNIT_SIZE/2,
@@ -638,38 +926,10 @@ static TQ3Vector3D	faceNormal[NUM_TRIS_IN_SUPERTILE];
 
 	superTilePtr->left = (startCol * TERRAIN_POLYGON_SIZE);		// also save left/back coord
 	superTilePtr->back = (startRow * TERRAIN_POLYGON_SIZE);
+	superTilePtr->superRow = startRow / SUPERTILE_SIZE;			// and the scroll buffer cell
+	superTilePtr->superCol = startCol / SUPERTILE_SIZE;
 
 
-		/* GET LIGHT DATA */
-
-	brightness = gGameViewInfoPtr->lightList.ambientBrightness;				// get ambient brightness
-	ambientR = gGameViewInfoPtr->lightList.ambientColor.r * brightness;		// calc ambient color
-	ambientG = gGameViewInfoPtr->lightList.ambientColor.g * brightness;		
-	ambientB = gGameViewInfoPtr->lightList.ambientColor.b * brightness;
-
-	brightness = gGameViewInfoPtr->lightList.fillBrightness[0];				// get fill brightness 0
-	fillR0 = gGameViewInfoPtr->lightList.fillColor[0].r * brightness;		// calc ambient color
-	fillG0 = gGameViewInfoPtr->lightList.fillColor[0].g * brightness;		
-	fillB0 = gGameViewInfoPtr->lightList.fillColor[0].b * brightness;		
-	fillDir0 = &gGameViewInfoPtr->lightList.fillDirection[0];		// get fill direction
-
-	numFillLights = gGameViewInfoPtr->lightList.numFillLights;
-	if (numFillLights > 1)
-	{
-		brightness = gGameViewInfoPtr->lightList.fillBrightness[1];			// get fill brightness 1
-		fillR1 = gGameViewInfoPtr->lightList.fillColor[1].r * brightness;	// calc ambient color
-		fillG1 = gGameViewInfoPtr->lightList.fillColor[1].g * brightness;		
-		fillB1 = gGameViewInfoPtr->lightList.fillColor[1].b * brightness;		
-		fillDir1 = &gGameViewInfoPtr->lightList.fillDirection[1];
-	}
-	else
-	{
-		fillR1 = 0;
-		fillG1 = 0;
-		fillB1 = 0;
-		fillDir1 = nil;
-	}
-
 		/***********************************************************/
 		/*                DO FLOOR & CEILING LAYERS                */
 		/***********************************************************/
@@ -775,139 +1035,30 @@ static TQ3Vector3D	faceNormal[NUM_TRIS_IN_SUPERTILE];
 			}
 		}
 
-							/* CALC FACE NORMALS */
-						
-		for (i = 0; i < NUM_TRIS_IN_SUPERTILE; i++)
-		{
-			CalcFaceNormal( &pointList[triangleList[i].pointIndices[0]],
-							&pointList[triangleList[i].pointIndices[1]],
-							&pointList[triangleList[i].pointIndices[2]],
-							&faceNormal[i]);
-		}
+				/*******************************************/
+				/* GET PRECOMPUTED VERTEX NORMALS & COLORS */
+				/*******************************************/
+				//
+				// See PrecomputeTerrainLighting
+				//
 
-				/******************************/
-				/* CALCULATE VERTEX NORMALS   */
-				/******************************/
-	
 		i = 0;
 		for (row = 0; row <= SUPERTILE_SIZE; row++)
 		{
-			for (col = 0; col <= (SUPERTILE_SIZE*2); col += 2)
-			{
-				TQ3Vector3D	*n1,*n2;
-				float		avX,avY,avZ;
-				TQ3Vector3D	nA,nB;
-				long		ro,co;
-				
-				/* SCAN 4 TILES AROUND THIS TILE TO CALC AVERAGE NORMAL FOR THIS VERTEX */
-				//
-				// We use the face normal already calculated for triangles inside the supertile,
-				// but for tiles/tris outside the supertile (on the borders), we need to calculate
-				// the face normals there.
-				//
-				
-				avX = avY = avZ = 0;									// init the normal	
-				
-				for (ro = -1; ro <= 0; ro++)
-				{
-					for (co = -2; co <= 0; co+=2)
-					{
-						long	cc = col + co;
-						long	rr = row + ro;
-						
-						if ((cc >= 0) && (cc < (SUPERTILE_SIZE*2)) && (rr >= 0) && (rr < SUPERTILE_SIZE)) // see if this vertex is in supertile bounds							 
-						{					
-							n1 = &faceNormal[rr * (SUPERTILE_SIZE*2) + cc];					// average 2 triangles...
-							n2 = n1+1;
-							avX += n1->x + n2->x;											// ...and average with current average
-							avY += n1->y + n2->y;
-							avZ += n1->z + n2->z;
-						}
-						else																// tile is out of supertile, so calc face normal & average
-						{
-							CalcTileNormals(layer, rr+startRow, (cc>>1)+startCol, &nA,&nB);	// calculate the 2 face normals for this tile
-							avX += nA.x + nB.x;												// average with current average
-							avY += nA.y + nB.y;
-							avZ += nA.z + nB.z;
-						}
-					}
-				}
-				FastNormalizeVector(avX, avY, avZ, &vertexNormalList[i++]);					// normalize the vertex normal	
-			}
-		}
-		
-		if (vertexColorList)
-		{
-				/*****************************/
-				/* CALCULATE VERTEX COLORS   */
-				/*****************************/
-					
-			i = 0;
-			for (row = 0; row <= SUPERTILE_SIZE; row++)
+			const TQ3Vector3D*	srcNormal = &gTerrainVertexNormals[layer][row+startRow][startCol];
+			const TQ3ColorRGB*	srcColor = &gTerrainVertexLitColors[layer][row+startRow][startCol];
+
+			for (col = 0; col <= SUPERTILE_SIZE; col++)
 			{
-				for (col = 0; col <= SUPERTILE_SIZE; col++)
+				vertexNormalList[i] = srcNormal[col];
+
+				if (vertexColorList)
 				{
-					u_short	color = gVertexColors[layer][row+startRow][col+startCol];
-					float	r,g,b,dot;
-					float	lr,lg,lb;
-					
-							/* GET VERTEX DIFFUSE COLOR */
-							
-					r = (float)(color>>11) * (1.0f/32.0f);
-					g = (float)((color>>5) & 0x3f) * (1.0f/64.0f);
-					b = (float)(color&0x1f) * (1.0f/32.0f);
-	
-							/* APPLY LIGHTING TO THE VERTEX */
-					
-					lr = ambientR;												// factor in the ambient
-					lg = ambientG;
-					lb = ambientB;
-					
-					dot = vertexNormalList[i].x * fillDir0->x;					// calc dot product of fill #0
-					dot += vertexNormalList[i].y * fillDir0->y;
-					dot += vertexNormalList[i].z * fillDir0->z;
-					dot = -dot;
-	
-					if (dot > 0.0f)
-					{					
-						lr += fillR0 * dot;
-						lg += fillG0 * dot;
-						lb += fillB0 * dot;					
-					}
-	
-					if (numFillLights > 1)
-					{
-						dot = vertexNormalList[i].x * fillDir1->x;				// calc dot product of fill #1
-						dot += vertexNormalList[i].y * fillDir1->y;
-						dot += vertexNormalList[i].z * fillDir1->z;
-						dot = -dot;
-						
-						if (dot > 0.0f)
-						{					
-							lr += fillR1 * dot;
-							lg += fillG1 * dot;
-							lb += fillB1 * dot;					
-						}
-					}
-					
-					r *= lr;													// apply final lighting to diffuse color
-					if (r > 1.0f)
-						r = 1.0f;
-					g *= lg;
-					if (g > 1.0f)
-						g = 1.0f;
-					b *= lb;
-					if (b > 1.0f)
-						b = 1.0f;
-										
-	
-							/* SAVE COLOR INTO LIST */
-							
-					vertexColorList[i].r = r;
-					vertexColorList[i].g = g;
-					vertexColorList[i].b = b;
-					i++;
+					vertexColorList[i].r = srcColor[col].r;
+					vertexColorList[i].g = srcColor[col].g;
+					vertexColorList[i].b = srcColor[col].b;
 				}
+				i++;
 			}
 		}
 
@@ -1011,6 +1162,8 @@ static TQ3Vector3D	faceNormal[NUM_TRIS_IN_SUPERTILE];
 		triMeshData->bBox.min.z = gWorkGrid[0][0].z;
 		triMeshData->bBox.max.z = triMeshData->bBox.min.z + TERRAIN_SUPERTILE_UNIT_SIZE;
 
+		RenderOcclusion_ForgetSlot(RenderOcclusion_GetSuperTileSlot(superTileNum, layer));	// last result was for another piece of terrain
+
 
 				/******************************************/
 				/* CALC COORD & RADIUS FOR CULLING SPHERE */
@@ -1024,13 +1177,172 @@ static TQ3Vector3D	faceNormal[NUM_TRIS_IN_SUPERTILE];
 		// Calc radius of supertile bounding sphere
 		superTilePtr->radius[layer] = 0.5f * Q3Point3D_Distance(&triMeshData->bBox.min, &triMeshData->bBox.max);
 
+				/* DECIMATE FOR DISTANT VIEWING */
+
+		BuildSuperTileFarMesh(superTilePtr, layer);
+
 	}	// j (layer)
-									
+
+	PROFILE_COUNT(SupertilesBuilt, 1);
+	PROFILE_END(TerrainBuild);
 	return(superTileNum);
 }
 
 
 
+/********************** BUILD SUPERTILE FAR MESH ********************/
+//
+// Builds the decimated version of a supertile layer from its full trimesh.
+//
+
+static void SetFarMeshTriangle(TQ3TriMeshTriangleData* triangle, int layer, int a, int b, int c)
+{
+	// a, b, c are counterclockwise as seen from above; the ceiling is seen from below
+	triangle->pointIndices[0] = layer == FLOOR ? a : c;
+	triangle->pointIndices[1] = b;
+	triangle->pointIndices[2] = layer == FLOOR ? c : a;
+}
+
+static void BuildSuperTileFarMesh(SuperTileMemoryType *superTilePtr, int layer)
+{
+const TQ3TriMeshData	*fullMesh = superTilePtr->triMeshDataPtrs[layer];
+TQ3TriMeshData			*farMesh = superTilePtr->farMeshDataPtrs[layer];
+const TQ3Point3D		*fullPoints = fullMesh->points;
+float					skirtDepth = SKIRT_MIN_DEPTH;
+
+			/* COPY CORNERS */
+
+	for (int c = 0; c < NUM_FAR_CORNERS; c++)
+	{
+		int v = gFarMeshCorners[c];
+
+		farMesh->points[c] = fullPoints[v];
+		farMesh->vertexNormals[c] = fullMesh->vertexNormals[v];
+		farMesh->vertexNormals[c + NUM_FAR_CORNERS] = fullMesh->vertexNormals[v];
+	}
+
+			/* BLEND NEARBY VERTEX COLORS INTO THE CORNERS */
+			//
+			// The quad has no interior vertices, so it would lose any shading inside the supertile
+			// (e.g. the darkening from DoItemShadowCasting). Give each corner the average of the
+			// map's vertex colors within a supertile of it, weighted by how much that corner would
+			// contribute to each vertex's position on the surrounding quads (1 at the corner itself,
+			// fading to 0 a supertile away). This only depends on where the corner is on the map,
+			// so every far mesh sharing a corner gets the same color there.
+			//
+
+	if (fullMesh->vertexColors)
+	{
+		const TQ3ColorRGB* const* litColors = (const TQ3ColorRGB* const*) gTerrainVertexLitColors[layer];
+
+		for (int c = 0; c < NUM_FAR_CORNERS; c++)
+		{
+			int		cornerRow	= superTilePtr->superRow * SUPERTILE_SIZE + gFarMeshCorners[c] / (SUPERTILE_SIZE+1);
+			int		cornerCol	= superTilePtr->superCol * SUPERTILE_SIZE + gFarMeshCorners[c] % (SUPERTILE_SIZE+1);
+			float	r = 0, g = 0, b = 0, totalWeight = 0;
+
+			for (int dr = -SUPERTILE_SIZE + 1; dr < SUPERTILE_SIZE; dr++)
+			{
+				int row = cornerRow + dr;
+				if (row < 0 || row > gTerrainTileDepth)
+					continue;
+
+				for (int dc = -SUPERTILE_SIZE + 1; dc < SUPERTILE_SIZE; dc++)
+				{
+					int col = cornerCol + dc;
+					if (col < 0 || col > gTerrainTileWidth)
+						continue;
+
+					float weight = (float) ((SUPERTILE_SIZE - abs(dr)) * (SUPERTILE_SIZE - abs(dc)));
+					const TQ3ColorRGB* color = &litColors[row][col];
+
+					r += color->r * weight;
+					g += color->g * weight;
+					b += color->b * weight;
+					totalWeight += weight;
+				}
+			}
+
+			TQ3ColorRGBA blended = fullMesh->vertexColors[gFarMeshCorners[c]];
+			blended.r = r / totalWeight;
+			blended.g = g / totalWeight;
+			blended.b = b / totalWeight;
+
+			farMesh->vertexColors[c] = blended;
+			farMesh->vertexColors[c + NUM_FAR_CORNERS] = blended;
+		}
+	}
+
+			/* FIND HOW FAR THE FULL MESH'S EDGES STRAY FROM THE STRAIGHT CORNER-TO-CORNER EDGES */
+
+	for (int c = 0; c < NUM_FAR_CORNERS; c++)
+	{
+		int		from	= gFarMeshCorners[c];
+		int		to		= gFarMeshCorners[(c + 1) % NUM_FAR_CORNERS];
+		int		step	= (to - from) / SUPERTILE_SIZE;
+		float	y0		= fullPoints[from].y;
+		float	y1		= fullPoints[to].y;
+
+		for (int k = 1; k < SUPERTILE_SIZE; k++)
+		{
+			float straightY = y0 + (y1 - y0) * ((float) k / SUPERTILE_SIZE);
+			float gap = fabsf(fullPoints[from + k * step].y - straightY);
+			if (gap > skirtDepth)
+				skirtDepth = gap;
+		}
+	}
+
+			/* MAKE SKIRT BOTTOM VERTICES */
+
+	if (layer == CEILING)
+		skirtDepth = -skirtDepth;												// ceiling skirts hang up
+
+	for (int c = 0; c < NUM_FAR_CORNERS; c++)
+	{
+		farMesh->points[c + NUM_FAR_CORNERS] = farMesh->points[c];
+		farMesh->points[c + NUM_FAR_CORNERS].y -= skirtDepth;
+	}
+
+			/* TOP QUAD */
+			//
+			// Split along the diagonal whose ends are closest in height
+			//
+
+	const TQ3Point3D* p = farMesh->points;
+	TQ3TriMeshTriangleData* triangles = farMesh->triangles;
+
+	if (fabsf(p[0].y - p[2].y) < fabsf(p[1].y - p[3].y))						// "\"
+	{
+		SetFarMeshTriangle(&triangles[0], layer, 0, 3, 2);
+		SetFarMeshTriangle(&triangles[1], layer, 0, 2, 1);
+	}
+	else																		// "/"
+	{
+		SetFarMeshTriangle(&triangles[0], layer, 0, 3, 1);
+		SetFarMeshTriangle(&triangles[1], layer, 1, 3, 2);
+	}
+
+			/* SKIRTS, FACING OUTWARD */
+
+	for (int c = 0; c < NUM_FAR_CORNERS; c++)
+	{
+		int a = c;
+		int b = (c + 1) % NUM_FAR_CORNERS;
+		SetFarMeshTriangle(&triangles[2 + c*2 + 0], layer, a, b, a + NUM_FAR_CORNERS);
+		SetFarMeshTriangle(&triangles[2 + c*2 + 1], layer, b, b + NUM_FAR_CORNERS, a + NUM_FAR_CORNERS);
+	}
+
+			/* BOUNDING BOX */
+
+	farMesh->bBox = fullMesh->bBox;
+	if (layer == FLOOR)
+		farMesh->bBox.min.y -= skirtDepth;
+	else
+		farMesh->bBox.max.y -= skirtDepth;
+}
+
+
+
 /********************** BUILD SUPERTILE LEVEL OF DETAIL ********************/
 //
 // Called from DrawTerrain to generate the LOD's from the source LOD=0 geometry
@@ -1371,9 +1683,17 @@ static inline void ReleaseSuperTileObject(int32_t superTileNum)
 	GAME_ASSERT(superTileNum >= 0);
 	GAME_ASSERT(superTileNum < gSupertileBudget);
 
-	if (gSuperTileMemoryList[superTileNum].mode != SUPERTILE_MODE_FREE)
+	SuperTileMemoryType* superTile = &gSuperTileMemoryList[superTileNum];
+
+	if (superTile->mode == SUPERTILE_MODE_CACHED)								// forget it's cached
+	{
+		gSuperTileCacheMap[superTile->superRow][superTile->superCol] = EMPTY_SUPERTILE;
+		gNumCachedSupertiles--;
+	}
+
+	if (superTile->mode != SUPERTILE_MODE_FREE)
 	{
-		gSuperTileMemoryList[superTileNum].mode = SUPERTILE_MODE_FREE;		// it's free!
+		superTile->mode = SUPERTILE_MODE_FREE;									// it's free!
 		gNumFreeSupertiles++;
 	}
 
@@ -1388,6 +1708,60 @@ static inline void ReleaseAllSuperTiles(void)
 		ReleaseSuperTileObject(i);
 
 	GAME_ASSERT(gNumFreeSupertiles == gSupertileBudget);
+	GAME_ASSERT(gNumCachedSupertiles == 0);
+}
+
+
+/******************* RETIRE SUPERTILE *******************/
+//
+// Called when a supertile scrolls out of the active window.
+// If we have room for a cache, keep it built so we can bring it back cheaply.
+//
+
+static void RetireSuperTile(int32_t superTileNum)
+{
+	SuperTileMemoryType* superTile = &gSuperTileMemoryList[superTileNum];
+
+	if (gCommandLine.terrainCacheMB <= 0)
+	{
+		ReleaseSuperTileObject(superTileNum);
+		return;
+	}
+
+	GAME_ASSERT(superTile->mode == SUPERTILE_MODE_USED);
+
+	superTile->mode = SUPERTILE_MODE_CACHED;
+	superTile->lastUsed = ++gSuperTileCacheClock;
+	gSuperTileCacheMap[superTile->superRow][superTile->superCol] = superTileNum;
+	gNumCachedSupertiles++;
+}
+
+
+/******************* ACQUIRE SUPERTILE *******************/
+//
+// Returns a supertile for the given scroll buffer cell: either one we've cached
+// since it last scrolled out, or a freshly-built one.
+//
+
+static short AcquireSuperTile(long superRow, long superCol)
+{
+	int16_t superTileNum = gSuperTileCacheMap[superRow][superCol];
+
+	if (superTileNum != EMPTY_SUPERTILE)
+	{
+		SuperTileMemoryType* superTile = &gSuperTileMemoryList[superTileNum];
+		GAME_ASSERT(superTile->mode == SUPERTILE_MODE_CACHED);
+
+		superTile->mode = SUPERTILE_MODE_USED;
+		superTile->hiccupTimer = 0;												// textures are already uploaded
+		gSuperTileCacheMap[superRow][superCol] = EMPTY_SUPERTILE;
+		gNumCachedSupertiles--;
+		gSuperTileCacheHits++;
+		return superTileNum;
+	}
+
+	gSuperTileCacheMisses++;
+	return BuildTerrainSuperTile(superCol * SUPERTILE_SIZE, superRow * SUPERTILE_SIZE);
 }
 
 #pragma mark -
@@ -1406,6 +1780,11 @@ void DrawTerrain(const QD3DSetupOutputType *setupInfo)
 	TQ3Point3D cameraCoord = setupInfo->currentCameraCoords;
 	
 
+		/* ONLY ENCLOSED LEVELS HAVE ENOUGH WALLS FOR OCCLUSION CULLING TO PAY OFF */
+
+	RenderOcclusion_BeginScene(gDoCeiling);
+
+
 				/* DRAW STUFF */
 
 	for (int i = 0; i < gSupertileBudget; i++)
@@ -1429,6 +1808,13 @@ void DrawTerrain(const QD3DSetupOutputType *setupInfo)
 			if (!IsSuperTileVisible(i,j))								// make sure it's visible
 				continue;
 
+			if (RenderOcclusion_TestBox(RenderOcclusion_GetSuperTileSlot(i, j),	// hidden behind walls last frame?
+										&gSuperTileMemoryList[i].triMeshDataPtrs[j]->bBox))
+			{
+				gRenderStats.occludedSupertiles++;
+				continue;
+			}
+
 
 				/**************************************/
 				/* DRAW THE TRIMESH IN THIS SUPERTILE */
@@ -1436,13 +1822,13 @@ void DrawTerrain(const QD3DSetupOutputType *setupInfo)
 
 			int lod = 0;
 
+			TQ3Point3D tileCoord = gSuperTileMemoryList[i].coord[j];	// get x & z coords of tile
+			float dist = CalcQuickDistance(cameraCoord.x, cameraCoord.z, tileCoord.x, tileCoord.z);
+
 			if (gTerrainTextureDetail == SUPERTILE_DETAIL_PROGRESSIVE)	// the only detail level with 3 LODs
 			{
 						/* SEE WHICH LOD TO USE */
 
-				TQ3Point3D tileCoord = gSuperTileMemoryList[i].coord[j];	// get x & z coords of tile
-				float dist = CalcQuickDistance(cameraCoord.x, cameraCoord.z, tileCoord.x, tileCoord.z);
-
 				if (dist < 1300.0f)
 					lod = 0;
 				else if (dist < 1700.0f)
@@ -1464,13 +1850,26 @@ void DrawTerrain(const QD3DSetupOutputType *setupInfo)
 				}
 			}
 
+						/* USE DECIMATED GEOMETRY IF FAR AWAY */
+
+			Byte* usingFarMesh = &gSuperTileMemoryList[i].usingFarMesh[j];
+
+			if (*usingFarMesh)
+				*usingFarMesh = dist > SUPERTILE_FAR_MESH_DIST - SUPERTILE_FAR_MESH_HYSTERESIS;
+			else
+				*usingFarMesh = dist > SUPERTILE_FAR_MESH_DIST + SUPERTILE_FAR_MESH_HYSTERESIS;
+
+			TQ3TriMeshData* mesh = *usingFarMesh
+					? gSuperTileMemoryList[i].farMeshDataPtrs[j]
+					: gSuperTileMemoryList[i].triMeshDataPtrs[j];
+
 						/* USE LOD TEXTURE */
 
-			gSuperTileMemoryList[i].triMeshDataPtrs[j]->glTextureName = gSuperTileMemoryList[i].glTextureName[j][lod];
+			mesh->glTextureName = gSuperTileMemoryList[i].glTextureName[j][lod];
 
 						/* SUBMIT FOR DRAWING */
 
-			Render_SubmitMesh(gSuperTileMemoryList[i].triMeshDataPtrs[j], nil, &gTerrainRenderMods, &gSuperTileMemoryList[i].coord[j]);
+			Render_SubmitMesh(mesh, nil, &gTerrainRenderMods, &gSuperTileMemoryList[i].coord[j]);
 		}
 	}
 
@@ -1488,6 +1887,8 @@ void DrawTerrain(const QD3DSetupOutputType *setupInfo)
 
 	Render_FlushQueue();												// flush before drawing 2D stuff
 
+	RenderOcclusion_EndScene();											// query what's hidden now that the depth buffer is complete
+
 	switch (gDebugMode)
 	{
 		case DEBUG_MODE_BOXES:
@@ -1680,47 +2081,60 @@ TQ3Vector2D	look;
 	GetSuperTileInfo(x,y,&superCol,&superRow,&tileCol,&tileRow); 		// get supertile coord info
 
 
+			/* SEE IF WE'RE JUMPING MORE THAN 1 SUPERTILE */
+			//
+			// Teleports and low frame rates can move the window by several supertiles at once.
+			// We step the window one row/col at a time so that the usual edge item scans still
+			// run for every row/col that we pass over, but the supertiles themselves aren't built
+			// until the window has settled: cells that we only cross on the way would be released
+			// right away anyway. FillTerrainWindowHoles then builds just the cells that the new
+			// window gained, nearest to the camera first.
+			//
+
+	gDeferSuperTileBuilds = (labs(superRow - gCurrentSuperTileRow) > 1) || (labs(superCol - gCurrentSuperTileCol) > 1);
+
+
 		// NOTE: DO VERTICAL FIRST!!!!
 
 				/* SEE IF SCROLLED UP */
 
-	if (superRow > gCurrentSuperTileRow)
+	while (superRow > gCurrentSuperTileRow)
 	{
-		if (superRow > (gCurrentSuperTileRow+1))						// check for overload scroll
-			DoFatalAlert("DoMyTerrainUpdate: scrolled up > 1 tile!");
-		ScrollTerrainUp(superRow,superCol);
-		gCurrentSuperTileRow = superRow;
+		ScrollTerrainUp(gCurrentSuperTileRow+1, superCol);
+		gCurrentSuperTileRow++;
 	}
-	else
+
 				/* SEE IF SCROLLED DOWN */
 
-	if (superRow < gCurrentSuperTileRow)
+	while (superRow < gCurrentSuperTileRow)
 	{
-		if (superRow < (gCurrentSuperTileRow-1))						// check for overload scroll
-			DoFatalAlert("DoMyTerrainUpdate: scrolled down < -1 tile!");
-		ScrollTerrainDown(superRow,superCol);
-		gCurrentSuperTileRow = superRow;
+		ScrollTerrainDown(gCurrentSuperTileRow-1, superCol);
+		gCurrentSuperTileRow--;
 	}
 
 			/* SEE IF SCROLLED LEFT */
 
-	if (superCol > gCurrentSuperTileCol)
+	while (superCol > gCurrentSuperTileCol)
 	{
-		if (superCol > (gCurrentSuperTileCol+1))						// check for overload scroll
-			DoFatalAlert("DoMyTerrainUpdate: scrolled left > 1 tile!");
-		ScrollTerrainLeft();
+		ScrollTerrainLeft();											// does gCurrentSuperTileCol++
 	}
-	else
+
 				/* SEE IF SCROLLED RIGHT */
 
-	if (superCol < gCurrentSuperTileCol)
+	while (superCol < gCurrentSuperTileCol)
 	{
-		if (superCol < (gCurrentSuperTileCol-1))						// check for overload scroll
-			DoFatalAlert("DoMyTerrainUpdate: scrolled right < -1 tile!");
-		ScrollTerrainRight(superCol,superRow,tileCol,tileRow);
-		gCurrentSuperTileCol = superCol;
+		long newCol = gCurrentSuperTileCol-1;
+		ScrollTerrainRight(newCol, superRow, newCol*SUPERTILE_SIZE, tileRow);
+		gCurrentSuperTileCol = newCol;
 	}
 
+	gDeferSuperTileBuilds = false;
+
+			/* BUILD SUPERTILES SKIPPED BY A BIG JUMP */
+
+	if (gTerrainWindowHasHoles)
+		FillTerrainWindowHoles();
+
 	CalcNewItemDeleteWindow();							// recalc item delete window
 
 }
@@ -1763,6 +2177,106 @@ float	temp,temp2;
 
 
 
+/********************** PLACE SUPERTILE *************************/
+//
+// Builds a supertile into the scroll buffer, unless we're in the middle of a multi-supertile
+// jump, in which case the cell is left empty for FillTerrainWindowHoles.
+//
+
+static void PlaceSuperTile(long superRow, long superCol)
+{
+	if (gDeferSuperTileBuilds)
+	{
+		gTerrainWindowHasHoles = true;
+		return;
+	}
+
+	gTerrainScrollBuffer[superRow][superCol] = AcquireSuperTile(superRow, superCol);
+}
+
+
+/********************** FILL TERRAIN WINDOW HOLES *************************/
+//
+// Builds the supertiles that are missing from the active window after a multi-supertile jump.
+// Cells near the camera are built immediately; the rest are built nearest-first until the
+// frame's time budget runs out, and we pick up where we left off next frame.
+//
+
+typedef struct
+{
+	short	row,col;
+	float	dist2;
+}TerrainHole;
+
+static int CompareTerrainHoles(const void* a, const void* b)
+{
+	float da = ((const TerrainHole*) a)->dist2;
+	float db = ((const TerrainHole*) b)->dist2;
+	return (da > db) - (da < db);
+}
+
+static void FillTerrainWindowHoles(void)
+{
+TerrainHole	holes[MAX_SUPERTILE_ACTIVE_RANGE*2 * MAX_SUPERTILE_ACTIVE_RANGE*2];
+int			numHoles = 0;
+long		row,col;
+float		camX,camZ;
+
+	camX = gGameViewInfoPtr->currentCameraCoords.x;
+	camZ = gGameViewInfoPtr->currentCameraCoords.z;
+
+			/* GATHER EMPTY ON-MAP CELLS IN THE WINDOW */
+
+	for (row = gCurrentSuperTileRow; row < gCurrentSuperTileRow + SUPERTILE_DIST_DEEP; row++)
+	{
+		if (row < 0 || row >= gNumSuperTilesDeep)
+			continue;
+
+		for (col = gCurrentSuperTileCol; col < gCurrentSuperTileCol + SUPERTILE_DIST_WIDE; col++)
+		{
+			if (col < 0 || col >= gNumSuperTilesWide)
+				continue;
+			if (gTerrainScrollBuffer[row][col] != EMPTY_SUPERTILE)
+				continue;
+
+			float dx = (col + 0.5f) * TERRAIN_SUPERTILE_UNIT_SIZE - camX;
+			float dz = (row + 0.5f) * TERRAIN_SUPERTILE_UNIT_SIZE - camZ;
+
+			holes[numHoles].row = row;
+			holes[numHoles].col = col;
+			holes[numHoles].dist2 = dx*dx + dz*dz;
+			numHoles++;
+		}
+	}
+
+	qsort(holes, numHoles, sizeof(holes[0]), CompareTerrainHoles);
+
+			/* BUILD NEAREST FIRST WITHIN BUDGET */
+
+	uint64_t	deadline = SDL_GetPerformanceCounter()
+						+ (uint64_t) (HOLE_FILL_BUDGET_MS * 0.001f * SDL_GetPerformanceFrequency());
+	int			i;
+
+	gHiccupEliminator = 0;
+
+	for (i = 0; i < numHoles; i++)
+	{
+		if (holes[i].dist2 > HOLE_FILL_URGENT_DIST*HOLE_FILL_URGENT_DIST		// don't leave a hole under the camera
+			&& i > 0															// always make progress
+			&& SDL_GetPerformanceCounter() > deadline)
+		{
+			break;
+		}
+
+		row = holes[i].row;
+		col = holes[i].col;
+		gTerrainScrollBuffer[row][col] = AcquireSuperTile(row, col);
+	}
+
+	gTerrainWindowHasHoles = (i < numHoles);
+}
+
+
 /********************** SCROLL TERRAIN UP *************************/
 //
 // INPUT: superRow = new supertile row #
@@ -1772,7 +2286,7 @@ static void ScrollTerrainUp(long superRow, long superCol)
 {
 long	col,i,bottom,left,right;
 int32_t	superTileNum;
-long	tileRow,tileCol;
+long	tileCol;
 
 	gHiccupEliminator = 0;															// reset this when about to make a new row/col of supertiles
 
@@ -1791,7 +2305,7 @@ long	tileRow,tileCol;
 			superTileNum = gTerrainScrollBuffer[gCurrentSuperTileRow][col];			// get supertile for that spot
 			if (superTileNum != EMPTY_SUPERTILE)
 			{
-				ReleaseSuperTileObject(superTileNum);						 		// free the supertile
+				RetireSuperTile(superTileNum);						 		// free the supertile
 				gTerrainScrollBuffer[gCurrentSuperTileRow][col] = EMPTY_SUPERTILE;
 			}
 		}
@@ -1801,7 +2315,6 @@ long	tileRow,tileCol;
 		/* CREATE NEW BOTTOM ROW */
 
 	superRow += SUPERTILE_DIST_DEEP-1;		 				   				// calc row # of bottom supertile row
-	tileRow = superRow * SUPERTILE_SIZE;  									// calc row # of bottom tile row
 
 	if (superRow >= gNumSuperTilesDeep)										// see if off map
 		return;
@@ -1821,8 +2334,7 @@ long	tileRow,tileCol;
 		{
 			if ((tileCol >= 0) && (tileCol < gTerrainTileWidth))
 			{
-				superTileNum = BuildTerrainSuperTile(tileCol,tileRow); 					// make new terrain object
-				gTerrainScrollBuffer[superRow][col] = superTileNum;						// save into scroll buffer array
+				PlaceSuperTile(superRow, col);										// make new terrain object
 			}
 		}
 next:
@@ -1866,7 +2378,7 @@ static void ScrollTerrainDown(long superRow, long superCol)
 {
 long	col,i,row,top,left,right;
 int32_t	superTileNum;
-long	tileRow,tileCol;
+long	tileCol;
 
 	gHiccupEliminator = 0;															// reset this when about to make a new row/col of supertiles
 
@@ -1887,7 +2399,7 @@ long	tileRow,tileCol;
 			superTileNum = gTerrainScrollBuffer[row][col];					// get supertile for that spot
 			if (superTileNum != EMPTY_SUPERTILE)
 			{
-				ReleaseSuperTileObject(superTileNum);	  						// free the terrain object
+				RetireSuperTile(superTileNum);	  						// free the terrain object
 				gTerrainScrollBuffer[row][col] = EMPTY_SUPERTILE;
 			}
 		}
@@ -1902,7 +2414,6 @@ long	tileRow,tileCol;
 		return;
 
 	tileCol = gCurrentSuperTileCol * SUPERTILE_SIZE;						// calc col # bot left tile col
-	tileRow = superRow * SUPERTILE_SIZE;  									// calc col # bot left tile col
 
 	for (col = gCurrentSuperTileCol; col < (gCurrentSuperTileCol + SUPERTILE_DIST_WIDE); col++)
 	{
@@ -1915,8 +2426,7 @@ long	tileRow,tileCol;
 		{
 			if ((tileCol >= 0) && (tileCol < gTerrainTileWidth))
 			{
-				superTileNum = BuildTerrainSuperTile(tileCol,tileRow); 				// make new terrain object
-				gTerrainScrollBuffer[superRow][col] = superTileNum;					// save into scroll buffer array
+				PlaceSuperTile(superRow, col);									// make new terrain object
 			}
 		}
 next:
@@ -1962,7 +2472,7 @@ static void ScrollTerrainLeft(void)
 {
 long	row,top,bottom,right;
 int32_t	superTileNum;
-long 	tileCol,tileRow,newSuperCol;
+long 	newSuperCol;
 long	bottomRow;
 
 	gHiccupEliminator = 0;															// reset this when about to make a new row/col of supertiles
@@ -1984,7 +2494,7 @@ long	bottomRow;
 			superTileNum = gTerrainScrollBuffer[row][gCurrentSuperTileCol]; 			// get supertile for that spot
 			if (superTileNum != EMPTY_SUPERTILE)
 			{
-				ReleaseSuperTileObject(superTileNum);									// free the terrain object
+				RetireSuperTile(superTileNum);									// free the terrain object
 				gTerrainScrollBuffer[row][gCurrentSuperTileCol] = EMPTY_SUPERTILE;
 			}
 		}
@@ -1994,8 +2504,6 @@ long	bottomRow;
 		/* CREATE NEW RIGHT COL */
 
 	newSuperCol = gCurrentSuperTileCol+SUPERTILE_DIST_WIDE;	   					// calc col # of right supertile col
-	tileCol = newSuperCol * SUPERTILE_SIZE; 		 							// calc col # of right tile col
-	tileRow = gCurrentSuperTileRow * SUPERTILE_SIZE;
 
 	if (newSuperCol >= gNumSuperTilesWide)										// see if off map
 		goto exit;
@@ -2007,15 +2515,12 @@ long	bottomRow;
 		if (row >= gNumSuperTilesDeep)
 			break;
 		if (row < 0)
-			goto next;
+			continue;
 
 		if (gTerrainScrollBuffer[row][newSuperCol] == EMPTY_SUPERTILE)			// make sure nothing already here
 		{
-			superTileNum = BuildTerrainSuperTile(tileCol,tileRow); 				// make new terrain object
-			gTerrainScrollBuffer[row][newSuperCol] = superTileNum;				// save into scroll buffer array
+			PlaceSuperTile(row, newSuperCol);									// make new terrain object
 		}
-next:
-		tileRow += SUPERTILE_SIZE;
 	}
 
 			/* ADD ITEMS ON RIGHT */
@@ -2075,7 +2580,7 @@ long	top,bottom,left;
 			superTileNum = gTerrainScrollBuffer[row][col];						// get terrain object for that spot
 			if (superTileNum != EMPTY_SUPERTILE)
 			{
-				ReleaseSuperTileObject(superTileNum);		 					// free the terrain object
+				RetireSuperTile(superTileNum);		 					// free the terrain object
 				gTerrainScrollBuffer[row][col] = EMPTY_SUPERTILE;
 			}
 		}
@@ -2099,8 +2604,7 @@ long	top,bottom,left;
 		{
 			if ((tileRow >= 0) && (tileRow < gTerrainTileDepth))
 			{
-				superTileNum = BuildTerrainSuperTile(tileCol,tileRow); 				// make new terrain object
-				gTerrainScrollBuffer[row][superCol] = superTileNum;					// save into scroll buffer array
+				PlaceSuperTile(row, superCol);									// make new terrain object
 			}
 		}
 next:
@@ -2150,6 +2654,7 @@ long	i,w;
 	{
 		PrimeSplines();
 		PrimeFences();
+		PrecomputeTerrainLighting();						// lights are set up by now
 	}		
 
 			/* PRIME THE SUPERTILES */
@@ -2182,12 +2687,14 @@ static Boolean IsSuperTileVisible(int32_t superTileNum, Byte layer)
 
 /*************** CALCULATE SPLIT MODE MATRIX ***********************/
 
-void CalculateSplitModeMatrix(void)
+static void CalcSplitModeRows(void* userData, int firstRow, int endRow)
 {
 int		row,col;
 Byte	numLayers,j;
 float	y0,y1,y2,y3;
 
+	(void) userData;
+
 	if (gDoCeiling)
 		numLayers = 2;
 	else
@@ -2196,7 +2703,7 @@ float	y0,y1,y2,y3;
 
 	for (j = 0; j < numLayers; j++)							// floor & ceiling
 	{
-		for (row = 0; row < gTerrainTileDepth; row++)
+		for (row = firstRow; row < endRow; row++)
 		{	
 			for (col = 0; col < gTerrainTileWidth; col++)
 			{
@@ -2220,14 +2727,13 @@ float	y0,y1,y2,y3;
 					else
 						gMapInfoMatrix[row][col].splitMode[j] = SPLIT_FORWARD;		// use / splits
 				}				
-				
-
-	
 			}
 		}
 	}
+}
 
-
-
+void CalculateSplitModeMatrix(void)
+{
+	Parallel_ForBands(gTerrainTileDepth, CalcSplitModeRows, NULL);			// rows are independent
 }
 
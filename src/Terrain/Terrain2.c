@@ -420,10 +420,10 @@ TQ3Matrix4x4	*m,m2;
 
 void CalcTileNormals(long layer, long row, long col, TQ3Vector3D *n1, TQ3Vector3D *n2)
 {
-static TQ3Point3D	p1 = {0,0,0};
-static TQ3Point3D	p2 = {TERRAIN_POLYGON_SIZE,0,0};
-static TQ3Point3D	p3 = {TERRAIN_POLYGON_SIZE,0,TERRAIN_POLYGON_SIZE};
-static TQ3Point3D	p4 = {0, 0, TERRAIN_POLYGON_SIZE};
+TQ3Point3D	p1 = {0,0,0};								// not static: called from the terrain lighting threads
+TQ3Point3D	p2 = {TERRAIN_POLYGON_SIZE,0,0};
+TQ3Point3D	p3 = {TERRAIN_POLYGON_SIZE,0,TERRAIN_POLYGON_SIZE};
+TQ3Point3D	p4 = {0, 0, TERRAIN_POLYGON_SIZE};
 
 
 		/* MAKE SURE ROW/COL IS IN RANGE */
@@ -484,17 +484,119 @@ static TQ3Point3D	p4 = {0, 0, TERRAIN_POLYGON_SIZE};
 // Scans thru item list and casts a shadown onto the terrain
 // by darkening the vertex colors of the terrain.
 //
+// The shadow lines are computed up front, then bands of map rows are shaded in parallel.
+// Each band only touches its own rows of the vertex colors & shadow flags, and a vertex is
+// darkened at most once no matter how many shadows cross it, so the result is the same
+// as shading everything serially.
+//
+
+typedef struct
+{
+	TQ3Point2D		from,to;
+	float			length;
+	long			minRow,maxRow;					// rows that this shadow may touch
+}ItemShadowLine;
+
+typedef struct
+{
+	const ItemShadowLine*	lines;
+	long					numLines;
+	Byte					**shadowFlags;
+}ItemShadowJob;
+
+
+static void ShadeItemShadowRows(void* userData, int firstRow, int endRow)
+{
+const ItemShadowJob* job = (const ItemShadowJob*) userData;
+Byte		**shadowFlags = job->shadowFlags;
+float		x,z,t;
+long		row,col;
+
+	for (long i = 0; i < job->numLines; i++)
+	{
+		const ItemShadowLine* line = &job->lines[i];
+
+		if (line->maxRow < firstRow || line->minRow >= endRow)		// skip shadows that don't reach this band
+			continue;
+
+		TQ3Point2D	from = line->from;
+		TQ3Point2D	to = line->to;
+		float		length = line->length;
+
+			/***************************************/
+			/* SCAN ALONG LIGHT AND SHADE VERTICES */
+			/***************************************/
+					
+		for (t = 1.0; t > 0.0f; t -= 1.0f / (length/TERRAIN_POLYGON_SIZE))
+		{
+			float	oneMinusT = 1.0f - t;
+			float	r,g,b;
+			float	ro,co;
+			u_short	*color;
+			
+			x = (from.x * oneMinusT) + (to.x * t);			// calc center x
+			z = (from.y * oneMinusT) + (to.y * t);
+		
+			for (ro = -.5; ro <= .5; ro += .5)
+			{
+				for (co = -.5; co <= .5; co += .5)
+				{
+					row = z / TERRAIN_POLYGON_SIZE + ro;			// calc row/col
+					col = x / TERRAIN_POLYGON_SIZE + co;
+		
+					if ((row < firstRow) || (row >= endRow))		// only touch this band's rows
+						continue;
+					if ((row < 0) || (col < 0))						// check for out of bounds
+						continue;
+					if ((row >= gTerrainTileDepth) || (col >= gTerrainTileWidth))	
+						continue;
+					
+					if (shadowFlags[row][col])						// see if this already shadowed
+						continue;
+		
+					shadowFlags[row][col] = 1;						// set flag
+					
+				
+						/* EXTRACT RGB */
+						
+					color = &gVertexColors[FLOOR][row][col];
+					
+					r = (*color >> 11);
+					r /= 0x1f;
+					g = (*color >> 5) & 0x3f;
+					g /= 0x3f;
+					b = (*color & 0x1f);
+					b /= 0x1f;
+					
+						/* FADE IT */
+						
+					r *= .7f;
+					g *= .7f;
+					b *= .7f;
+					
+					
+						/* SAVE RGB */
+						
+					*color = (int)(r*(float)0x1f)<<11;
+					*color |= (int)(g*(float)0x3f)<<5;
+					*color |= (int)(b*(float)0x1f);	
+				}// co
+			} // ro
+		}		
+	}
+}
+
 
 void DoItemShadowCasting(void)
 {
 long				i;
 static TQ3Vector3D up = {0,1,0};
-float				height,dot,length;
+float				height,dot;
 TQ3Vector2D			lightVector;
-TQ3Point2D			from,to;
-float				x,z,t;
 long				row,col;
 Byte				**shadowFlags;
+ItemShadowLine		*lines;
+long				numLines = 0;
 
 			/* INIT SHADOW FLAGS TEMP BUFFER */
 			
@@ -504,6 +606,9 @@ Byte				**shadowFlags;
 		for (col = 0; col <= gTerrainTileWidth; col++)
 			shadowFlags[row][col] = 0;
 
+	lines = (ItemShadowLine*) AllocPtr(sizeof(ItemShadowLine) * (gNumTerrainItems > 0 ? gNumTerrainItems : 1));
+	GAME_ASSERT(lines);
+
 
 			/* GET MAIN LIGHT VECTOR INFO */
 
@@ -598,79 +703,33 @@ Byte				**shadowFlags;
 		}
 		
 			/* CALCULATE LINE TO DRAW SHADOW ALONG */
+
+		ItemShadowLine* line = &lines[numLines++];
 			
-		from.x = (int)(*gMasterItemList)[i].x * MAP2UNIT_VALUE;
-		from.y = (int)(*gMasterItemList)[i].y * MAP2UNIT_VALUE;
+		line->from.x = (int)(*gMasterItemList)[i].x * MAP2UNIT_VALUE;
+		line->from.y = (int)(*gMasterItemList)[i].y * MAP2UNIT_VALUE;
 				
-		to.x = from.x + lightVector.x * (height * dot);
-		to.y = from.y + lightVector.y * (height * dot);
-		
-		length = Q3Point2D_Distance(&from, &to);
-		
-		
-			/***************************************/
-			/* SCAN ALONG LIGHT AND SHADE VERTICES */
-			/***************************************/
-					
-		for (t = 1.0; t > 0.0f; t -= 1.0f / (length/TERRAIN_POLYGON_SIZE))
-		{
-			float	oneMinusT = 1.0f - t;
-			float	r,g,b;
-			float	ro,co;
-			u_short	*color;
-			
-			x = (from.x * oneMinusT) + (to.x * t);			// calc center x
-			z = (from.y * oneMinusT) + (to.y * t);
-		
-			for (ro = -.5; ro <= .5; ro += .5)
-			{
-				for (co = -.5; co <= .5; co += .5)
-				{
-					row = z / TERRAIN_POLYGON_SIZE + ro;			// calc row/col
-					col = x / TERRAIN_POLYGON_SIZE + co;
-		
-					if ((row < 0) || (col < 0))						// check for out of bounds
-						continue;
-					if ((row >= gTerrainTileDepth) || (col >= gTerrainTileWidth))	
-						continue;
-					
-					if (shadowFlags[row][col])						// see if this already shadowed
-						continue;
+		line->to.x = line->from.x + lightVector.x * (height * dot);
+		line->to.y = line->from.y + lightVector.y * (height * dot);
 		
-					shadowFlags[row][col] = 1;						// set flag
-					
-				
-						/* EXTRACT RGB */
-						
-					color = &gVertexColors[FLOOR][row][col];
-					
-					r = (*color >> 11);
-					r /= 0x1f;
-					g = (*color >> 5) & 0x3f;
-					g /= 0x3f;
-					b = (*color & 0x1f);
-					b /= 0x1f;
-					
-						/* FADE IT */
-						
-					r *= .7f;
-					g *= .7f;
-					b *= .7f;
-					
-					
-						/* SAVE RGB */
-						
-					*color = (int)(r*(float)0x1f)<<11;
-					*color |= (int)(g*(float)0x3f)<<5;
-					*color |= (int)(b*(float)0x1f);	
-				}// co
-			} // ro
-		}		
+		line->length = Q3Point2D_Distance(&line->from, &line->to);
+
+		float minZ = line->from.y < line->to.y ? line->from.y : line->to.y;
+		float maxZ = line->from.y > line->to.y ? line->from.y : line->to.y;
+		line->minRow = (long)(minZ / TERRAIN_POLYGON_SIZE) - 1;
+		line->maxRow = (long)(maxZ / TERRAIN_POLYGON_SIZE) + 1;
 	}
 	
+
+			/* SHADE BANDS OF ROWS IN PARALLEL */
+
+	ItemShadowJob job = { .lines = lines, .numLines = numLines, .shadowFlags = shadowFlags };
+	Parallel_ForBands(gTerrainTileDepth, ShadeItemShadowRows, &job);
+
 	
 			/* CLEANUP */
 			
+	DisposePtr((Ptr) lines);
 	Free2DArray((void**) shadowFlags);
 	shadowFlags = nil;
 }